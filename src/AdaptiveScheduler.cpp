@@ -0,0 +1,106 @@
+#include "AdaptiveScheduler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Mean luminance below this counts as this much, so black tiles with a
+// handful of faint samples are not held back by a tiny denominator
+constexpr float kLuminanceFloor = 1e-2f;
+}
+
+AdaptiveScheduler::AdaptiveScheduler(int width, int height, float target_error)
+    : width_(width)
+    , height_(height)
+    , tiles_x_((width + kTileSize - 1) / kTileSize)
+    , tiles_y_((height + kTileSize - 1) / kTileSize)
+    , target_error_(target_error) {
+    Reset();
+}
+
+void AdaptiveScheduler::Reset() {
+    size_t tile_count = static_cast<size_t>(tiles_x_) * tiles_y_;
+    active_tiles_.assign(tile_count, 1);
+    tile_errors_.assign(tile_count, std::numeric_limits<float>::infinity());
+    active_tile_count_ = tile_count;
+    active_pixel_count_ = static_cast<size_t>(width_) * height_;
+    max_error_ = std::numeric_limits<float>::infinity();
+}
+
+size_t AdaptiveScheduler::GetTilePixelCount(size_t tile) const {
+    int x0 = static_cast<int>(tile % tiles_x_) * kTileSize;
+    int y0 = static_cast<int>(tile / tiles_x_) * kTileSize;
+    return static_cast<size_t>(std::min(x0 + kTileSize, width_) - x0) * (std::min(y0 + kTileSize, height_) - y0);
+}
+
+float AdaptiveScheduler::EstimateTileError(const float* accumulated_color, const int32_t* accumulated_samples,
+                                           const float* accumulated_moment, int width, int x0, int y0, int x1,
+                                           int y1) {
+    double variance_sum = 0.0;
+    double mean_sum = 0.0;
+    for (int y = y0; y < y1; ++y) {
+        for (int x = x0; x < x1; ++x) {
+            size_t pixel = static_cast<size_t>(y) * width + x;
+            int32_t samples = accumulated_samples[pixel];
+            if (samples < kMinSamples) {
+                return std::numeric_limits<float>::infinity();
+            }
+            const float* color = accumulated_color + pixel * 4;
+            double n = static_cast<double>(samples);
+            double mean = (0.2126 * color[0] + 0.7152 * color[1] + 0.0722 * color[2]) / n;
+            // Unbiased sample variance, divided by n for the variance of the mean
+            double variance = std::max(0.0, accumulated_moment[pixel] / n - mean * mean) / (n - 1.0);
+            variance_sum += variance;
+            mean_sum += mean;
+        }
+    }
+    double pixel_count = static_cast<double>(x1 - x0) * (y1 - y0);
+    double mean = std::max(mean_sum / pixel_count, static_cast<double>(kLuminanceFloor));
+    return static_cast<float>(std::sqrt(variance_sum / pixel_count) / mean);
+}
+
+void AdaptiveScheduler::Update(Film* film) {
+    const float* color;
+    const int32_t* samples;
+    const float* moment;
+    if (film->IsHostAccumulation()) {
+        color = film->GetHostAccumulatedColor();
+        samples = film->GetHostAccumulatedSamples();
+        moment = film->GetHostAccumulatedMoment();
+    } else {
+        size_t pixel_count = static_cast<size_t>(width_) * height_;
+        accumulated_color_.resize(pixel_count * 4);
+        accumulated_samples_.resize(pixel_count);
+        accumulated_moment_.resize(pixel_count);
+        film->GetAccumulatedColorImage()->DownloadData(accumulated_color_.data());
+        film->GetAccumulatedSamplesImage()->DownloadData(accumulated_samples_.data());
+        film->GetAccumulatedMomentImage()->DownloadData(accumulated_moment_.data());
+        color = accumulated_color_.data();
+        samples = accumulated_samples_.data();
+        moment = accumulated_moment_.data();
+    }
+
+    // Retired tiles get no more samples, so their estimate cannot change
+    ThreadPool::Global().ParallelFor(active_tiles_.size(), [&](size_t tile) {
+        if (!active_tiles_[tile]) {
+            return;
+        }
+        int x0 = static_cast<int>(tile % tiles_x_) * kTileSize;
+        int y0 = static_cast<int>(tile / tiles_x_) * kTileSize;
+        tile_errors_[tile] = EstimateTileError(color, samples, moment, width_, x0, y0,
+                                               std::min(x0 + kTileSize, width_), std::min(y0 + kTileSize, height_));
+        active_tiles_[tile] = tile_errors_[tile] > target_error_ ? 1 : 0;
+    });
+
+    active_tile_count_ = 0;
+    active_pixel_count_ = 0;
+    max_error_ = 0.0f;
+    for (size_t tile = 0; tile < active_tiles_.size(); ++tile) {
+        max_error_ = std::max(max_error_, tile_errors_[tile]);
+        if (active_tiles_[tile]) {
+            active_tile_count_++;
+            active_pixel_count_ += GetTilePixelCount(tile);
+        }
+    }
+}
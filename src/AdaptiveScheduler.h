@@ -0,0 +1,68 @@
+#pragma once
+#include "long_march.h"
+#include "Film.h"
+#include "TileScheduler.h"
+#include <vector>
+
+// Adaptive sampling over the TileScheduler's tiles. Update estimates each
+// tile's relative error from the film's color sum, luminance second moment
+// and per-pixel sample counts, and retires tiles that reached the target; the
+// tile scheduler then hands out only the tiles still marked active.
+class AdaptiveScheduler {
+public:
+    static constexpr int kTileSize = TileScheduler::kTileSize;
+    // Samples every pixel takes before its tile may retire; fewer make the
+    // variance estimate itself too noisy to trust
+    static constexpr int kMinSamples = 16;
+
+    // target_error bounds a tile's RMS per-pixel relative error; 0.01 means
+    // a typical pixel's luminance is within about 1% of converged
+    AdaptiveScheduler(int width, int height, float target_error);
+
+    // Mark every tile active again (call whenever the film is reset)
+    void Reset();
+
+    // Re-estimate the tile errors from the film's accumulation. Device films
+    // are downloaded, so the caller must have waited for the GPU.
+    void Update(Film* film);
+
+    // One entry per tile in row-major order, nonzero while the tile needs samples
+    const std::vector<uint32_t>& GetActiveTiles() const { return active_tiles_; }
+    int GetTilesX() const { return tiles_x_; }
+    int GetTilesY() const { return tiles_y_; }
+    size_t GetActiveTileCount() const { return active_tile_count_; }
+    // Pixels the next sample pass will render
+    size_t GetActivePixelCount() const { return active_pixel_count_; }
+    bool IsConverged() const { return active_tile_count_ == 0; }
+
+    // Largest tile error at the last update (infinite before the first)
+    float GetMaxError() const { return max_error_; }
+    // Per-tile errors at the last update, for TileOrder::kPriority
+    const std::vector<float>& GetTileErrors() const { return tile_errors_; }
+    float GetTargetError() const { return target_error_; }
+
+    // RMS over the tile's pixels of the standard error of each pixel's mean
+    // luminance, relative to the tile's mean luminance; infinite while a
+    // pixel has fewer than kMinSamples samples
+    static float EstimateTileError(const float* accumulated_color, const int32_t* accumulated_samples,
+                                   const float* accumulated_moment, int width, int x0, int y0, int x1, int y1);
+
+private:
+    int width_;
+    int height_;
+    int tiles_x_;
+    int tiles_y_;
+    float target_error_;
+    std::vector<uint32_t> active_tiles_;
+    std::vector<float> tile_errors_;
+    size_t active_tile_count_ = 0;
+    size_t active_pixel_count_ = 0;
+    float max_error_ = 0.0f;
+
+    // Download targets for device films
+    std::vector<float> accumulated_color_;
+    std::vector<int32_t> accumulated_samples_;
+    std::vector<float> accumulated_moment_;
+
+    size_t GetTilePixelCount(size_t tile) const;
+};
@@ -0,0 +1,66 @@
+#include "AliasTable.h"
+#include <algorithm>
+
+void AliasTable::Build(const std::vector<float>& weights) {
+    entries_.clear();
+    total_weight_ = 0.0;
+    for (float weight : weights) {
+        total_weight_ += std::max(weight, 0.0f);
+    }
+    if (weights.empty() || total_weight_ <= 0.0) {
+        return;
+    }
+
+    const size_t count = weights.size();
+    entries_.resize(count);
+    std::vector<double> scaled(count);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < count; ++i) {
+        double weight = std::max(weights[i], 0.0f);
+        entries_[i].pdf = static_cast<float>(weight / total_weight_);
+        entries_[i].alias = static_cast<uint32_t>(i);
+        entries_[i].padding = 0;
+        scaled[i] = weight / total_weight_ * count;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+    // Pair each under-full bucket with an over-full one that tops it up
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        small.pop_back();
+        uint32_t l = large.back();
+        entries_[s].probability = static_cast<float>(scaled[s]);
+        entries_[s].alias = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Whatever is left is full up to rounding
+    for (uint32_t i : small) {
+        entries_[i].probability = 1.0f;
+    }
+    for (uint32_t i : large) {
+        entries_[i].probability = 1.0f;
+    }
+}
+
+uint32_t AliasTable::Sample(const Entry* entries, uint32_t count, float u, float* pdf, float* remapped_u) {
+    float scaled = u * count;
+    uint32_t index = std::min(static_cast<uint32_t>(scaled), count - 1);
+    float fraction = std::min(scaled - index, 0.99999994f);
+    float probability = entries[index].probability;
+    float remapped;
+    if (fraction < probability) {
+        remapped = fraction / probability;
+    } else {
+        remapped = (fraction - probability) / (1.0f - probability);
+        index = entries[index].alias;
+    }
+    if (remapped_u) {
+        *remapped_u = std::min(remapped, 0.99999994f);
+    }
+    *pdf = entries[index].pdf;
+    return index;
+}
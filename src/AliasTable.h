@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Walker / Vose alias table: draws index i with probability weight[i] / sum
+// in O(1) from a single uniform number, whatever the number of entries.
+class AliasTable {
+public:
+    // Layout shared with the shaders (AliasEntry in shader.hlsl)
+    struct Entry {
+        float probability; // keep this index when the fraction of u is below it
+        uint32_t alias;    // index taken otherwise
+        float pdf;         // weight of this index over the total
+        uint32_t padding;
+    };
+
+    // Negative weights count as zero. Leaves the table empty when every weight is zero.
+    void Build(const std::vector<float>& weights);
+
+    // u in [0, 1); returns the index and its probability. The table must not be empty.
+    uint32_t Sample(float u, float* pdf) const { return Sample(entries_.data(), static_cast<uint32_t>(entries_.size()), u, pdf); }
+
+    // Same on count entries stored elsewhere (tables packed back to back).
+    // remapped_u, if given, receives a fresh uniform number in [0, 1) recovered
+    // from what the choice left of u.
+    static uint32_t Sample(const Entry* entries, uint32_t count, float u, float* pdf, float* remapped_u = nullptr);
+
+    float GetPdf(uint32_t index) const { return entries_[index].pdf; }
+    double GetTotalWeight() const { return total_weight_; }
+    const std::vector<Entry>& GetEntries() const { return entries_; }
+    bool IsEmpty() const { return entries_.empty(); }
+
+private:
+    std::vector<Entry> entries_;
+    double total_weight_ = 0.0;
+};
@@ -0,0 +1,503 @@
+#include "BatchRenderer.h"
+#include "AdaptiveScheduler.h"
+#include "CpuRenderer.h"
+#include "DistributedRenderer.h"
+#include "FilmSnapshot.h"
+#include "GpuRenderer.h"
+#include "ImageExporter.h"
+#include "ImageWriter.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Sample passes between adaptive sampling updates; each one downloads the
+// device accumulation, so it is not done every pass
+constexpr int kAdaptiveUpdateInterval = 8;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void PrintUsage() {
+    grassland::LogInfo("Usage: --batch [--scene file.json] [--camera x,y,z,yaw,pitch] [--fov degrees]");
+    grassland::LogInfo("               [--width N] [--height N] [--spp N] [--time seconds] [--noise error]");
+    grassland::LogInfo("               [--output file.png] [--backend gpu|cpu] [--api d3d12|vulkan]");
+    grassland::LogInfo("               [--count-rays on|off] [--stats file.json] [--light-sampling bvh|power]");
+    grassland::LogInfo("               [--sky-light on|off] [--sampler random|sobol|bluenoise] [--workers N]");
+    grassland::LogInfo("               [--sample-offset N] [--checkpoint file.smac] [--checkpoint-interval seconds]");
+    grassland::LogInfo("               [--checkpoint-precision float|half] [--resume file.smac]...");
+    grassland::LogInfo("               [--aovs albedo,normal,depth,id|all] [--exr-precision half|float]");
+    grassland::LogInfo("               [--exr-compression none|zips|zip]");
+}
+
+// Comma separated numbers, e.g. "0,2,5,-90,0"
+bool ParseNumbers(const std::string& text, float* values, int count) {
+    std::stringstream stream(text);
+    std::string item;
+    int parsed = 0;
+    while (std::getline(stream, item, ',')) {
+        if (parsed == count) return false;
+        try {
+            values[parsed++] = std::stof(item);
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return parsed == count;
+}
+
+// Comma separated AOV names, e.g. "albedo,normal"
+bool ParseAovs(const std::string& text, uint32_t* aovs) {
+    std::stringstream stream(text);
+    std::string item;
+    *aovs = 0;
+    while (std::getline(stream, item, ',')) {
+        if (item == "albedo") {
+            *aovs |= Film::kAovAlbedo;
+        } else if (item == "normal") {
+            *aovs |= Film::kAovNormal;
+        } else if (item == "depth") {
+            *aovs |= Film::kAovDepth;
+        } else if (item == "id") {
+            *aovs |= Film::kAovInstanceId;
+        } else if (item == "all") {
+            *aovs |= Film::kAovAlbedo | Film::kAovNormal | Film::kAovDepth | Film::kAovInstanceId;
+        } else if (item != "none") {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+CameraObject MakeSceneCameraObject(const SceneCamera& camera, float fov, int width, int height) {
+    glm::vec3 front;
+    front.x = cos(glm::radians(camera.yaw)) * cos(glm::radians(camera.pitch));
+    front.y = sin(glm::radians(camera.pitch));
+    front.z = sin(glm::radians(camera.yaw)) * cos(glm::radians(camera.pitch));
+    front = glm::normalize(front);
+
+    CameraObject camera_object{};
+    camera_object.screen_to_camera =
+        glm::inverse(glm::perspective(glm::radians(fov), (float)width / (float)height, 0.1f, 10.0f));
+    camera_object.camera_to_world =
+        glm::inverse(glm::lookAt(camera.position, camera.position + front, glm::vec3(0.0f, 1.0f, 0.0f)));
+    return camera_object;
+}
+
+bool ParseBatchSettings(const std::vector<std::string>& args, BatchSettings* settings) {
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& option = args[i];
+        if (i + 1 >= args.size()) {
+            grassland::LogError("Missing value for {}", option);
+            PrintUsage();
+            return false;
+        }
+        const std::string& value = args[++i];
+        try {
+            if (option == "--scene") {
+                settings->scene_file = value;
+            } else if (option == "--camera") {
+                float v[5];
+                if (!ParseNumbers(value, v, 5)) {
+                    grassland::LogError("--camera expects x,y,z,yaw,pitch");
+                    return false;
+                }
+                settings->override_camera = true;
+                settings->camera.position = glm::vec3(v[0], v[1], v[2]);
+                settings->camera.yaw = v[3];
+                settings->camera.pitch = v[4];
+            } else if (option == "--fov") {
+                settings->fov = std::stof(value);
+            } else if (option == "--width") {
+                settings->width = std::stoi(value);
+            } else if (option == "--height") {
+                settings->height = std::stoi(value);
+            } else if (option == "--spp") {
+                settings->samples_per_pixel = std::stoi(value);
+            } else if (option == "--time") {
+                settings->time_budget = std::stod(value);
+            } else if (option == "--noise") {
+                settings->noise_target = std::stof(value);
+            } else if (option == "--output") {
+                settings->output = value;
+            } else if (option == "--backend" && (value == "gpu" || value == "cpu")) {
+                settings->use_cpu_renderer = value == "cpu";
+            } else if (option == "--sample-offset") {
+                settings->sample_offset = static_cast<uint32_t>(std::stoul(value));
+            } else if (option == "--checkpoint") {
+                settings->checkpoint = value;
+            } else if (option == "--checkpoint-interval") {
+                settings->checkpoint_interval = std::stod(value);
+            } else if (option == "--checkpoint-precision" && (value == "float" || value == "half")) {
+                settings->checkpoint_half = value == "half";
+            } else if (option == "--resume") {
+                settings->resume.push_back(value);
+            } else if (option == "--aovs") {
+                if (!ParseAovs(value, &settings->aovs)) {
+                    grassland::LogError("--aovs expects a comma separated list of albedo, normal, depth, id, or all");
+                    return false;
+                }
+            } else if (option == "--exr-precision" && (value == "half" || value == "float")) {
+                settings->hdr_options.half = value == "half";
+            } else if (option == "--exr-compression" && (value == "none" || value == "zips" || value == "zip")) {
+                settings->hdr_options.compression = value == "none" ? ExrCompression::kNone
+                                                  : value == "zips" ? ExrCompression::kZips
+                                                                    : ExrCompression::kZip;
+            } else if (option == "--workers") {
+                settings->workers = std::stoi(value);
+            } else if (option == "--count-rays" && (value == "on" || value == "off")) {
+                settings->count_rays = value == "on";
+            } else if (option == "--stats") {
+                settings->stats_output = value;
+                settings->count_rays = true;
+            } else if (option == "--light-sampling" && (value == "bvh" || value == "power")) {
+                settings->light_selection = value == "bvh" ? LightSelection::kBvh : LightSelection::kPower;
+            } else if (option == "--sky-light" && (value == "on" || value == "off")) {
+                settings->environment_light = value == "on";
+            } else if (option == "--sampler" && (value == "random" || value == "sobol" || value == "bluenoise")) {
+                settings->sampler_type = value == "random" ? SamplerType::kRandom
+                                       : value == "sobol"  ? SamplerType::kSobol
+                                                           : SamplerType::kBlueNoise;
+            } else if (option == "--api" && (value == "d3d12" || value == "vulkan")) {
+                settings->api = value == "d3d12" ? grassland::graphics::BACKEND_API_D3D12
+                                                 : grassland::graphics::BACKEND_API_VULKAN;
+            } else {
+                grassland::LogError("Unknown batch option: {} {}", option, value);
+                PrintUsage();
+                return false;
+            }
+        } catch (const std::exception&) {
+            grassland::LogError("Invalid value for {}: {}", option, value);
+            return false;
+        }
+    }
+    if (settings->width <= 0 || settings->height <= 0 || settings->samples_per_pixel < 0 ||
+        settings->time_budget < 0.0 || settings->noise_target < 0.0f || settings->workers < 0 ||
+        settings->checkpoint_interval <= 0.0) {
+        grassland::LogError("Resolution must be positive and budgets non-negative");
+        return false;
+    }
+    // Workers render whole chunks to a fixed sample count before reporting back
+    if (settings->workers > 0 && (!settings->use_cpu_renderer || settings->time_budget > 0.0 ||
+                                  settings->noise_target > 0.0f || !settings->resume.empty())) {
+        grassland::LogError("--workers needs --backend cpu and a --spp budget without --time, --noise or --resume");
+        return false;
+    }
+    HdrFormat format;
+    if (settings->aovs != 0 && !GetHdrFormat(settings->output, &format)) {
+        grassland::LogError("--aovs needs an .exr, .pfm or .hdr output");
+        return false;
+    }
+    // Snapshots and the worker segment only carry the color accumulation
+    if (settings->aovs != 0 && (settings->workers > 0 || !settings->resume.empty())) {
+        grassland::LogError("--aovs cannot be combined with --workers or --resume");
+        return false;
+    }
+    if (settings->samples_per_pixel == 0 && settings->time_budget == 0.0 && settings->noise_target == 0.0f) {
+        settings->samples_per_pixel = 64;
+    }
+    return true;
+}
+
+std::vector<std::string> FormatBatchSettings(const BatchSettings& settings) {
+    std::vector<std::string> args;
+    if (!settings.scene_file.empty()) {
+        args.insert(args.end(), { "--scene", settings.scene_file });
+    }
+    if (settings.override_camera) {
+        std::ostringstream camera;
+        camera << std::setprecision(9) << settings.camera.position.x << "," << settings.camera.position.y << ","
+               << settings.camera.position.z << "," << settings.camera.yaw << "," << settings.camera.pitch;
+        args.insert(args.end(), { "--camera", camera.str() });
+    }
+    if (settings.fov > 0.0f) {
+        std::ostringstream fov;
+        fov << std::setprecision(9) << settings.fov;
+        args.insert(args.end(), { "--fov", fov.str() });
+    }
+    args.insert(args.end(), { "--width", std::to_string(settings.width), "--height", std::to_string(settings.height) });
+    if (settings.samples_per_pixel > 0) {
+        args.insert(args.end(), { "--spp", std::to_string(settings.samples_per_pixel) });
+    }
+    args.insert(args.end(), { "--backend", settings.use_cpu_renderer ? "cpu" : "gpu" });
+    args.insert(args.end(), { "--light-sampling", settings.light_selection == LightSelection::kBvh ? "bvh" : "power" });
+    args.insert(args.end(), { "--sky-light", settings.environment_light ? "on" : "off" });
+    args.insert(args.end(), { "--sampler", settings.sampler_type == SamplerType::kRandom  ? "random"
+                                           : settings.sampler_type == SamplerType::kSobol ? "sobol"
+                                                                                           : "bluenoise" });
+    args.insert(args.end(), { "--sample-offset", std::to_string(settings.sample_offset) });
+    return args;
+}
+
+namespace {
+
+// --workers: the scene is loaded by the workers, not here
+int RunDistributedBatch(const BatchSettings& settings) {
+    Film film(nullptr, settings.width, settings.height);
+    double seconds = 0.0;
+    if (!RenderDistributed(settings, settings.workers, 0, &film, &seconds)) {
+        return 1;
+    }
+    RenderImageData image;
+    image.width = settings.width;
+    image.height = settings.height;
+    image.accumulated_rgba = film.GetHostAccumulatedColor();
+    if (!WriteRenderImage(settings.output, image, settings.hdr_options)) {
+        grassland::LogError("Failed to write {}", settings.output);
+        return 1;
+    }
+    grassland::LogInfo("Saved {} ({}x{}, {} samples per pixel)", settings.output, settings.width, settings.height,
+                       settings.samples_per_pixel);
+    if (!settings.checkpoint.empty()) {
+        FilmSnapshotWriter writer;
+        if (!writer.Write(&film, settings.checkpoint, settings.checkpoint_half) || !writer.Wait()) {
+            return 1;
+        }
+        grassland::LogInfo("Saved snapshot {}", settings.checkpoint);
+    }
+    double pixel_samples = static_cast<double>(settings.width) * settings.height * settings.samples_per_pixel;
+    grassland::LogInfo("Batch render (cpu, {} workers): {} spp in {:.2f} s, {:.2f} spp/s, {:.2f} Msamples/s",
+                       settings.workers, settings.samples_per_pixel, seconds, settings.samples_per_pixel / seconds,
+                       pixel_samples / seconds * 1e-6);
+    return 0;
+}
+
+} // namespace
+
+int RunBatch(const BatchSettings& settings) {
+    if (settings.workers > 0) {
+        return RunDistributedBatch(settings);
+    }
+
+    auto setup_start = Clock::now();
+
+    // The CPU path runs on machines without a ray tracing device, so it never creates one
+    std::shared_ptr<grassland::graphics::Core> core;
+    if (!settings.use_cpu_renderer) {
+        grassland::graphics::CreateCore(settings.api, grassland::graphics::Core::Settings{}, &core);
+        core->InitializeLogicalDeviceAutoSelect(true);
+        grassland::LogInfo("Device Name: {}", core->DeviceName());
+        if (!core->DeviceRayTracingSupport()) {
+            grassland::LogError("Device has no ray tracing support; use --backend cpu");
+            return 1;
+        }
+    }
+
+    int exit_code = 0;
+    {
+        // Scope the device objects so they are released before the core
+        Scene scene(core.get());
+        SceneFileData scene_data;
+        std::string scene_file = settings.scene_file.empty() ? GetDefaultSceneDirectory() + "/default.json"
+                                                             : settings.scene_file;
+        if (!LoadSceneFile(scene_file, &scene, &scene_data)) {
+            return 1;
+        }
+        SceneCamera camera = settings.override_camera ? settings.camera : scene_data.camera;
+        float fov = settings.fov > 0.0f ? settings.fov : camera.fov;
+
+        TextureAtlas textures;
+        for (const auto& texture : scene_data.textures) {
+            textures.AddTexture(texture.path, texture.mip_levels);
+        }
+
+        EnvironmentMap environment;
+        if (settings.environment_light) {
+            environment.Build(textures);
+        }
+
+        scene.BuildAccelerationStructures();
+        std::unique_ptr<CpuRenderer> cpu_renderer;
+        std::unique_ptr<GpuRenderer> gpu_renderer;
+        if (settings.use_cpu_renderer) {
+            scene.BuildCpuAccelerationStructures();
+            cpu_renderer = std::make_unique<CpuRenderer>(&scene, &textures);
+            cpu_renderer->SetLights(scene_data.point_lights, scene_data.area_lights);
+            cpu_renderer->SetLightSelection(settings.light_selection);
+            cpu_renderer->SetEnvironment(&environment);
+            cpu_renderer->SetEnvironmentLight(settings.environment_light);
+            cpu_renderer->SetSamplerType(settings.sampler_type);
+            cpu_renderer->SetSampleOffset(settings.sample_offset);
+        } else {
+            scene.BuildVertexIndexData();
+            gpu_renderer = std::make_unique<GpuRenderer>(core.get(), &scene, &textures);
+            gpu_renderer->SetLights(scene_data.point_lights, scene_data.area_lights);
+            gpu_renderer->SetLightSelection(settings.light_selection);
+            gpu_renderer->SetEnvironment(environment);
+            gpu_renderer->SetEnvironmentLight(settings.environment_light);
+            gpu_renderer->SetSamplerType(settings.sampler_type);
+            gpu_renderer->SetSampleOffset(settings.sample_offset);
+            gpu_renderer->Resize(settings.width, settings.height);
+            gpu_renderer->SetStatsCollection(settings.count_rays);
+        }
+
+        CameraObject camera_object = MakeSceneCameraObject(camera, fov, settings.width, settings.height);
+        if (gpu_renderer) {
+            gpu_renderer->SetCamera(camera_object);
+        }
+        Film film(core.get(), settings.width, settings.height);
+        film.SetAovs(settings.aovs);
+        if (core && !settings.resume.empty()) {
+            core->WaitGPU(); // The film's clear must land before the download
+        }
+        for (const auto& snapshot : settings.resume) {
+            if (!MergeFilmSnapshot(snapshot, &film)) {
+                return 1;
+            }
+        }
+        std::unique_ptr<AdaptiveScheduler> scheduler;
+        if (settings.noise_target > 0.0f) {
+            scheduler = std::make_unique<AdaptiveScheduler>(settings.width, settings.height, settings.noise_target);
+        }
+        grassland::LogInfo("Batch setup took {:.2f} s", SecondsSince(setup_start));
+
+        // With a time budget the GPU is drained after every sample so the
+        // clock measures finished work rather than queued dispatches
+        bool wait_each_sample = settings.time_budget > 0.0;
+        auto start = Clock::now();
+        auto last_report = start;
+        auto last_checkpoint = start;
+        FilmSnapshotWriter checkpoint_writer;
+        // Resumed passes count towards --spp; the throughput figures only cover this run
+        int samples = film.GetSampleCount();
+        double pixel_samples = 0.0;
+        while (settings.samples_per_pixel == 0 || samples < settings.samples_per_pixel) {
+            if (settings.time_budget > 0.0 && SecondsSince(start) >= settings.time_budget) {
+                break;
+            }
+            if (cpu_renderer) {
+                cpu_renderer->RenderSample(camera_object, &film);
+            } else {
+                std::unique_ptr<grassland::graphics::CommandContext> command_context;
+                core->CreateCommandContext(&command_context);
+                gpu_renderer->RenderSample(command_context.get(), &film);
+                core->SubmitCommandContext(command_context.get());
+                if (wait_each_sample) {
+                    core->WaitGPU();
+                }
+            }
+            film.IncrementSampleCount();
+            samples++;
+            pixel_samples += scheduler ? static_cast<double>(scheduler->GetActivePixelCount())
+                                       : static_cast<double>(settings.width) * settings.height;
+
+            // Retire the tiles that reached the noise target; the rest keep sampling
+            if (scheduler && samples >= AdaptiveScheduler::kMinSamples &&
+                (samples - AdaptiveScheduler::kMinSamples) % kAdaptiveUpdateInterval == 0) {
+                if (core) {
+                    core->WaitGPU();
+                }
+                scheduler->Update(&film);
+                if (scheduler->IsConverged()) {
+                    grassland::LogInfo("Every tile reached relative error {} after {} passes", settings.noise_target,
+                                       samples);
+                    break;
+                }
+                // Each pass renders the remaining tiles in a single dispatch
+                TileScheduler& tile_scheduler = film.GetTileScheduler();
+                tile_scheduler.SetActiveTiles(scheduler->GetActiveTiles());
+                tile_scheduler.Reset();
+                const std::vector<uint32_t>& tiles = tile_scheduler.NextTiles(tile_scheduler.GetTileCount());
+                if (cpu_renderer) {
+                    cpu_renderer->SetTiles(tiles);
+                } else {
+                    gpu_renderer->SetTiles(tiles, tile_scheduler.GetTilesX());
+                }
+            }
+
+            // The snapshot is written in the background; a checkpoint that is
+            // due while the previous one is still being written waits a pass
+            if (!settings.checkpoint.empty() && SecondsSince(last_checkpoint) >= settings.checkpoint_interval &&
+                !checkpoint_writer.IsBusy()) {
+                if (core) {
+                    core->WaitGPU();
+                }
+                checkpoint_writer.Write(&film, settings.checkpoint, settings.checkpoint_half);
+                last_checkpoint = Clock::now();
+            }
+
+            if (std::chrono::duration<double>(Clock::now() - last_report).count() >= 5.0) {
+                last_report = Clock::now();
+                if (scheduler) {
+                    grassland::LogInfo("{} passes after {:.1f} s, {} of {} tiles active, max relative error {:.4f}",
+                                       samples, SecondsSince(start), scheduler->GetActiveTileCount(),
+                                       scheduler->GetActiveTiles().size(), scheduler->GetMaxError());
+                } else {
+                    grassland::LogInfo("{} samples per pixel after {:.1f} s", samples, SecondsSince(start));
+                }
+            }
+        }
+        if (core) {
+            core->WaitGPU();
+        }
+        double seconds = SecondsSince(start);
+        if (!settings.checkpoint.empty()) {
+            // A failed periodic checkpoint is replaced by this one
+            checkpoint_writer.Wait();
+            checkpoint_writer.Write(&film, settings.checkpoint, settings.checkpoint_half);
+        }
+
+        ImageExporter::Image image = ImageExporter::CaptureFilm(&film);
+        if (samples == 0) {
+            grassland::LogError("No samples rendered within the budget");
+            exit_code = 1;
+        } else if (!WriteRenderImage(settings.output, image.GetRenderData(), settings.hdr_options)) {
+            grassland::LogError("Failed to write {}", settings.output);
+            exit_code = 1;
+        } else {
+            grassland::LogInfo("Saved {} ({}x{}, {} samples per pixel)", settings.output, settings.width,
+                               settings.height, samples);
+        }
+
+        // With adaptive sampling spp is the mean over all pixels.
+        double spp = pixel_samples / (static_cast<double>(settings.width) * settings.height);
+        grassland::LogInfo("Batch render ({}): {:.1f} spp in {:.2f} s, {:.2f} spp/s, {:.2f} Msamples/s",
+                           settings.use_cpu_renderer ? "cpu" : "gpu", spp, seconds, spp / seconds,
+                           pixel_samples / seconds * 1e-6);
+        if (scheduler) {
+            grassland::LogInfo("Adaptive sampling: {} passes, {} of {} tiles converged, max relative error {:.4f} "
+                               "(target {})",
+                               samples, scheduler->GetActiveTiles().size() - scheduler->GetActiveTileCount(),
+                               scheduler->GetActiveTiles().size(), scheduler->GetMaxError(), settings.noise_target);
+        }
+        if (gpu_renderer && settings.count_rays) {
+            gpu_renderer->FlushRayStats();
+            const RayStats& stats = gpu_renderer->GetTotalStats();
+            double rays = static_cast<double>(stats.GetRayCount());
+            grassland::LogInfo("Batch render (gpu): {:.2f} rays per pixel sample, {:.2f} Mrays/s (all rays)",
+                               rays / pixel_samples, rays / seconds * 1e-6);
+            for (int i = 0; i < RayStats::kCounterCount; i++) {
+                grassland::LogInfo("  {}: {:.3f} per pixel sample", RayStats::GetCounterName(i),
+                                   stats.counters[i] / pixel_samples);
+            }
+            if (!settings.stats_output.empty()) {
+                std::ofstream file(settings.stats_output);
+                file << stats.ToJson(pixel_samples);
+                if (!file) {
+                    grassland::LogError("Failed to write {}", settings.stats_output);
+                    exit_code = 1;
+                } else {
+                    grassland::LogInfo("Saved ray statistics to {}", settings.stats_output);
+                }
+            }
+        } else if (settings.count_rays) {
+            grassland::LogWarning("Ray statistics are only collected by the GPU path");
+        }
+        if (!settings.checkpoint.empty()) {
+            if (checkpoint_writer.Wait()) {
+                grassland::LogInfo("Saved snapshot {}", settings.checkpoint);
+            } else {
+                exit_code = 1;
+            }
+        }
+    }
+    return exit_code;
+}
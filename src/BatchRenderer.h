@@ -0,0 +1,51 @@
+#pragma once
+#include "long_march.h"
+#include "Camera.h"
+#include "SceneLoader.h"
+#include "PathSampler.h"
+#include "ImageWriter.h"
+#include <string>
+#include <vector>
+
+// Options of the headless batch mode: ShortMarchDemo --batch [options]
+struct BatchSettings {
+    std::string scene_file;           // Empty: scenes/default.json
+    bool override_camera = false;     // Use camera instead of the scene file's
+    SceneCamera camera;
+    float fov = 0.0f;                 // Degrees; 0 keeps the camera's
+    int width = 1920;
+    int height = 1080;
+    int samples_per_pixel = 0;        // Stop after this many samples (0: no limit)
+    double time_budget = 0.0;         // Stop after this many seconds (0: no limit)
+    float noise_target = 0.0f;        // Adaptive sampling: stop once every tile's relative error is below this (0: off)
+    std::string output = "render.png";
+    bool use_cpu_renderer = false;    // CPU path; needs no graphics device
+    int workers = 0;                  // CPU path: split the tiles across this many worker processes (0: in process)
+    bool count_rays = false;          // GPU path: collect ray statistics, not just camera rays
+    std::string stats_output;         // GPU path: write the ray statistics as JSON here (implies count_rays)
+    LightSelection light_selection = LightSelection::kBvh;
+    bool environment_light = false;   // Importance-sample the sky instead of the ambient term
+    SamplerType sampler_type = SamplerType::kSobol;
+    uint32_t sample_offset = 0;       // First sample index; give renders that are merged later disjoint ranges
+    std::string checkpoint;           // Write an accumulation snapshot here periodically and when done
+    double checkpoint_interval = 300.0; // Seconds between checkpoints
+    bool checkpoint_half = false;     // Half-precision snapshots (about 60% of the size)
+    std::vector<std::string> resume;  // Snapshots summed into the film before rendering
+    uint32_t aovs = 0;                // .exr/.pfm/.hdr outputs: Film::Aov layers to render and write
+    HdrWriteOptions hdr_options;      // .exr outputs: channel precision and compression
+    grassland::graphics::BackendAPI api = grassland::graphics::BACKEND_API_DEFAULT;
+};
+
+// Parse the arguments following --batch. Logs and returns false on bad input.
+bool ParseBatchSettings(const std::vector<std::string>& args, BatchSettings* settings);
+
+// Arguments that reproduce settings' scene, view and sampling options through
+// ParseBatchSettings, for handing a render to a worker process
+std::vector<std::string> FormatBatchSettings(const BatchSettings& settings);
+
+// Camera matrices for a scene camera at the given resolution
+CameraObject MakeSceneCameraObject(const SceneCamera& camera, float fov, int width, int height);
+
+// Render the scene without a window until the sample, time or noise budget
+// is spent, write the image and report throughput. Returns the process exit code.
+int RunBatch(const BatchSettings& settings);
@@ -0,0 +1,839 @@
+#include "Benchmark.h"
+#include "AliasTable.h"
+#include "DistributedRenderer.h"
+#include "Entity.h"
+#include "EnvironmentMap.h"
+#include "Film.h"
+#include "ImageExporter.h"
+#include "ImageWriter.h"
+#include "LightBvh.h"
+#include "PathSampler.h"
+#include "Scene.h"
+#include "SceneLoader.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Random rays from a sphere around the mesh towards random points inside its bounds
+std::vector<Ray> GenerateRays(const glm::vec3& bounds_min, const glm::vec3& bounds_max, size_t count) {
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+    float radius = glm::length(bounds_max - bounds_min);
+    std::vector<Ray> rays(count);
+    for (auto& ray : rays) {
+        float z = 1.0f - 2.0f * uniform(rng);
+        float phi = 6.28318530718f * uniform(rng);
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        glm::vec3 origin = center + radius * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+        glm::vec3 target = bounds_min + (bounds_max - bounds_min) * glm::vec3(uniform(rng), uniform(rng), uniform(rng));
+        ray.origin = origin;
+        ray.direction = glm::normalize(target - origin);
+        ray.tmin = 0.001f;
+        ray.tmax = 10000.0f;
+    }
+    return rays;
+}
+
+int BenchmarkBvh(const std::vector<std::string>& args) {
+    std::vector<std::string> meshes = { "meshes/bunny.obj", "meshes/happy.obj", "meshes/teapot.obj" };
+    if (!args.empty()) {
+        meshes = args;
+    }
+    // A cached mesh comes with its BVH already built; measure the real build
+    MeshCache::Global().SetCacheDirectory("");
+    const size_t ray_count = 1 << 20;
+    ThreadPool& pool = ThreadPool::Global();
+
+    for (const auto& mesh : meshes) {
+        Entity entity(mesh);
+        if (!entity.IsValid()) {
+            continue;
+        }
+        auto build_start = Clock::now();
+        entity.BuildBVH();
+        double build_seconds = SecondsSince(build_start);
+        const Bvh& bvh = entity.GetBVH();
+        std::vector<Ray> rays = GenerateRays(bvh.GetBoundsMin(), bvh.GetBoundsMax(), ray_count);
+
+        // Single thread
+        size_t hits = 0;
+        auto start = Clock::now();
+        for (const auto& ray : rays) {
+            TriangleHit hit;
+            hits += bvh.Intersect(ray, &hit) ? 1 : 0;
+        }
+        double single_seconds = SecondsSince(start);
+
+        // All threads, in chunks so the counter is not contended
+        const size_t chunk = 4096;
+        std::atomic<size_t> parallel_hits{ 0 };
+        start = Clock::now();
+        pool.ParallelFor((rays.size() + chunk - 1) / chunk, [&](size_t c) {
+            size_t local_hits = 0;
+            size_t end = std::min(rays.size(), (c + 1) * chunk);
+            for (size_t i = c * chunk; i < end; ++i) {
+                TriangleHit hit;
+                local_hits += bvh.Intersect(rays[i], &hit) ? 1 : 0;
+            }
+            parallel_hits += local_hits;
+        });
+        double parallel_seconds = SecondsSince(start);
+
+        grassland::LogInfo("[bvh] {}: {} triangles, build {:.3f} s, {} nodes, {} leaf blocks",
+                           mesh, entity.GetIndexCount() / 3, build_seconds, bvh.GetNodeCount(),
+                           bvh.GetTriangleBlockCount());
+        grassland::LogInfo("[bvh] {}: {:.2f} Mrays/s (1 thread), {:.2f} Mrays/s ({} threads), hit rate {:.1f}%",
+                           mesh, rays.size() / single_seconds * 1e-6, rays.size() / parallel_seconds * 1e-6,
+                           pool.GetThreadCount() + 1, 100.0 * hits / rays.size());
+    }
+    return 0;
+}
+
+// What BuildVertexIndexData did before the two-pass flatten: a temporary
+// position vector per entity and unreserved appends
+void LegacyFlatten(const Scene& scene, std::vector<float>* all_vertices, std::vector<uint32_t>* all_indices) {
+    uint32_t vertex_offset = 0;
+    for (const auto& entity : scene.GetEntities()) {
+        std::vector<float> positions = entity->GetMeshPositionsAsFloatArray();
+        const uint32_t* indices = entity->GetMeshIndices();
+        uint32_t index_count = entity->GetIndexCount();
+        all_vertices->insert(all_vertices->end(), positions.begin(), positions.end());
+        for (uint32_t i = 0; i < index_count; i++) {
+            all_indices->push_back(indices[i] + vertex_offset);
+        }
+        vertex_offset += entity->GetVertexCount();
+    }
+}
+
+// Regular grid in the xz plane with roughly triangle_count triangles
+std::shared_ptr<MeshResource> MakeGridMesh(const std::string& name, uint32_t triangle_count) {
+    uint32_t cells = std::max(1u, static_cast<uint32_t>(std::sqrt(triangle_count / 2.0)));
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    positions.reserve(static_cast<size_t>(cells + 1) * (cells + 1));
+    indices.reserve(static_cast<size_t>(cells) * cells * 6);
+    for (uint32_t z = 0; z <= cells; ++z) {
+        for (uint32_t x = 0; x <= cells; ++x) {
+            positions.emplace_back(float(x) / cells, 0.0f, float(z) / cells);
+        }
+    }
+    for (uint32_t z = 0; z < cells; ++z) {
+        for (uint32_t x = 0; x < cells; ++x) {
+            uint32_t i = z * (cells + 1) + x;
+            uint32_t quad[6] = { i, i + cells + 1, i + 1, i + 1, i + cells + 1, i + cells + 2 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    return std::make_shared<MeshResource>(name, std::move(positions), std::move(indices));
+}
+
+void ReportFlatten(const std::string& label, const Scene& scene) {
+    std::vector<float> legacy_vertices;
+    std::vector<uint32_t> legacy_indices;
+    auto start = Clock::now();
+    LegacyFlatten(scene, &legacy_vertices, &legacy_indices);
+    double legacy_seconds = SecondsSince(start);
+
+    Scene::FlattenedGeometry geometry;
+    start = Clock::now();
+    scene.FlattenGeometry(&geometry);
+    double flatten_seconds = SecondsSince(start);
+
+    grassland::LogInfo("[flatten] {}: {} entities, {} meshes", label, scene.GetEntityCount(), geometry.mesh_count);
+    grassland::LogInfo("[flatten] {}: per-entity copy {:.1f} ms ({:.1f} MB), two-pass {:.1f} ms ({:.1f} MB), {:.2f}x",
+                       label, legacy_seconds * 1e3,
+                       (legacy_vertices.size() * sizeof(float) + legacy_indices.size() * sizeof(uint32_t)) / 1048576.0,
+                       flatten_seconds * 1e3,
+                       (geometry.vertex_count * 3 * sizeof(float) + geometry.index_count * sizeof(uint32_t)) / 1048576.0,
+                       legacy_seconds / flatten_seconds);
+}
+
+int BenchmarkFlatten(const std::vector<std::string>& args) {
+    size_t synthetic_triangles = 10000000;
+    if (!args.empty()) {
+        synthetic_triangles = std::stoull(args[0]);
+    }
+
+    {
+        Scene scene(nullptr);
+        SceneFileData data;
+        if (!LoadSceneFile(GetDefaultSceneDirectory() + "/default.json", &scene, &data)) {
+            return 1;
+        }
+        scene.BuildAccelerationStructures(); // Headless: only waits for the loads
+        ReportFlatten("default scene", scene);
+    }
+
+    // Synthetic: distinct meshes, so sharing does not shrink the work
+    {
+        const uint32_t kMeshCount = 100;
+        Scene scene(nullptr);
+        for (uint32_t i = 0; i < kMeshCount; ++i) {
+            auto mesh = MakeGridMesh("grid" + std::to_string(i), static_cast<uint32_t>(synthetic_triangles / kMeshCount));
+            scene.AddEntity(std::make_shared<Entity>(mesh));
+        }
+        scene.BuildAccelerationStructures();
+        ReportFlatten(std::to_string(synthetic_triangles) + " triangle scene", scene);
+    }
+    return 0;
+}
+
+// Scene file with instance_count cubes on a grid, each with its own inline material
+void WriteSyntheticScene(const std::string& path, size_t instance_count) {
+    std::ofstream file(path);
+    file << "{\n    \"camera\": { \"position\": [0, 50, 100] },\n";
+    file << "    \"materials\": { \"grey\": { \"base_color\": [0.5, 0.5, 0.5], \"roughness\": 0.6 } },\n";
+    file << "    \"entities\": [\n";
+    size_t side = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(instance_count))));
+    for (size_t i = 0; i < instance_count; ++i) {
+        file << "        { \"mesh\": \"meshes/cube.obj\", ";
+        if (i % 2 == 0) {
+            file << "\"material\": \"grey\", ";
+        } else {
+            file << "\"material\": { \"base_color\": [" << (i % 7) / 7.0 << ", 0.5, 0.5], \"metallic\": 0.5 }, ";
+        }
+        file << "\"translate\": [" << (i % side) * 3.0 << ", 0, " << (i / side) * 3.0 << "], ";
+        file << "\"rotate\": [0, " << (i % 360) << ", 0], \"scale\": 0.5 }";
+        file << (i + 1 < instance_count ? ",\n" : "\n");
+    }
+    file << "    ]\n}\n";
+}
+
+int BenchmarkScene(const std::vector<std::string>& args) {
+    std::vector<size_t> counts = { 1000, 10000, 100000 };
+    if (!args.empty()) {
+        counts.clear();
+        for (const auto& arg : args) {
+            counts.push_back(std::stoull(arg));
+        }
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "shortmarch_scene_benchmark";
+    std::filesystem::create_directories(directory);
+    for (size_t count : counts) {
+        std::string path = (directory / ("instances_" + std::to_string(count) + ".json")).string();
+        WriteSyntheticScene(path, count);
+        double megabytes = std::filesystem::file_size(path) / 1048576.0;
+
+        Scene scene(nullptr);
+        SceneFileData data;
+        auto start = Clock::now();
+        bool loaded = LoadSceneFile(path, &scene, &data);
+        double seconds = SecondsSince(start);
+        std::filesystem::remove(path);
+        if (!loaded) {
+            return 1;
+        }
+        grassland::LogInfo("[scene] {} instances ({:.1f} MB): {:.1f} ms, {:.0f} instances/s, {:.1f} MB/s",
+                           data.entity_count, megabytes, seconds * 1e3, data.entity_count / seconds,
+                           megabytes / seconds);
+    }
+    std::filesystem::remove(directory);
+    return 0;
+}
+
+// What Film::DevelopToOutput did on the host before tiling: one thread,
+// one scalar divide per channel
+void LegacyDevelop(const float* accumulated, float* output, size_t pixel_count, int sample_count) {
+    for (size_t i = 0; i < pixel_count * 4; i++) {
+        output[i] = accumulated[i] / static_cast<float>(sample_count);
+    }
+}
+
+int BenchmarkDevelop(const std::vector<std::string>& args) {
+    int width = 2000;
+    int height = 1414;
+    bool use_gpu = false;
+    std::vector<int> sizes;
+    for (const auto& arg : args) {
+        if (arg == "gpu") {
+            use_gpu = true;
+        } else {
+            sizes.push_back(std::stoi(arg));
+        }
+    }
+    if (sizes.size() == 2) {
+        width = sizes[0];
+        height = sizes[1];
+    }
+    const int kIterations = 50;
+    size_t pixel_count = static_cast<size_t>(width) * height;
+
+    // Host: legacy scalar loop against the tiled SIMD develop of a headless film
+    {
+        Film film(nullptr, width, height);
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> uniform(0.0f, 16.0f);
+        float* accumulated = film.GetHostAccumulatedColor();
+        int32_t* samples = film.GetHostAccumulatedSamples();
+        for (size_t i = 0; i < pixel_count; i++) {
+            for (int c = 0; c < 4; c++) {
+                accumulated[i * 4 + c] = uniform(rng);
+            }
+            samples[i] = 16;
+        }
+
+        std::vector<float> legacy_output(pixel_count * 4);
+        auto start = Clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            LegacyDevelop(accumulated, legacy_output.data(), pixel_count, 16);
+        }
+        double legacy_seconds = SecondsSince(start) / kIterations;
+
+        start = Clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            film.IncrementSampleCount();
+            film.DevelopToOutput();
+        }
+        double tiled_seconds = SecondsSince(start) / kIterations;
+
+        // Same sample count as the last develop: nothing to do
+        start = Clock::now();
+        for (int i = 0; i < kIterations; i++) {
+            film.DevelopToOutput();
+        }
+        double skipped_seconds = SecondsSince(start) / kIterations;
+
+        grassland::LogInfo("[develop] host {}x{}: scalar {:.2f} ms, tiled SIMD {:.2f} ms ({} threads, {:.2f}x), "
+                           "unchanged {:.4f} ms",
+                           width, height, legacy_seconds * 1e3, tiled_seconds * 1e3,
+                           ThreadPool::Global().GetThreadCount() + 1, legacy_seconds / tiled_seconds,
+                           skipped_seconds * 1e3);
+    }
+
+    // Device: compute pass against the download / divide / upload round trip
+    if (use_gpu) {
+        std::shared_ptr<grassland::graphics::Core> core;
+        grassland::graphics::CreateCore(grassland::graphics::BACKEND_API_DEFAULT,
+                                        grassland::graphics::Core::Settings{}, &core);
+        core->InitializeLogicalDeviceAutoSelect(false);
+        {
+            Film film(core.get(), width, height);
+            if (!film.IsDeviceDevelop()) {
+                grassland::LogError("[develop] compute pass unavailable on {}", core->DeviceName());
+                return 1;
+            }
+            double seconds[2];
+            for (int mode = 0; mode < 2; mode++) {
+                film.SetDeviceDevelop(mode == 0);
+                auto start = Clock::now();
+                for (int i = 0; i < kIterations; i++) {
+                    film.IncrementSampleCount();
+                    film.DevelopToOutput();
+                    core->WaitGPU();
+                }
+                seconds[mode] = SecondsSince(start) / kIterations;
+            }
+            grassland::LogInfo("[develop] {} {}x{}: compute pass {:.2f} ms, host round trip {:.2f} ms ({:.1f} MB moved), "
+                               "{:.2f}x",
+                               core->DeviceName(), width, height, seconds[0] * 1e3, seconds[1] * 1e3,
+                               pixel_count * (4 * sizeof(float) * 2 + sizeof(int32_t)) / 1048576.0,
+                               seconds[1] / seconds[0]);
+        }
+    }
+    return 0;
+}
+
+// Unshadowed diffuse irradiance at a point on the ground; area lights are
+// treated as a point at their center, enough to compare the estimators
+float LightIrradiance(const glm::vec3& position, uint32_t code, const std::vector<PointLight>& point_lights,
+                      const std::vector<AreaLight>& area_lights) {
+    uint32_t index = code & LightBvh::kLightIndexMask;
+    glm::vec3 light_position = (code & LightBvh::kAreaLightFlag) ? area_lights[index].center : point_lights[index].position;
+    float intensity = (code & LightBvh::kAreaLightFlag) ? area_lights[index].intensity : point_lights[index].intensity;
+    glm::vec3 offset = light_position - position;
+    float distance2 = glm::dot(offset, offset);
+    float ndotl = std::max(0.0f, offset.y / std::sqrt(distance2));
+    return intensity * ndotl / (distance2 + 0.001f);
+}
+
+int BenchmarkLights(const std::vector<std::string>& args) {
+    std::vector<size_t> counts = { 16, 256, 4096, 65536 };
+    if (!args.empty()) {
+        counts.clear();
+        for (const auto& arg : args) {
+            counts.push_back(std::stoull(arg));
+        }
+    }
+    const size_t kSampleCount = 1 << 20;
+    const size_t kReferencePoints = 1024;
+    const int kReferenceSamples = 256;
+
+    for (size_t count : counts) {
+        // Half point lights, half area lights, scattered over a 100 x 100 ceiling
+        std::mt19937 rng(12345);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::vector<PointLight> point_lights;
+        std::vector<AreaLight> area_lights;
+        for (size_t i = 0; i < count; ++i) {
+            glm::vec3 position(uniform(rng) * 100.0f - 50.0f, 8.0f + uniform(rng) * 4.0f, uniform(rng) * 100.0f - 50.0f);
+            glm::vec3 color(0.5f + 0.5f * uniform(rng), 0.5f + 0.5f * uniform(rng), 0.5f + 0.5f * uniform(rng));
+            float intensity = 10.0f + 90.0f * uniform(rng);
+            if (i % 2 == 0) {
+                point_lights.emplace_back(position, color, intensity);
+            } else {
+                area_lights.emplace_back(position, glm::vec3(0, -1, 0), glm::vec3(1, 0, 0), 1.0f, 1.0f, color,
+                                         intensity);
+            }
+        }
+        std::vector<glm::vec3> points(kSampleCount);
+        for (auto& point : points) {
+            point = glm::vec3(uniform(rng) * 100.0f - 50.0f, 0.0f, uniform(rng) * 100.0f - 50.0f);
+        }
+
+        LightBvh bvh;
+        auto start = Clock::now();
+        bvh.Build(point_lights, area_lights);
+        double build_seconds = SecondsSince(start);
+
+        // Cost of picking one light per shading point
+        float checksum = 0.0f;
+        start = Clock::now();
+        for (size_t i = 0; i < points.size(); ++i) {
+            float pdf;
+            uint32_t code = bvh.Sample(points[i], uniform(rng), &pdf);
+            checksum += pdf > 0.0f ? LightIrradiance(points[i], code, point_lights, area_lights) / pdf : 0.0f;
+        }
+        double sample_seconds = SecondsSince(start);
+
+        // Power alias table: constant cost, but blind to distance
+        AliasTable power_table;
+        power_table.Build(LightBvh::GetPowers(point_lights, area_lights));
+        auto power_sample = [&](const glm::vec3& point, float u, float* pdf) {
+            uint32_t index = power_table.Sample(u, pdf);
+            return index < point_lights.size()
+                       ? LightBvh::kLeafFlag | index
+                       : LightBvh::kLeafFlag | LightBvh::kAreaLightFlag | static_cast<uint32_t>(index - point_lights.size());
+        };
+        start = Clock::now();
+        for (size_t i = 0; i < points.size(); ++i) {
+            float pdf;
+            uint32_t code = power_sample(points[i], uniform(rng), &pdf);
+            checksum += pdf > 0.0f ? LightIrradiance(points[i], code, point_lights, area_lights) / pdf : 0.0f;
+        }
+        double power_seconds = SecondsSince(start);
+
+        // Cost of the loop over every light they replace, on a subset of points
+        std::vector<double> exact(kReferencePoints, 0.0);
+        start = Clock::now();
+        for (size_t i = 0; i < kReferencePoints; ++i) {
+            for (size_t l = 0; l < point_lights.size(); ++l) {
+                exact[i] += LightIrradiance(points[i], LightBvh::kLeafFlag | static_cast<uint32_t>(l), point_lights,
+                                            area_lights);
+            }
+            for (size_t l = 0; l < area_lights.size(); ++l) {
+                exact[i] += LightIrradiance(points[i],
+                                            LightBvh::kLeafFlag | LightBvh::kAreaLightFlag | static_cast<uint32_t>(l),
+                                            point_lights, area_lights);
+            }
+        }
+        double loop_seconds = SecondsSince(start);
+
+        // Both estimators must converge to the full sum; the relative RMSE
+        // of a single sample shows how well each one follows the lighting
+        double exact_total = 0.0;
+        double estimate_total[2] = {};
+        double squared_error[2] = {};
+        for (size_t i = 0; i < kReferencePoints; ++i) {
+            exact_total += exact[i];
+            for (int s = 0; s < kReferenceSamples; ++s) {
+                for (int method = 0; method < 2; ++method) {
+                    float pdf;
+                    uint32_t code = method == 0 ? bvh.Sample(points[i], uniform(rng), &pdf)
+                                                : power_sample(points[i], uniform(rng), &pdf);
+                    double estimate = pdf > 0.0f ? LightIrradiance(points[i], code, point_lights, area_lights) / pdf : 0.0;
+                    estimate_total[method] += estimate / kReferenceSamples;
+                    squared_error[method] += (estimate - exact[i]) * (estimate - exact[i]) / kReferenceSamples;
+                }
+            }
+        }
+        auto bias = [&](int method) {
+            return 100.0 * std::fabs(estimate_total[method] - exact_total) / std::max(exact_total, 1e-12);
+        };
+        auto rmse = [&](int method) {
+            return std::sqrt(squared_error[method] / kReferencePoints) / std::max(exact_total / kReferencePoints, 1e-12);
+        };
+
+        grassland::LogInfo("[lights] {} lights: all lights {:.0f} ns/point (checksum {:.1f})", count,
+                           loop_seconds / kReferencePoints * 1e9, checksum / points.size());
+        grassland::LogInfo("[lights]   BVH: build {:.2f} ms, {} nodes, {:.0f} ns/point, bias {:.2f}%, relative RMSE {:.2f}",
+                           build_seconds * 1e3, bvh.GetNodes().size(), sample_seconds / points.size() * 1e9, bias(0),
+                           rmse(0));
+        grassland::LogInfo("[lights]   power alias table: {:.0f} ns/point, bias {:.2f}%, relative RMSE {:.2f}",
+                           power_seconds / points.size() * 1e9, bias(1), rmse(1));
+    }
+    return 0;
+}
+
+int BenchmarkEnvironment(const std::vector<std::string>& args) {
+    std::vector<int> sample_counts = { 1, 4, 16, 64, 256 };
+    if (!args.empty()) {
+        sample_counts.clear();
+        for (const auto& arg : args) {
+            sample_counts.push_back(std::stoi(arg));
+        }
+    }
+    const float kPi = 3.14159265358979323846f;
+    const size_t kNormalCount = 64;
+    const int kTrials = 16;
+
+    Scene scene(nullptr);
+    SceneFileData data;
+    if (!LoadSceneFile(GetDefaultSceneDirectory() + "/default.json", &scene, &data)) {
+        return 1;
+    }
+    TextureAtlas textures;
+    for (const auto& texture : data.textures) {
+        textures.AddTexture(texture.path, texture.mip_levels);
+    }
+    EnvironmentMap environment;
+    auto start = Clock::now();
+    if (!environment.Build(textures)) {
+        grassland::LogError("[environment] The default scene has no sky texture {}", EnvironmentMap::kTextureIndex);
+        return 1;
+    }
+    double build_seconds = SecondsSince(start);
+    const uint32_t width = environment.GetWidth();
+    const uint32_t height = environment.GetHeight();
+    grassland::LogInfo("[environment] {}x{} sky: tables built in {:.1f} ms ({} threads)", width, height,
+                       build_seconds * 1e3, ThreadPool::Global().GetThreadCount() + 1);
+
+    // Unshadowed diffuse irradiance / pi for random normals; the reference sums every texel
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::vector<glm::vec3> normals(kNormalCount);
+    for (auto& normal : normals) {
+        float z = 1.0f - 2.0f * uniform(rng);
+        float phi = 2.0f * kPi * uniform(rng);
+        float r = std::sqrt(std::max(0.0f, 1.0f - z * z));
+        normal = glm::vec3(r * std::cos(phi), z, r * std::sin(phi));
+    }
+    auto radiance = [&](const glm::vec3& direction) {
+        glm::vec3 color = textures.Sample(EnvironmentMap::kTextureIndex, EnvironmentMap::DirectionToUv(direction));
+        return 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+    };
+    std::vector<double> reference(kNormalCount, 0.0);
+    start = Clock::now();
+    ThreadPool::Global().ParallelFor(kNormalCount, [&](size_t i) {
+        double sum = 0.0;
+        for (uint32_t y = 0; y < height; ++y) {
+            float v = (y + 0.5f) / height;
+            float solid_angle = (2.0f * kPi / width) * (kPi / height) * std::cos((0.5f - v) * kPi);
+            for (uint32_t x = 0; x < width; ++x) {
+                glm::vec3 direction = EnvironmentMap::UvToDirection(glm::vec2((x + 0.5f) / width, v));
+                float cosine = glm::dot(normals[i], direction);
+                if (cosine > 0.0f) {
+                    sum += radiance(direction) * cosine * solid_angle;
+                }
+            }
+        }
+        reference[i] = sum / kPi;
+    });
+    double mean_reference = 0.0;
+    for (double value : reference) {
+        mean_reference += value / kNormalCount;
+    }
+    grassland::LogInfo("[environment] reference over {} normals: {:.1f} s, mean {:.4f}", kNormalCount,
+                       SecondsSince(start), mean_reference);
+
+    // One estimate = spp samples; RMSE over normals and trials, relative to the mean
+    for (int spp : sample_counts) {
+        double squared_error[2] = {};
+        for (size_t i = 0; i < kNormalCount; ++i) {
+            glm::vec3 tangent = std::fabs(normals[i].x) > 0.1f ? glm::normalize(glm::cross(normals[i], glm::vec3(0, 1, 0)))
+                                                               : glm::normalize(glm::cross(normals[i], glm::vec3(1, 0, 0)));
+            glm::vec3 bitangent = glm::cross(normals[i], tangent);
+            for (int trial = 0; trial < kTrials; ++trial) {
+                double estimate[2] = {};
+                for (int s = 0; s < spp; ++s) {
+                    // Cosine-weighted hemisphere: pdf = cos / pi, so L cos / pi / pdf = L
+                    float r = std::sqrt(uniform(rng));
+                    float phi = 2.0f * kPi * uniform(rng);
+                    glm::vec3 direction = r * std::cos(phi) * tangent + r * std::sin(phi) * bitangent +
+                                          std::sqrt(std::max(0.0f, 1.0f - r * r)) * normals[i];
+                    estimate[0] += radiance(direction) / spp;
+                    // Environment map importance sampling
+                    float pdf;
+                    direction = environment.Sample(glm::vec2(uniform(rng), uniform(rng)), &pdf);
+                    float cosine = glm::dot(normals[i], direction);
+                    if (pdf > 0.0f && cosine > 0.0f) {
+                        estimate[1] += radiance(direction) * cosine / (kPi * pdf) / spp;
+                    }
+                }
+                for (int method = 0; method < 2; ++method) {
+                    squared_error[method] += (estimate[method] - reference[i]) * (estimate[method] - reference[i]);
+                }
+            }
+        }
+        double rmse[2];
+        for (int method = 0; method < 2; ++method) {
+            rmse[method] = std::sqrt(squared_error[method] / (kNormalCount * kTrials)) / mean_reference;
+        }
+        grassland::LogInfo("[environment] {:4} spp: relative RMSE cosine {:.4f}, environment map {:.4f} ({:.1f}x)", spp,
+                           rmse[0], rmse[1], rmse[0] / std::max(rmse[1], 1e-12));
+    }
+    return 0;
+}
+
+int BenchmarkSampler(const std::vector<std::string>& args) {
+    std::vector<int> sample_counts = { 1, 4, 16, 64, 256 };
+    if (!args.empty()) {
+        sample_counts.clear();
+        for (const auto& arg : args) {
+            sample_counts.push_back(std::stoi(arg));
+        }
+    }
+    const int kSize = 64;
+    const SamplerType kTypes[] = { SamplerType::kRandom, SamplerType::kSobol, SamplerType::kBlueNoise };
+    const char* kTypeNames[] = { "random", "sobol", "blue noise" };
+    const uint32_t kLastDimension =
+        PathSampler::kPixelDimensions + (PathSampler::kMaxDepth + 1) * PathSampler::kDimensionsPerBounce;
+
+    // Each Sobol dimension must put one of the first 2^k samples into each
+    // of 2^k strata (the blue-noise shift keeps this only modulo 1)
+    auto start = Clock::now();
+    PathSampler::GetBlueNoiseMask();
+    grassland::LogInfo("[sampler] blue-noise mask: {:.1f} ms", SecondsSince(start) * 1e3);
+    {
+        const int t = 1;
+        uint32_t unstratified = 0;
+        for (uint32_t dimension = 0; dimension < kLastDimension; ++dimension) {
+            bool stratified = true;
+            for (int count : { 16, 256 }) {
+                std::vector<int> strata(count, 0);
+                for (int i = 0; i < count; ++i) {
+                    PathSampler sampler = PathSampler::ForCamera(kTypes[t], 5, 7, static_cast<uint32_t>(i));
+                    strata[static_cast<int>(sampler.Get(dimension) * count)]++;
+                }
+                stratified = stratified && std::count(strata.begin(), strata.end(), 0) == 0;
+            }
+            unstratified += stratified ? 0 : 1;
+        }
+        grassland::LogInfo("[sampler] {}: {} of {} dimensions stratified at 16 and 256 samples", kTypeNames[t],
+                           kLastDimension - unstratified, kLastDimension);
+    }
+
+    // RMSE over a kSize^2 pixel block integrating a disk (discontinuous) and
+    // a Gaussian (smooth) over two dimension pairs: the camera jitter and a
+    // light sample deep in the path. The neighbour correlation of the 1 spp
+    // error shows the blue-noise distribution (negative: errors alternate).
+    auto disk = [](float x, float y) { return (x - 0.5f) * (x - 0.5f) + (y - 0.5f) * (y - 0.5f) < 0.16f ? 1.0f : 0.0f; };
+    auto gaussian = [](float x, float y) { return std::exp(-8.0f * ((x - 0.5f) * (x - 0.5f) + (y - 0.5f) * (y - 0.5f))); };
+    const double disk_reference = 3.14159265358979 * 0.16;
+    const double gaussian_reference = 3.14159265358979 / 8.0 * std::pow(std::erf(0.5 * std::sqrt(8.0)), 2.0);
+    for (int t = 0; t < 3; ++t) {
+        for (int spp : sample_counts) {
+            double squared_error[2] = {};
+            std::vector<double> error(kSize * kSize);
+            for (int y = 0; y < kSize; ++y) {
+                for (int x = 0; x < kSize; ++x) {
+                    double disk_sum = 0.0;
+                    double gaussian_sum = 0.0;
+                    for (int s = 0; s < spp; ++s) {
+                        PathSampler camera = PathSampler::ForCamera(kTypes[t], x, y, s);
+                        PathSampler bounce = PathSampler::ForBounce(kTypes[t], x, y, s, 3);
+                        disk_sum += disk(camera.Get(0), camera.Get(1));
+                        gaussian_sum += gaussian(bounce.Get(PathSampler::kLightPosition),
+                                                 bounce.Get(PathSampler::kLightPosition + 1));
+                    }
+                    double disk_error = disk_sum / spp - disk_reference;
+                    double gaussian_error = gaussian_sum / spp - gaussian_reference;
+                    squared_error[0] += disk_error * disk_error;
+                    squared_error[1] += gaussian_error * gaussian_error;
+                    error[y * kSize + x] = disk_error;
+                }
+            }
+            double correlation = 0.0;
+            double variance = 0.0;
+            for (int y = 0; y < kSize; ++y) {
+                for (int x = 0; x < kSize; ++x) {
+                    double e = error[y * kSize + x];
+                    correlation += e * error[y * kSize + (x + 1) % kSize] + e * error[((y + 1) % kSize) * kSize + x];
+                    variance += 2.0 * e * e;
+                }
+            }
+            grassland::LogInfo("[sampler] {:>10} {:4} spp: RMSE disk {:.5f}, gaussian {:.5f}, neighbour correlation {:+.3f}",
+                               kTypeNames[t], spp, std::sqrt(squared_error[0] / (kSize * kSize)),
+                               std::sqrt(squared_error[1] / (kSize * kSize)), correlation / std::max(variance, 1e-30));
+        }
+    }
+    return 0;
+}
+
+// Render the default scene on the CPU with 1, 2, 4, ... worker processes
+// sharing one film; setup (scene loading in each worker) is not timed
+int BenchmarkDistributed(const std::vector<std::string>& args) {
+    int max_workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    int threads_per_worker = 1;
+    if (args.size() >= 1) max_workers = std::stoi(args[0]);
+    if (args.size() >= 2) threads_per_worker = std::stoi(args[1]);
+    if (max_workers <= 0 || threads_per_worker <= 0) {
+        grassland::LogError("Usage: --benchmark distributed [max_workers] [threads_per_worker]");
+        return 1;
+    }
+
+    BatchSettings settings;
+    settings.width = 320;
+    settings.height = 180;
+    settings.samples_per_pixel = 4;
+    settings.use_cpu_renderer = true;
+    const double pixel_samples = static_cast<double>(settings.width) * settings.height * settings.samples_per_pixel;
+    double single_seconds = 0.0;
+    for (int workers = 1; workers <= max_workers; workers *= 2) {
+        Film film(nullptr, settings.width, settings.height);
+        double seconds = 0.0;
+        if (!RenderDistributed(settings, workers, threads_per_worker, &film, &seconds)) {
+            return 1;
+        }
+        if (workers == 1) {
+            single_seconds = seconds;
+        }
+        grassland::LogInfo("[distributed] {} workers x {} threads: {:.3f} s, {:.2f} Msamples/s, speedup {:.2f}x",
+                           workers, threads_per_worker, seconds, pixel_samples / seconds * 1e-6,
+                           single_seconds / seconds);
+    }
+    return 0;
+}
+
+// What WriteAccumulatedPng converted with before: one thread, scalar
+void LegacyConvert(const float* accumulated, uint8_t* output, size_t pixel_count) {
+    for (size_t pixel = 0; pixel < pixel_count; pixel++) {
+        float samples = accumulated[pixel * 4 + 3];
+        float inv_samples = samples > 0.0f ? 1.0f / samples : 0.0f;
+        for (size_t c = 0; c < 4; c++) {
+            float value = accumulated[pixel * 4 + c] * inv_samples;
+            output[pixel * 4 + c] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, value)) * 255.0f);
+        }
+    }
+}
+
+// Screenshot export: 8-bit conversion, then how long the caller is blocked
+// by queueing kMaxInFlight exports against how long they take to finish
+int BenchmarkExport(const std::vector<std::string>& args) {
+    int width = 2000;
+    int height = 1414;
+    if (args.size() == 2) {
+        width = std::stoi(args[0]);
+        height = std::stoi(args[1]);
+    }
+    const int kIterations = 20;
+    size_t pixel_count = static_cast<size_t>(width) * height;
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> uniform(0.0f, 24.0f);
+    std::vector<float> accumulated(pixel_count * 4);
+    for (size_t i = 0; i < pixel_count; i++) {
+        for (int c = 0; c < 3; c++) {
+            accumulated[i * 4 + c] = uniform(rng);
+        }
+        accumulated[i * 4 + 3] = 16.0f;
+    }
+
+    std::vector<uint8_t> converted(pixel_count * 4);
+    auto start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        LegacyConvert(accumulated.data(), converted.data(), pixel_count);
+    }
+    double legacy_seconds = SecondsSince(start) / kIterations;
+    start = Clock::now();
+    for (int i = 0; i < kIterations; i++) {
+        ConvertAccumulatedToRgba8(accumulated.data(), pixel_count, converted.data());
+    }
+    double convert_seconds = SecondsSince(start) / kIterations;
+    grassland::LogInfo("[export] convert {}x{}: scalar {:.2f} ms, parallel SIMD {:.2f} ms ({:.2f}x)", width, height,
+                       legacy_seconds * 1e3, convert_seconds * 1e3, legacy_seconds / convert_seconds);
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    start = Clock::now();
+    std::string first_file = (directory / "shortmarch_export_0.png").string();
+    if (!WriteAccumulatedPng(first_file, accumulated.data(), width, height)) {
+        grassland::LogError("Failed to write {}", first_file);
+        return 1;
+    }
+    double sync_seconds = SecondsSince(start);
+    std::error_code error;
+    std::filesystem::remove(first_file, error);
+
+    // Float outputs of the beauty pass, streamed a block of scanlines at a time
+    std::vector<ImageLayer> layers = { MakeBeautyLayer(accumulated.data(), width) };
+    const std::pair<const char*, HdrWriteOptions> kHdrOutputs[] = {
+        { "exr", { true, ExrCompression::kNone } },
+        { "exr", { true, ExrCompression::kZip } },
+        { "exr", { false, ExrCompression::kZip } },
+        { "pfm", {} },
+        { "hdr", {} },
+    };
+    for (const auto& output : kHdrOutputs) {
+        std::filesystem::path file = directory / (std::string("shortmarch_export.") + output.first);
+        start = Clock::now();
+        if (!WriteHdrImage(file.string(), width, height, layers, output.second)) {
+            grassland::LogError("Failed to write {}", file.string());
+            return 1;
+        }
+        double seconds = SecondsSince(start);
+        grassland::LogInfo("[export] {} ({}, {}): {:.1f} ms, {:.1f} MB", output.first,
+                           output.second.half ? "half" : "float",
+                           output.second.compression == ExrCompression::kZip ? "zip" : "uncompressed", seconds * 1e3,
+                           std::filesystem::file_size(file, error) / 1e6);
+        std::filesystem::remove(file, error);
+    }
+
+    ImageExporter exporter;
+    double queue_seconds = 0.0;
+    start = Clock::now();
+    for (size_t i = 0; i < ImageExporter::kMaxInFlight; i++) {
+        // The copy stands in for the film download the app does
+        auto queue_start = Clock::now();
+        std::string file = (directory / ("shortmarch_export_" + std::to_string(i) + ".png")).string();
+        ImageExporter::Image image;
+        image.width = width;
+        image.height = height;
+        image.sample_count = 16;
+        image.accumulated_rgba = accumulated;
+        exporter.Export(file, std::move(image));
+        queue_seconds += SecondsSince(queue_start);
+    }
+    exporter.WaitAll();
+    double async_seconds = SecondsSince(start);
+    for (size_t i = 0; i < ImageExporter::kMaxInFlight; i++) {
+        std::filesystem::remove(directory / ("shortmarch_export_" + std::to_string(i) + ".png"), error);
+    }
+    grassland::LogInfo("[export] synchronous PNG {:.1f} ms; {} queued exports block the caller {:.2f} ms each, "
+                       "all done after {:.1f} ms",
+                       sync_seconds * 1e3, ImageExporter::kMaxInFlight, queue_seconds / ImageExporter::kMaxInFlight * 1e3,
+                       async_seconds * 1e3);
+    return 0;
+}
+
+} // namespace
+
+int RunBenchmark(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        grassland::LogError("Usage: --benchmark <bvh|flatten|scene|develop|lights|environment|sampler|distributed|export> [args...]");
+        return 1;
+    }
+    std::vector<std::string> rest(args.begin() + 1, args.end());
+    if (args[0] == "bvh") return BenchmarkBvh(rest);
+    if (args[0] == "flatten") return BenchmarkFlatten(rest);
+    if (args[0] == "scene") return BenchmarkScene(rest);
+    if (args[0] == "develop") return BenchmarkDevelop(rest);
+    if (args[0] == "lights") return BenchmarkLights(rest);
+    if (args[0] == "environment") return BenchmarkEnvironment(rest);
+    if (args[0] == "sampler") return BenchmarkSampler(rest);
+    if (args[0] == "distributed") return BenchmarkDistributed(rest);
+    if (args[0] == "export") return BenchmarkExport(rest);
+    grassland::LogError("Unknown benchmark: {}", args[0]);
+    return 1;
+}
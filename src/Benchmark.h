@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Command-line micro benchmarks: ShortMarchDemo --benchmark <name> [args...]
+// Returns the process exit code.
+int RunBenchmark(const std::vector<std::string>& args);
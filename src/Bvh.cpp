@@ -0,0 +1,547 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define BVH_USE_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr uint32_t kMaxLeafSize = Bvh::kWidth; // one triangle block per leaf
+constexpr uint32_t kMaxInstancesPerLeaf = 1;     // instances are expensive to enter
+constexpr int kBinCount = 16;
+constexpr float kTraversalCost = 1.0f;
+// Each 4-wide node on the path leaves at most three siblings pending, and a
+// path has no more wide nodes than the binary tree has levels
+constexpr int kStackSize = 3 * kBvhMaxDepth + 1;
+constexpr uint32_t kInvalidPrimitive = 0xFFFFFFFFu;
+
+struct Aabb {
+    glm::vec3 lo{ std::numeric_limits<float>::max() };
+    glm::vec3 hi{ -std::numeric_limits<float>::max() };
+
+    void Grow(const glm::vec3& p) {
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    void Grow(const Aabb& other) {
+        lo = glm::min(lo, other.lo);
+        hi = glm::max(hi, other.hi);
+    }
+    float HalfArea() const {
+        glm::vec3 d = hi - lo;
+        if (d.x < 0.0f) return 0.0f;
+        return d.x * d.y + d.y * d.z + d.z * d.x;
+    }
+};
+
+struct BinaryNode {
+    Aabb bounds;
+    uint32_t left;  // Children of interior nodes
+    uint32_t right;
+    uint32_t first; // Primitive range of leaves
+    uint32_t count; // 0 for interior nodes
+};
+
+// Binned SAH build over primitive bounds into a binary tree. The two
+// children of an interior node are always adjacent (right == left + 1).
+class BinaryBuilder {
+public:
+    BinaryBuilder(std::vector<Aabb> bounds, uint32_t max_leaf_size)
+        : order(bounds.size()), bounds_(std::move(bounds)), centroids_(bounds_.size()),
+          max_leaf_size_(max_leaf_size) {
+        uint32_t count = static_cast<uint32_t>(bounds_.size());
+        for (uint32_t i = 0; i < count; ++i) {
+            order[i] = i;
+            centroids_[i] = (bounds_[i].lo + bounds_[i].hi) * 0.5f;
+        }
+        nodes.reserve(count / 2 + 1);
+        nodes.emplace_back();
+        Split(0, 0, count, 0);
+    }
+
+    std::vector<BinaryNode> nodes;
+    std::vector<uint32_t> order;
+
+private:
+    void Split(uint32_t node_index, uint32_t first, uint32_t count, int depth) {
+        Aabb bounds, centroid_bounds;
+        for (uint32_t i = first; i < first + count; ++i) {
+            bounds.Grow(bounds_[order[i]]);
+            centroid_bounds.Grow(centroids_[order[i]]);
+        }
+        nodes[node_index].bounds = bounds;
+
+        if (count <= max_leaf_size_) {
+            MakeLeaf(node_index, first, count);
+            return;
+        }
+
+        uint32_t mid;
+        if (depth >= kBvhMaxSahDepth) {
+            // Degenerate input (e.g. nested or coincident primitives) would
+            // otherwise keep peeling off few primitives per level
+            mid = MedianSplit(centroid_bounds, first, count);
+        } else {
+            mid = SahSplit(centroid_bounds, first, count);
+        }
+
+        uint32_t left = (uint32_t)nodes.size();
+        nodes.emplace_back();
+        nodes.emplace_back();
+        nodes[node_index].left = left;
+        nodes[node_index].right = left + 1;
+        nodes[node_index].count = 0;
+        Split(left, first, mid - first, depth + 1);
+        Split(left + 1, mid, first + count - mid, depth + 1);
+    }
+
+    // Object median along the widest centroid axis: both halves get at most
+    // ceil(count / 2) primitives
+    uint32_t MedianSplit(const Aabb& centroid_bounds, uint32_t first, uint32_t count) {
+        glm::vec3 extent = centroid_bounds.hi - centroid_bounds.lo;
+        int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        uint32_t mid = first + count / 2;
+        std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+                         [&](uint32_t a, uint32_t b) { return centroids_[a][axis] < centroids_[b][axis]; });
+        return mid;
+    }
+
+    uint32_t SahSplit(const Aabb& centroid_bounds, uint32_t first, uint32_t count) {
+        float best_cost = std::numeric_limits<float>::max();
+        int best_axis = -1;
+        int best_bin = 0;
+        glm::vec3 extent = centroid_bounds.hi - centroid_bounds.lo;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (extent[axis] <= 0.0f) continue;
+            Aabb bins[kBinCount];
+            uint32_t bin_counts[kBinCount] = {};
+            float scale = kBinCount / extent[axis];
+            for (uint32_t i = first; i < first + count; ++i) {
+                uint32_t prim = order[i];
+                int bin = std::min(kBinCount - 1, (int)((centroids_[prim][axis] - centroid_bounds.lo[axis]) * scale));
+                bins[bin].Grow(bounds_[prim]);
+                bin_counts[bin]++;
+            }
+            // Sweep right-to-left, then evaluate every plane left-to-right
+            float right_area[kBinCount];
+            uint32_t right_count[kBinCount];
+            Aabb accumulated;
+            uint32_t accumulated_count = 0;
+            for (int b = kBinCount - 1; b > 0; --b) {
+                accumulated.Grow(bins[b]);
+                accumulated_count += bin_counts[b];
+                right_area[b] = accumulated.HalfArea();
+                right_count[b] = accumulated_count;
+            }
+            accumulated = Aabb();
+            accumulated_count = 0;
+            for (int b = 0; b < kBinCount - 1; ++b) {
+                accumulated.Grow(bins[b]);
+                accumulated_count += bin_counts[b];
+                if (accumulated_count == 0 || right_count[b + 1] == 0) continue;
+                float cost = accumulated.HalfArea() * accumulated_count + right_area[b + 1] * right_count[b + 1];
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+
+        uint32_t mid;
+        if (best_axis < 0) {
+            // All centroids coincide; any split is as good as another
+            mid = first + count / 2;
+        } else {
+            float scale = kBinCount / extent[best_axis];
+            float lo = centroid_bounds.lo[best_axis];
+            auto it = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32_t prim) {
+                int bin = std::min(kBinCount - 1, (int)((centroids_[prim][best_axis] - lo) * scale));
+                return bin <= best_bin;
+            });
+            mid = (uint32_t)(it - order.begin());
+            if (mid == first || mid == first + count) mid = first + count / 2;
+        }
+        return mid;
+    }
+
+    void MakeLeaf(uint32_t node_index, uint32_t first, uint32_t count) {
+        nodes[node_index].first = first;
+        nodes[node_index].count = count;
+    }
+
+    std::vector<Aabb> bounds_;
+    std::vector<glm::vec3> centroids_;
+    uint32_t max_leaf_size_;
+};
+
+// Ray data broadcast for the 4-wide kernels
+struct TraversalRay {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 inv_direction;
+};
+
+float SafeInverse(float x) {
+    const float kEpsilon = 1e-20f;
+    if (std::fabs(x) < kEpsilon) x = x < 0.0f ? -kEpsilon : kEpsilon;
+    return 1.0f / x;
+}
+
+#ifdef BVH_USE_SSE
+
+// Returns the mask of children whose box is entered before tmax
+int IntersectChildren(const Bvh::Node& node, const TraversalRay& ray, float tmin, float tmax, float tnear[4]) {
+    const __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    const __m128 ix = _mm_set1_ps(ray.inv_direction.x), iy = _mm_set1_ps(ray.inv_direction.y),
+                 iz = _mm_set1_ps(ray.inv_direction.z);
+    __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_min_x), ox), ix);
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_max_x), ox), ix);
+    __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_min_y), oy), iy);
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_max_y), oy), iy);
+    __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_min_z), oz), iz);
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.bounds_max_z), oz), iz);
+    __m128 t_enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+                                _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_set1_ps(tmin)));
+    __m128 t_exit = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+                               _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_set1_ps(tmax)));
+    _mm_storeu_ps(tnear, t_enter);
+    return _mm_movemask_ps(_mm_cmple_ps(t_enter, t_exit));
+}
+
+// Returns the lane of the closest triangle hit in (tmin, *tmax), or -1
+int IntersectBlock(const Bvh::TriangleBlock& block, const TraversalRay& ray, float tmin, float* tmax) {
+    const __m128 dx = _mm_set1_ps(ray.direction.x), dy = _mm_set1_ps(ray.direction.y),
+                 dz = _mm_set1_ps(ray.direction.z);
+    const __m128 e1x = _mm_loadu_ps(block.e1_x), e1y = _mm_loadu_ps(block.e1_y), e1z = _mm_loadu_ps(block.e1_z);
+    const __m128 e2x = _mm_loadu_ps(block.e2_x), e2y = _mm_loadu_ps(block.e2_y), e2z = _mm_loadu_ps(block.e2_z);
+
+    // p = d x e2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+    __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 abs_det = _mm_andnot_ps(_mm_set1_ps(-0.0f), det);
+    __m128 valid = _mm_cmpgt_ps(abs_det, _mm_set1_ps(1e-12f));
+    __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+    // s = o - v0
+    __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(block.v0_x));
+    __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(block.v0_y));
+    __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(block.v0_z));
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inv_det);
+
+    // q = s x e1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inv_det);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inv_det);
+
+    const __m128 zero = _mm_setzero_ps();
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(u, zero));
+    valid = _mm_and_ps(valid, _mm_cmpge_ps(v, zero));
+    valid = _mm_and_ps(valid, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+    valid = _mm_and_ps(valid, _mm_cmpgt_ps(t, _mm_set1_ps(tmin)));
+    valid = _mm_and_ps(valid, _mm_cmplt_ps(t, _mm_set1_ps(*tmax)));
+    int mask = _mm_movemask_ps(valid);
+    if (mask == 0) return -1;
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, t);
+    int best = -1;
+    for (int i = 0; i < 4; ++i) {
+        if ((mask >> i) & 1 && lanes[i] < *tmax) {
+            *tmax = lanes[i];
+            best = i;
+        }
+    }
+    return best;
+}
+
+#else
+
+int IntersectChildren(const Bvh::Node& node, const TraversalRay& ray, float tmin, float tmax, float tnear[4]) {
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        glm::vec3 lo(node.bounds_min_x[i], node.bounds_min_y[i], node.bounds_min_z[i]);
+        glm::vec3 hi(node.bounds_max_x[i], node.bounds_max_y[i], node.bounds_max_z[i]);
+        float t_enter = tmin, t_exit = tmax;
+        for (int axis = 0; axis < 3; ++axis) {
+            float t0 = (lo[axis] - ray.origin[axis]) * ray.inv_direction[axis];
+            float t1 = (hi[axis] - ray.origin[axis]) * ray.inv_direction[axis];
+            t_enter = std::max(t_enter, std::min(t0, t1));
+            t_exit = std::min(t_exit, std::max(t0, t1));
+        }
+        tnear[i] = t_enter;
+        if (t_enter <= t_exit) mask |= 1 << i;
+    }
+    return mask;
+}
+
+int IntersectBlock(const Bvh::TriangleBlock& block, const TraversalRay& ray, float tmin, float* tmax) {
+    int best = -1;
+    for (int i = 0; i < 4; ++i) {
+        Ray lane_ray{ ray.origin, ray.direction, tmin, *tmax };
+        glm::vec3 v0(block.v0_x[i], block.v0_y[i], block.v0_z[i]);
+        glm::vec3 v1 = v0 + glm::vec3(block.e1_x[i], block.e1_y[i], block.e1_z[i]);
+        glm::vec3 v2 = v0 + glm::vec3(block.e2_x[i], block.e2_y[i], block.e2_z[i]);
+        float t;
+        if (IntersectTriangle(lane_ray, v0, v1, v2, &t)) {
+            *tmax = t;
+            best = i;
+        }
+    }
+    return best;
+}
+
+#endif
+
+} // namespace
+
+bool IntersectBounds(const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+                     const glm::vec3& origin, const glm::vec3& inv_direction, float tmax, float* tnear) {
+    float t0 = 0.0f;
+    float t1 = tmax;
+    for (int axis = 0; axis < 3; ++axis) {
+        float near_t = (bounds_min[axis] - origin[axis]) * inv_direction[axis];
+        float far_t = (bounds_max[axis] - origin[axis]) * inv_direction[axis];
+        if (near_t > far_t) std::swap(near_t, far_t);
+        t0 = near_t > t0 ? near_t : t0;
+        t1 = far_t < t1 ? far_t : t1;
+        if (t0 > t1) return false;
+    }
+    *tnear = t0;
+    return true;
+}
+
+bool IntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float* t) {
+    glm::vec3 edge1 = v1 - v0;
+    glm::vec3 edge2 = v2 - v0;
+    glm::vec3 p = glm::cross(ray.direction, edge2);
+    float det = glm::dot(edge1, p);
+    if (std::fabs(det) < 1e-12f) return false;
+    float inv_det = 1.0f / det;
+    glm::vec3 s = ray.origin - v0;
+    float u = glm::dot(s, p) * inv_det;
+    if (u < 0.0f || u > 1.0f) return false;
+    glm::vec3 q = glm::cross(s, edge1);
+    float v = glm::dot(ray.direction, q) * inv_det;
+    if (v < 0.0f || u + v > 1.0f) return false;
+    float hit_t = glm::dot(edge2, q) * inv_det;
+    if (hit_t <= ray.tmin || hit_t >= ray.tmax) return false;
+    *t = hit_t;
+    return true;
+}
+
+void Bvh::Build(const glm::vec3* positions, const uint32_t* indices, uint32_t triangle_count) {
+    owned_nodes_.clear();
+    owned_blocks_.clear();
+    nodes_ = nullptr;
+    blocks_ = nullptr;
+    node_count_ = 0;
+    block_count_ = 0;
+    if (triangle_count == 0) return;
+
+    std::vector<Aabb> triangle_bounds(triangle_count);
+    for (uint32_t i = 0; i < triangle_count; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            triangle_bounds[i].Grow(positions[indices[i * 3 + k]]);
+        }
+    }
+    BinaryBuilder builder(std::move(triangle_bounds), kMaxLeafSize);
+    const std::vector<BinaryNode>& binary = builder.nodes;
+    bounds_min_ = binary[0].bounds.lo;
+    bounds_max_ = binary[0].bounds.hi;
+
+    auto emit_block = [&](const BinaryNode& leaf) {
+        TriangleBlock block{};
+        for (int lane = 0; lane < kWidth; ++lane) {
+            block.primitive_index[lane] = kInvalidPrimitive;
+        }
+        for (uint32_t lane = 0; lane < leaf.count; ++lane) {
+            uint32_t prim = builder.order[leaf.first + lane];
+            glm::vec3 v0 = positions[indices[prim * 3]];
+            glm::vec3 e1 = positions[indices[prim * 3 + 1]] - v0;
+            glm::vec3 e2 = positions[indices[prim * 3 + 2]] - v0;
+            block.v0_x[lane] = v0.x; block.v0_y[lane] = v0.y; block.v0_z[lane] = v0.z;
+            block.e1_x[lane] = e1.x; block.e1_y[lane] = e1.y; block.e1_z[lane] = e1.z;
+            block.e2_x[lane] = e2.x; block.e2_y[lane] = e2.y; block.e2_z[lane] = e2.z;
+            block.primitive_index[lane] = prim;
+        }
+        owned_blocks_.push_back(block);
+        return ~(int32_t)(owned_blocks_.size() - 1);
+    };
+
+    // Collapse: each 4-wide node absorbs the largest interior grandchildren
+    // until it has four children or only leaves remain
+    auto collapse = [&](auto&& self, uint32_t binary_index) -> int32_t {
+        uint32_t children[kWidth];
+        int child_count = 0;
+        if (binary[binary_index].count > 0) {
+            children[child_count++] = binary_index;
+        } else {
+            children[child_count++] = binary[binary_index].left;
+            children[child_count++] = binary[binary_index].right;
+        }
+        while (child_count < kWidth) {
+            int expand = -1;
+            float largest = -1.0f;
+            for (int i = 0; i < child_count; ++i) {
+                const BinaryNode& c = binary[children[i]];
+                if (c.count == 0 && c.bounds.HalfArea() > largest) {
+                    largest = c.bounds.HalfArea();
+                    expand = i;
+                }
+            }
+            if (expand < 0) break;
+            uint32_t expanded = children[expand];
+            children[expand] = binary[expanded].left;
+            children[child_count++] = binary[expanded].right;
+        }
+
+        int32_t node_index = (int32_t)owned_nodes_.size();
+        owned_nodes_.emplace_back();
+        int32_t refs[kWidth];
+        for (int i = 0; i < kWidth; ++i) {
+            if (i >= child_count) {
+                refs[i] = kEmptyChild;
+            } else if (binary[children[i]].count > 0) {
+                refs[i] = emit_block(binary[children[i]]);
+            } else {
+                refs[i] = self(self, children[i]);
+            }
+        }
+
+        Node& node = owned_nodes_[node_index];
+        for (int i = 0; i < kWidth; ++i) {
+            Aabb bounds; // Empty lanes are skipped by child reference, not by their box
+            if (i < child_count) bounds = binary[children[i]].bounds;
+            node.bounds_min_x[i] = bounds.lo.x; node.bounds_min_y[i] = bounds.lo.y; node.bounds_min_z[i] = bounds.lo.z;
+            node.bounds_max_x[i] = bounds.hi.x; node.bounds_max_y[i] = bounds.hi.y; node.bounds_max_z[i] = bounds.hi.z;
+            node.child[i] = refs[i];
+        }
+        return node_index;
+    };
+    owned_nodes_.reserve(binary.size() / 2 + 1);
+    owned_blocks_.reserve(binary.size() / 2 + 1);
+    collapse(collapse, 0);
+
+    nodes_ = owned_nodes_.data();
+    blocks_ = owned_blocks_.data();
+    node_count_ = static_cast<uint32_t>(owned_nodes_.size());
+    block_count_ = static_cast<uint32_t>(owned_blocks_.size());
+}
+
+void Bvh::Adopt(const Node* nodes, uint32_t node_count, const TriangleBlock* blocks, uint32_t block_count,
+                const glm::vec3& bounds_min, const glm::vec3& bounds_max) {
+    owned_nodes_.clear();
+    owned_blocks_.clear();
+    nodes_ = nodes;
+    blocks_ = blocks;
+    node_count_ = node_count;
+    block_count_ = block_count;
+    bounds_min_ = bounds_min;
+    bounds_max_ = bounds_max;
+}
+
+bool Bvh::Intersect(const Ray& ray, TriangleHit* hit) const {
+    if (node_count_ == 0) return false;
+
+    TraversalRay traversal_ray;
+    traversal_ray.origin = ray.origin;
+    traversal_ray.direction = ray.direction;
+    traversal_ray.inv_direction = glm::vec3(SafeInverse(ray.direction.x), SafeInverse(ray.direction.y),
+                                            SafeInverse(ray.direction.z));
+    float tmax = ray.tmax;
+    bool found = false;
+
+    struct StackEntry {
+        int32_t ref;
+        float tnear;
+    };
+    StackEntry stack[kStackSize];
+    int stack_size = 0;
+    stack[stack_size++] = { 0, ray.tmin };
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.tnear > tmax) continue; // Something closer was found since this was pushed
+
+        if (entry.ref < 0) {
+            const TriangleBlock& block = blocks_[~entry.ref];
+            int lane = IntersectBlock(block, traversal_ray, ray.tmin, &tmax);
+            if (lane >= 0) {
+                hit->t = tmax;
+                hit->primitive_index = block.primitive_index[lane];
+                found = true;
+            }
+            continue;
+        }
+
+        const Node& node = nodes_[entry.ref];
+        float tnear[kWidth];
+        int mask = IntersectChildren(node, traversal_ray, ray.tmin, tmax, tnear);
+        // Push far children first so the nearest one is traversed next
+        StackEntry hits[kWidth];
+        int hit_count = 0;
+        for (int i = 0; i < kWidth; ++i) {
+            if (((mask >> i) & 1) && node.child[i] != kEmptyChild) {
+                StackEntry e{ node.child[i], tnear[i] };
+                int j = hit_count++;
+                while (j > 0 && hits[j - 1].tnear < e.tnear) {
+                    hits[j] = hits[j - 1];
+                    --j;
+                }
+                hits[j] = e;
+            }
+        }
+        assert(stack_size + hit_count <= kStackSize);
+        for (int i = 0; i < hit_count; ++i) {
+            stack[stack_size++] = hits[i];
+        }
+    }
+    return found;
+}
+
+void InstanceBvh::Build(const std::vector<glm::vec3>& bounds_min, const std::vector<glm::vec3>& bounds_max) {
+    nodes_.clear();
+    if (bounds_min.empty()) return;
+
+    std::vector<Aabb> instance_bounds(bounds_min.size());
+    for (size_t i = 0; i < bounds_min.size(); ++i) {
+        instance_bounds[i].lo = bounds_min[i];
+        instance_bounds[i].hi = bounds_max[i];
+    }
+    BinaryBuilder builder(std::move(instance_bounds), kMaxInstancesPerLeaf);
+
+    // The builder already places siblings next to each other, so its layout is kept as is
+    nodes_.resize(builder.nodes.size());
+    for (size_t i = 0; i < builder.nodes.size(); ++i) {
+        const BinaryNode& binary = builder.nodes[i];
+        Node& node = nodes_[i];
+        node.bounds_min = binary.bounds.lo;
+        node.bounds_max = binary.bounds.hi;
+        node.is_leaf = binary.count > 0 ? 1u : 0u;
+        node.left_or_instance = node.is_leaf ? builder.order[binary.first] : binary.left;
+    }
+}
+
+void InstanceBvh::Refit(const std::vector<glm::vec3>& bounds_min, const std::vector<glm::vec3>& bounds_max) {
+    // Children are always stored after their parent, so a reverse sweep sees them first
+    for (size_t i = nodes_.size(); i-- > 0;) {
+        Node& node = nodes_[i];
+        if (node.is_leaf) {
+            node.bounds_min = bounds_min[node.left_or_instance];
+            node.bounds_max = bounds_max[node.left_or_instance];
+        } else {
+            const Node& left = nodes_[node.left_or_instance];
+            const Node& right = nodes_[node.left_or_instance + 1];
+            node.bounds_min = glm::min(left.bounds_min, right.bounds_min);
+            node.bounds_max = glm::max(left.bounds_max, right.bounds_max);
+        }
+    }
+}
@@ -0,0 +1,168 @@
+#pragma once
+#include "long_march.h"
+#include <cassert>
+#include <vector>
+
+struct Ray {
+    glm::vec3 origin;
+    glm::vec3 direction;
+    float tmin;
+    float tmax;
+};
+
+struct TriangleHit {
+    float t;
+    uint32_t primitive_index;
+};
+
+// Depth bound of every tree the builder produces (root at depth 0). Binned
+// SAH splits down to kBvhMaxSahDepth; below it, object-median splits halve
+// the primitive count, which adds at most 32 levels for 32-bit counts. The
+// traversal stacks are sized from this bound, so they cannot overflow.
+constexpr int kBvhMaxSahDepth = 48;
+constexpr int kBvhMaxDepth = kBvhMaxSahDepth + 32;
+
+// Bounding volume hierarchy over a single triangle mesh, used by the CPU
+// renderer and picking. It is built with binned SAH and then collapsed into
+// a 4-wide tree, so one SSE instruction tests a ray against four child boxes
+// and each leaf tests four triangles at once.
+class Bvh {
+public:
+    static constexpr int kWidth = 4;
+    static constexpr int32_t kEmptyChild = INT32_MIN;
+
+    // Child bounds in SoA form. child[i] >= 0 is an interior node,
+    // kEmptyChild is unused and any other negative value is a leaf block ~child[i].
+    struct Node {
+        float bounds_min_x[kWidth];
+        float bounds_min_y[kWidth];
+        float bounds_min_z[kWidth];
+        float bounds_max_x[kWidth];
+        float bounds_max_y[kWidth];
+        float bounds_max_z[kWidth];
+        int32_t child[kWidth];
+    };
+
+    // Up to four triangles stored as v0 / edge1 / edge2 in SoA form.
+    // Unused lanes are degenerate and carry primitive index 0xFFFFFFFF.
+    struct TriangleBlock {
+        float v0_x[kWidth], v0_y[kWidth], v0_z[kWidth];
+        float e1_x[kWidth], e1_y[kWidth], e1_z[kWidth];
+        float e2_x[kWidth], e2_y[kWidth], e2_z[kWidth];
+        uint32_t primitive_index[kWidth];
+    };
+
+    Bvh() = default;
+    Bvh(const Bvh&) = delete;
+    Bvh& operator=(const Bvh&) = delete;
+
+    void Build(const glm::vec3* positions, const uint32_t* indices, uint32_t triangle_count);
+
+    // Use node and block arrays that live elsewhere (e.g. a mapped mesh cache
+    // file) without copying them. The memory must outlive this Bvh.
+    void Adopt(const Node* nodes, uint32_t node_count, const TriangleBlock* blocks, uint32_t block_count,
+               const glm::vec3& bounds_min, const glm::vec3& bounds_max);
+
+    // Closest hit in (ray.tmin, ray.tmax); updates hit only when something closer is found
+    bool Intersect(const Ray& ray, TriangleHit* hit) const;
+
+    bool IsBuilt() const { return node_count_ > 0; }
+    glm::vec3 GetBoundsMin() const { return bounds_min_; }
+    glm::vec3 GetBoundsMax() const { return bounds_max_; }
+    const Node* GetNodes() const { return nodes_; }
+    uint32_t GetNodeCount() const { return node_count_; }
+    const TriangleBlock* GetTriangleBlocks() const { return blocks_; }
+    uint32_t GetTriangleBlockCount() const { return block_count_; }
+
+private:
+    // Storage for trees built here; nodes_/blocks_ point into it or into adopted memory
+    std::vector<Node> owned_nodes_;
+    std::vector<TriangleBlock> owned_blocks_;
+    const Node* nodes_ = nullptr;
+    const TriangleBlock* blocks_ = nullptr;
+    uint32_t node_count_ = 0;
+    uint32_t block_count_ = 0;
+    glm::vec3 bounds_min_{ 0.0f };
+    glm::vec3 bounds_max_{ 0.0f };
+};
+
+// Binary BVH over instance world bounds: the CPU counterpart of the TLAS.
+// Leaves reference a single instance, which the caller intersects in its own
+// object space against the shared per-mesh Bvh.
+class InstanceBvh {
+public:
+    // Interior nodes keep their children at left and left + 1
+    struct Node {
+        glm::vec3 bounds_min;
+        uint32_t left_or_instance;
+        glm::vec3 bounds_max;
+        uint32_t is_leaf;
+    };
+
+    void Build(const std::vector<glm::vec3>& bounds_min, const std::vector<glm::vec3>& bounds_max);
+
+    // Recompute node bounds bottom-up for moved instances, keeping the topology
+    void Refit(const std::vector<glm::vec3>& bounds_min, const std::vector<glm::vec3>& bounds_max);
+
+    // Calls visit(instance_index) for every leaf the ray reaches before *tmax,
+    // nearest first. visit lowers *tmax when it finds a closer hit.
+    template <typename Visitor>
+    void Traverse(const Ray& ray, float* tmax, Visitor&& visit) const;
+
+    bool IsBuilt() const { return !nodes_.empty(); }
+    const std::vector<Node>& GetNodes() const { return nodes_; }
+
+private:
+    std::vector<Node> nodes_;
+};
+
+// Slab test shared by the BVH and the instance loop
+bool IntersectBounds(const glm::vec3& bounds_min, const glm::vec3& bounds_max,
+                     const glm::vec3& origin, const glm::vec3& inv_direction, float tmax, float* tnear);
+
+// Double-sided Moller-Trumbore test, matching the DXR default (no culling)
+bool IntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2, float* t);
+
+template <typename Visitor>
+void InstanceBvh::Traverse(const Ray& ray, float* tmax, Visitor&& visit) const {
+    if (nodes_.empty()) return;
+    glm::vec3 inv_direction(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+    struct StackEntry {
+        uint32_t node;
+        float tnear;
+    };
+    // At most one pending sibling per level, plus the two children just pushed
+    constexpr int kStackSize = kBvhMaxDepth + 2;
+    StackEntry stack[kStackSize];
+    int stack_size = 0;
+    float root_tnear;
+    if (!IntersectBounds(nodes_[0].bounds_min, nodes_[0].bounds_max, ray.origin, inv_direction, *tmax, &root_tnear)) {
+        return;
+    }
+    stack[stack_size++] = { 0, root_tnear };
+    while (stack_size > 0) {
+        StackEntry entry = stack[--stack_size];
+        if (entry.tnear > *tmax) continue;
+        const Node& node = nodes_[entry.node];
+        if (node.is_leaf) {
+            visit(node.left_or_instance);
+            continue;
+        }
+        float near_t[2];
+        bool hit[2];
+        for (uint32_t i = 0; i < 2; ++i) {
+            const Node& child = nodes_[node.left_or_instance + i];
+            hit[i] = IntersectBounds(child.bounds_min, child.bounds_max, ray.origin, inv_direction, *tmax, &near_t[i]);
+        }
+        // Far child goes on the stack first
+        uint32_t first = (hit[0] && hit[1] && near_t[1] < near_t[0]) ? 1 : 0;
+        assert(stack_size + 2 <= kStackSize);
+        for (uint32_t k = 0; k < 2; ++k) {
+            uint32_t i = k == 0 ? 1 - first : first;
+            if (hit[i]) {
+                stack[stack_size++] = { node.left_or_instance + i, near_t[i] };
+            }
+        }
+    }
+}
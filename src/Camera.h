@@ -0,0 +1,7 @@
+#pragma once
+#include "long_march.h"
+
+struct CameraObject {
+    glm::mat4 screen_to_camera;
+    glm::mat4 camera_to_world;
+};
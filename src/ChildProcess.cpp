@@ -0,0 +1,207 @@
+#include "ChildProcess.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+#ifdef _WIN32
+
+namespace {
+
+// Quote an argument for CommandLineToArgvW-style parsing
+std::string QuoteArgument(const std::string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos) {
+        return arg;
+    }
+    std::string quoted = "\"";
+    size_t backslashes = 0;
+    for (char c : arg) {
+        if (c == '\\') {
+            backslashes++;
+            continue;
+        }
+        // Backslashes before a quote are escaped along with it
+        quoted.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        quoted += c;
+    }
+    quoted.append(backslashes * 2, '\\');
+    quoted += '"';
+    return quoted;
+}
+
+} // namespace
+
+ChildProcess::ChildProcess()
+    : exit_code_(-1)
+    , exited_(false)
+    , process_(nullptr) {
+}
+
+bool ChildProcess::Start(const std::string& program, const std::vector<std::string>& args) {
+    std::string command_line = QuoteArgument(program);
+    for (const auto& arg : args) {
+        command_line += " " + QuoteArgument(arg);
+    }
+    STARTUPINFOA startup_info{};
+    startup_info.cb = sizeof(startup_info);
+    PROCESS_INFORMATION process_info{};
+    if (!CreateProcessA(program.c_str(), command_line.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr,
+                        &startup_info, &process_info)) {
+        return false;
+    }
+    CloseHandle(process_info.hThread);
+    process_ = process_info.hProcess;
+    exited_ = false;
+    exit_code_ = -1;
+    return true;
+}
+
+bool ChildProcess::IsStarted() const {
+    return process_ != nullptr;
+}
+
+bool ChildProcess::IsRunning() {
+    if (!process_ || exited_) {
+        return false;
+    }
+    if (WaitForSingleObject(process_, 0) != WAIT_OBJECT_0) {
+        return true;
+    }
+    Wait();
+    return false;
+}
+
+int ChildProcess::Wait() {
+    if (!process_) {
+        return -1;
+    }
+    if (!exited_) {
+        WaitForSingleObject(process_, INFINITE);
+        DWORD exit_code = 0;
+        exit_code_ = GetExitCodeProcess(process_, &exit_code) ? static_cast<int>(exit_code) : -1;
+        exited_ = true;
+    }
+    return exit_code_;
+}
+
+void ChildProcess::Kill() {
+    if (process_ && !exited_) {
+        TerminateProcess(process_, 1);
+    }
+}
+
+ChildProcess::~ChildProcess() {
+    if (process_) {
+        CloseHandle(process_);
+    }
+}
+
+std::string ChildProcess::GetExecutablePath() {
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(nullptr, path, MAX_PATH);
+    return std::string(path, length);
+}
+
+int ChildProcess::GetCurrentId() {
+    return static_cast<int>(GetCurrentProcessId());
+}
+
+bool ChildProcess::IsParentRunning(int parent_id) {
+    HANDLE process = OpenProcess(SYNCHRONIZE, FALSE, static_cast<DWORD>(parent_id));
+    if (!process) {
+        return false;
+    }
+    bool running = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+    CloseHandle(process);
+    return running;
+}
+
+#else
+
+ChildProcess::ChildProcess()
+    : exit_code_(-1)
+    , exited_(false)
+    , pid_(-1) {
+}
+
+bool ChildProcess::Start(const std::string& program, const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(program.c_str()));
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t pid;
+    if (posix_spawn(&pid, program.c_str(), nullptr, nullptr, argv.data(), environ) != 0) {
+        return false;
+    }
+    pid_ = pid;
+    exited_ = false;
+    exit_code_ = -1;
+    return true;
+}
+
+bool ChildProcess::IsStarted() const {
+    return pid_ > 0;
+}
+
+bool ChildProcess::IsRunning() {
+    if (pid_ <= 0 || exited_) {
+        return false;
+    }
+    int status = 0;
+    if (waitpid(pid_, &status, WNOHANG) == 0) {
+        return true;
+    }
+    exit_code_ = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    exited_ = true;
+    return false;
+}
+
+int ChildProcess::Wait() {
+    if (pid_ <= 0) {
+        return -1;
+    }
+    if (!exited_) {
+        int status = 0;
+        exit_code_ = waitpid(pid_, &status, 0) == pid_ && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        exited_ = true;
+    }
+    return exit_code_;
+}
+
+void ChildProcess::Kill() {
+    if (pid_ > 0 && !exited_) {
+        kill(pid_, SIGKILL);
+    }
+}
+
+ChildProcess::~ChildProcess() {
+}
+
+std::string ChildProcess::GetExecutablePath() {
+    char path[4096];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path));
+    return length > 0 ? std::string(path, static_cast<size_t>(length)) : std::string();
+}
+
+int ChildProcess::GetCurrentId() {
+    return static_cast<int>(getpid());
+}
+
+bool ChildProcess::IsParentRunning(int parent_id) {
+    // An orphan is re-parented (to init or a subreaper), so its parent id changes
+    return static_cast<int>(getppid()) == parent_id;
+}
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Child process running a program with an argument list (CreateProcess or
+// posix_spawn). Not waited for on destruction; call Wait first, after Kill
+// to stop it early.
+class ChildProcess {
+public:
+    ChildProcess();
+    ~ChildProcess();
+
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // args excludes the program itself
+    bool Start(const std::string& program, const std::vector<std::string>& args);
+    bool IsStarted() const;
+    // False once the process has exited (its exit code is then kept)
+    bool IsRunning();
+    // Block until the process exits; returns its exit code, -1 if it was
+    // never started or did not exit normally
+    int Wait();
+    // Terminate the process without waiting for it; Wait then reaps it
+    void Kill();
+
+    // Path of the running executable, for starting copies of this program
+    static std::string GetExecutablePath();
+    // Id of the calling process, for its children to pass to IsParentRunning
+    static int GetCurrentId();
+    // False once parent_id, the process that started the calling one, has
+    // exited; lets a child stop instead of waiting on a parent that is gone
+    static bool IsParentRunning(int parent_id);
+
+private:
+    int exit_code_;
+    bool exited_;
+#ifdef _WIN32
+    void* process_;
+#else
+    int pid_;
+#endif
+};
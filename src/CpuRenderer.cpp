@@ -0,0 +1,463 @@
+#include "CpuRenderer.h"
+#include "ThreadPool.h"
+#include "TileScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr uint32_t MAX_DEPTH = 7;
+constexpr uint32_t TEST_RAY_DEPTH = 100;
+constexpr uint32_t NO_INSTANCE = 0xFFFFFFFFu;
+constexpr float PI = 3.14159265358979323846f;
+constexpr int TILE_SIZE = TileScheduler::kTileSize;
+
+const glm::vec3 AMBIENT_COLOR(1.0f, 1.0f, 1.0f);
+constexpr float AMBIENT_INTENSITY = 0.2f;
+constexpr int AREA_LIGHT_SAMPLES = 1; // the low-discrepancy samplers give it one dimension pair
+constexpr int ENVIRONMENT_SHADOW_LAYERS = 8;
+
+glm::vec3 Reflect(const glm::vec3& I, const glm::vec3& N) {
+    return I - 2.0f * glm::dot(I, N) * N;
+}
+
+glm::vec3 Refract(const glm::vec3& I, const glm::vec3& N, float eta) {
+    float NdotI = glm::dot(N, I);
+    float k = 1.0f - eta * eta * (1.0f - NdotI * NdotI);
+    if (k < 0.0f) {
+        return Reflect(-I, N);
+    }
+    return eta * I - (eta * NdotI + std::sqrt(k)) * N;
+}
+
+glm::vec2 GetTextureCoords(const glm::vec3& position, const TextureType& tex_info) {
+    float u = tex_info.c1 * position.x + tex_info.c2 * position.y + tex_info.c3 * position.z + tex_info.c4;
+    float v = tex_info.c5 * position.x + tex_info.c6 * position.y + tex_info.c7 * position.z + tex_info.c8;
+    return glm::vec2(u, v);
+}
+
+float CalculateGroundMipLevel(const glm::vec3& hit_point, const glm::vec3& view_dir, const glm::vec3& camera_pos) {
+    const float GROUND_SIZE = 20.0f;
+    const float TEXTURE_SIZE = 1024.0f;
+    const float PIXEL_ANGLE = 0.0003f;
+    float ray_length = glm::length(hit_point - camera_pos);
+    float cos_theta = std::fabs(glm::dot(glm::vec3(0, 1, 0), -view_dir));
+    cos_theta = std::max(cos_theta, 0.001f);
+    float pixel_world_size = ray_length * PIXEL_ANGLE / cos_theta;
+    float texels_per_world_unit = TEXTURE_SIZE / GROUND_SIZE;
+    float texel_coverage = pixel_world_size * texels_per_world_unit;
+    return std::log2(texel_coverage) + 0.5f;
+}
+
+bool RussianRoulette(float throughput, PathSampler& sampler) {
+    if (throughput < 0.05f) {
+        float r = sampler.Get(PathSampler::kRussianRoulette);
+        float continue_prob = 1.0f - std::exp(-throughput * 15.0f);
+        continue_prob = std::clamp(continue_prob, 0.2f, 0.95f);
+        if (r > continue_prob) return false;
+    }
+    return true;
+}
+
+Ray MakeRay(const glm::vec3& origin, const glm::vec3& direction, float tmin = 0.001f, float tmax = 10000.0f) {
+    Ray ray;
+    ray.origin = origin;
+    ray.direction = direction;
+    ray.tmin = tmin;
+    ray.tmax = tmax;
+    return ray;
+}
+
+} // namespace
+
+CpuRenderer::CpuRenderer(const Scene* scene, const TextureAtlas* textures)
+    : scene_(scene)
+    , textures_(textures) {
+}
+
+void CpuRenderer::SetLights(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights) {
+    point_lights_ = point_lights;
+    area_lights_ = area_lights;
+    light_bvh_.Build(point_lights, area_lights);
+    light_power_table_.Build(LightBvh::GetPowers(point_lights, area_lights));
+}
+
+bool CpuRenderer::Intersect(const Ray& ray, uint32_t* instance_id, uint32_t* primitive_index, float* t) const {
+    return scene_->IntersectCpu(ray, instance_id, primitive_index, t);
+}
+
+void CpuRenderer::TraceRay(const Ray& ray, RayPayload& payload, const PixelContext& pixel) const {
+    uint32_t instance_id, primitive_index;
+    float t;
+    if (Intersect(ray, &instance_id, &primitive_index, &t)) {
+        payload.hit_distance = t;
+        ClosestHit(ray, payload, instance_id, primitive_index, pixel);
+    } else {
+        Miss(ray, payload);
+    }
+}
+
+void CpuRenderer::Miss(const Ray& ray, RayPayload& payload) const {
+    payload.hit = false;
+    payload.hit_distance = 10000.0f;
+    payload.instance_id = NO_INSTANCE;
+    if (payload.depth == TEST_RAY_DEPTH) {
+        payload.color = glm::vec3(0.0f);
+        return;
+    }
+    glm::vec3 ray_dir = glm::normalize(ray.direction);
+    float u = 0.5f + std::atan2(ray_dir.z, ray_dir.x) / (2.0f * PI);
+    float v = 0.5f - std::asin(ray_dir.y) / PI;
+    glm::vec3 sky_color = textures_->Sample(EnvironmentMap::kTextureIndex, glm::vec2(u, v));
+    payload.color = sky_color * payload.throughput;
+}
+
+glm::vec3 CpuRenderer::CalcNormal(uint32_t instance_id, uint32_t primitive_index, const glm::vec3& ray_direction) const {
+    // Object-space geometric normal, exactly as calcNormal does with the flattened vertex buffer
+    const Entity* entity = scene_->GetEntities()[instance_id].get();
+    const glm::vec3* positions = entity->GetMeshPositions();
+    const uint32_t* indices = entity->GetMeshIndices();
+    glm::vec3 v0 = positions[indices[primitive_index * 3 + 0]];
+    glm::vec3 v1 = positions[indices[primitive_index * 3 + 1]];
+    glm::vec3 v2 = positions[indices[primitive_index * 3 + 2]];
+    glm::vec3 normal = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    glm::vec3 view_dir = glm::normalize(-ray_direction);
+    if (glm::dot(normal, view_dir) < 0.0f) normal = -normal;
+    return normal;
+}
+
+float CpuRenderer::TestShadow(const glm::vec3& hit_point, const glm::vec3& light_pos) const {
+    glm::vec3 light_to_point = hit_point - light_pos;
+    float total_distance = glm::length(light_to_point);
+    if (total_distance < 0.005f) return 1.0f;
+    glm::vec3 light_dir = light_to_point / total_distance;
+    float transmission_factor = 1.0f;
+    float current_distance = 0.001f;
+    glm::vec3 ray_origin = light_pos + light_dir * 0.001f;
+    while (current_distance < total_distance - 0.003f) {
+        // The GPU accepts the first hit; the closest hit is an equally valid occluder here
+        Ray shadow_ray = MakeRay(ray_origin, light_dir, 0.001f, total_distance - current_distance - 0.001f);
+        uint32_t instance_id, primitive_index;
+        float t;
+        if (!Intersect(shadow_ray, &instance_id, &primitive_index, &t)) break;
+        const Material& hit_mat = scene_->GetEntities()[instance_id]->GetMaterial();
+        if (hit_mat.shadow_factor > 0.0f) {
+            transmission_factor *= hit_mat.shadow_factor;
+            ray_origin = ray_origin + light_dir * (t + 0.001f);
+            current_distance += t + 0.001f;
+            continue;
+        }
+        return 0.0f;
+    }
+    return transmission_factor;
+}
+
+float CpuRenderer::TestEnvironmentShadow(const glm::vec3& origin, const glm::vec3& direction) const {
+    // Like TestShadow, but open-ended: translucent occluders only dim the sky
+    float transmission_factor = 1.0f;
+    glm::vec3 ray_origin = origin;
+    for (int layer = 0; layer < ENVIRONMENT_SHADOW_LAYERS; ++layer) {
+        uint32_t instance_id, primitive_index;
+        float t;
+        if (!Intersect(MakeRay(ray_origin, direction), &instance_id, &primitive_index, &t)) {
+            return transmission_factor;
+        }
+        const Material& hit_mat = scene_->GetEntities()[instance_id]->GetMaterial();
+        if (hit_mat.shadow_factor <= 0.0f) return 0.0f;
+        transmission_factor *= hit_mat.shadow_factor;
+        ray_origin = ray_origin + direction * (t + 0.001f);
+    }
+    return transmission_factor;
+}
+
+glm::vec3 CpuRenderer::CalculateEnvironmentLight(const glm::vec3& hit_point, const glm::vec3& normal,
+                                                 const Material& mat, PathSampler& sampler) const {
+    // One sky direction drawn from the environment map; Lambertian response
+    float u = sampler.Get(PathSampler::kEnvironment);
+    float v = sampler.Get(PathSampler::kEnvironment + 1);
+    float pdf;
+    glm::vec3 direction = environment_->Sample(glm::vec2(u, v), &pdf);
+    float ndotl = glm::dot(normal, direction);
+    if (pdf <= 0.0f || ndotl <= 0.0f) return glm::vec3(0.0f);
+    float visibility = TestEnvironmentShadow(hit_point + normal * 0.001f, direction);
+    if (visibility <= 0.0f) return glm::vec3(0.0f);
+    glm::vec3 radiance = textures_->Sample(EnvironmentMap::kTextureIndex, EnvironmentMap::DirectionToUv(direction));
+    return visibility * radiance * mat.base_color * ((1.0f - mat.metallic) * ndotl / (PI * pdf));
+}
+
+glm::vec3 CpuRenderer::CalculatePointLightContribution(const glm::vec3& hit_point, const glm::vec3& normal,
+                                                       const Material& mat, const glm::vec3& view_dir,
+                                                       const PointLight& light) const {
+    glm::vec3 light_dir = glm::normalize(light.position - hit_point);
+    float light_distance = glm::length(light.position - hit_point);
+    float attenuation = light.intensity / (light_distance * light_distance + 0.001f);
+    float shadow_factor = TestShadow(hit_point, light.position);
+    if (shadow_factor <= 0.001f) return glm::vec3(0.0f);
+    float ndotl = std::max(0.0f, glm::dot(normal, light_dir));
+    if (ndotl <= 0.0f) return glm::vec3(0.0f);
+    float diffuse_factor = 1.0f - mat.metallic;
+    glm::vec3 diffuse = attenuation * light.color * mat.base_color * ndotl * diffuse_factor;
+    glm::vec3 half_vector = glm::normalize(light_dir + view_dir);
+    float ndoth = std::max(0.0f, glm::dot(normal, half_vector));
+    float specular_power = std::max(1.0f, 32.0f * (1.0f - mat.roughness));
+    float specular_intensity = std::pow(ndoth, specular_power);
+    float metallic_factor = 0.2f + mat.metallic * 0.8f;
+    glm::vec3 specular = attenuation * light.color * mat.base_color * specular_intensity * metallic_factor;
+    return shadow_factor * (diffuse + specular);
+}
+
+glm::vec3 CpuRenderer::CalculateAreaLightContribution(const glm::vec3& hit_point, const glm::vec3& normal,
+                                                      const Material& mat, const glm::vec3& view_dir,
+                                                      const AreaLight& light, PathSampler& sampler) const {
+    glm::vec3 total_contribution(0.0f);
+    glm::vec3 up = glm::normalize(glm::cross(light.normal, light.left));
+    for (int i = 0; i < AREA_LIGHT_SAMPLES; i++) {
+        float random_u = sampler.Get(PathSampler::kLightPosition);
+        float random_v = sampler.Get(PathSampler::kLightPosition + 1);
+        PointLight sample_light;
+        sample_light.position = light.center + up * ((random_u - 0.5f) * light.width) +
+                                light.left * ((random_v - 0.5f) * light.height);
+        sample_light.color = light.color;
+        sample_light.intensity = light.intensity / float(AREA_LIGHT_SAMPLES);
+        total_contribution += CalculatePointLightContribution(hit_point, normal, mat, view_dir, sample_light);
+    }
+    return total_contribution;
+}
+
+glm::vec3 CpuRenderer::CalculateDirectLight(const glm::vec3& hit_point, const glm::vec3& normal, const Material& mat,
+                                            const glm::vec3& view_dir, PathSampler& sampler) const {
+    glm::vec3 total_light;
+    if (environment_light_ && environment_ && !environment_->IsEmpty()) {
+        total_light = CalculateEnvironmentLight(hit_point, normal, mat, sampler);
+    } else {
+        total_light = AMBIENT_COLOR * AMBIENT_INTENSITY * mat.base_color;
+    }
+    // One light per shading point, chosen by the light BVH and weighted by 1 / pdf
+    float light_pdf = 0.0f;
+    uint32_t light = LightBvh::kNoLight;
+    if (light_selection_ == LightSelection::kPower) {
+        if (!light_power_table_.IsEmpty()) {
+            uint32_t index = light_power_table_.Sample(sampler.Get(PathSampler::kLightSelect), &light_pdf);
+            light = index < point_lights_.size()
+                        ? LightBvh::kLeafFlag | index
+                        : LightBvh::kLeafFlag | LightBvh::kAreaLightFlag | static_cast<uint32_t>(index - point_lights_.size());
+        }
+    } else {
+        light = light_bvh_.Sample(hit_point, sampler.Get(PathSampler::kLightSelect), &light_pdf);
+    }
+    if (light == LightBvh::kNoLight || light_pdf <= 0.0f) return total_light;
+    uint32_t light_index = light & LightBvh::kLightIndexMask;
+    if (light & LightBvh::kAreaLightFlag) {
+        total_light += CalculateAreaLightContribution(hit_point, normal, mat, view_dir, area_lights_[light_index], sampler) /
+                       light_pdf;
+    } else {
+        total_light += CalculatePointLightContribution(hit_point, normal, mat, view_dir, point_lights_[light_index]) /
+                       light_pdf;
+    }
+    return total_light;
+}
+
+void CpuRenderer::ClosestHit(const Ray& ray, RayPayload& payload, uint32_t instance_id, uint32_t primitive_index,
+                             const PixelContext& pixel) const {
+    uint32_t material_idx = instance_id;
+    Material mat = scene_->GetEntities()[instance_id]->GetMaterial();
+    payload.hit = true;
+    payload.instance_id = material_idx;
+    if (payload.depth == TEST_RAY_DEPTH) return; // test ray
+
+    glm::vec3 hit_point = ray.origin + ray.direction * payload.hit_distance;
+    glm::vec3 norm = CalcNormal(instance_id, primitive_index, ray.direction);
+    glm::vec3 view_dir = glm::normalize(-ray.direction);
+    if (mat.texture_info.type == 2 && mat.texture_info.texture_id >= 0) { // normal map
+        glm::vec2 uv = GetTextureCoords(hit_point, mat.texture_info);
+        glm::vec3 normal_tex = textures_->Sample(mat.texture_info.texture_id, uv) - glm::vec3(0.5f);
+        glm::vec3 tangent_z = norm;
+        glm::vec3 tangent_x = glm::normalize(glm::vec3(mat.texture_info.normal_x, mat.texture_info.normal_y,
+                                                       mat.texture_info.normal_z));
+        glm::vec3 tangent_y = glm::cross(tangent_z, tangent_x);
+        glm::vec3 new_normal = glm::normalize(normal_tex.x * tangent_x + normal_tex.y * tangent_y +
+                                              normal_tex.z * tangent_z);
+        if (glm::dot(new_normal, view_dir) < 0.0f) new_normal = -new_normal;
+        norm = new_normal;
+    }
+    PathSampler sampler = PathSampler::ForBounce(sampler_type_, pixel.x, pixel.y, pixel.frame, payload.depth);
+
+    if (material_idx == 100) { // mipmap (hard-coded in the shader as well)
+        float mip_lev = CalculateGroundMipLevel(hit_point, view_dir, ray.origin);
+        float ux = (hit_point.x + 10.0f) / 20.0f;
+        float uy = (hit_point.z + 10.0f) / 20.0f;
+        mat.base_color = textures_->Sample(0, glm::vec2(ux, uy), mip_lev);
+    }
+    if (mat.texture_info.type == 1 && mat.texture_info.texture_id >= 0) { // color texture
+        glm::vec2 uv = GetTextureCoords(hit_point, mat.texture_info);
+        mat.base_color = textures_->Sample(mat.texture_info.texture_id, uv);
+    }
+    if (mat.texture_info.type == 3 && mat.texture_info.texture_id >= 0) { // height map
+        glm::vec2 uv = GetTextureCoords(hit_point, mat.texture_info);
+        glm::vec3 height_color = textures_->Sample(mat.texture_info.texture_id, uv);
+        float grayscale = (height_color.x + height_color.y + height_color.z) / 3.0f;
+        float height = mat.texture_info.c9 * grayscale + mat.texture_info.c10;
+        hit_point = hit_point + height * norm;
+    }
+    if (payload.depth == 0) {
+        payload.albedo = mat.base_color;
+        // norm is in object space; normals transform by the inverse transpose of the entity transform
+        const glm::mat4& transform = scene_->GetEntities()[instance_id]->GetTransform();
+        glm::mat3 normal_to_world = glm::transpose(glm::inverse(glm::mat3(transform)));
+        payload.normal = glm::normalize(normal_to_world * norm);
+        if (glm::dot(payload.normal, view_dir) < 0.0f) payload.normal = -payload.normal;
+    }
+
+    glm::vec3 direct_light = CalculateDirectLight(hit_point, norm, mat, view_dir, sampler);
+    payload.color = direct_light * payload.throughput;
+    if (payload.depth >= MAX_DEPTH) return;
+
+    float reflectivity = std::min((1.0f - mat.roughness) * (0.3f + mat.metallic * 0.8f), 1.0f);
+    float reflection_prob = reflectivity;
+    float refraction_prob = mat.transmission * (1.0f - reflectivity);
+    if (!RussianRoulette(payload.throughput * reflectivity, sampler)) return;
+    float random_val = sampler.Get(PathSampler::kLobe);
+
+    RayPayload child;
+    child.color = glm::vec3(0.0f);
+    child.hit = false;
+    child.instance_id = 0;
+    child.hit_distance = 0.0f;
+    child.depth = payload.depth + 1;
+
+    if (random_val < reflection_prob) {
+        child.throughput = payload.throughput * reflectivity;
+        child.inside_material = payload.inside_material;
+        TraceRay(MakeRay(hit_point + norm * 0.001f, Reflect(-view_dir, norm)), child, pixel);
+        payload.color += child.color;
+    } else if (random_val < reflection_prob + refraction_prob && refraction_prob > 0.001f) {
+        glm::vec3 refract_dir;
+        if (payload.inside_material) refract_dir = Refract(-view_dir, norm, 1.0f / mat.ior);
+        else refract_dir = Refract(-view_dir, norm, mat.ior);
+        if (glm::dot(refract_dir, refract_dir) < 0.001f) refract_dir = Reflect(-view_dir, norm);
+        refract_dir = glm::normalize(refract_dir);
+        child.throughput = payload.throughput * mat.transmission * (1.0f - reflectivity);
+
+        if (mat.mean_free_path > 0.0f && !payload.inside_material) {
+            // Subsurface random walk: sample a free-flight distance and scatter
+            // inside the medium if it ends before the ray leaves the object
+            float sigma_t = 1.0f / mat.mean_free_path;
+            float l = -std::log(1.0f - sampler.Get(PathSampler::kSssDistance)) / sigma_t;
+            uint32_t test_instance, test_primitive;
+            float test_t;
+            Ray test_ray = MakeRay(hit_point - norm * 0.001f, refract_dir);
+            float d = Intersect(test_ray, &test_instance, &test_primitive, &test_t) ? test_t : 10000.0f;
+            if (d > l) {
+                glm::vec3 scatter_pos = hit_point - norm * 0.001f + refract_dir * l;
+                float g = mat.anisotropy_g;
+                float cos_theta;
+                if (std::fabs(g) < 0.001f) {
+                    cos_theta = 1.0f - 2.0f * sampler.Get(PathSampler::kScatter);
+                } else {
+                    float t = (1.0f - g * g) / (1.0f - g + 2.0f * g * sampler.Get(PathSampler::kScatter));
+                    cos_theta = (1.0f + g * g - t * t) / (2.0f * g);
+                }
+                float sin_theta = std::sqrt(std::max(0.0f, 1.0f - cos_theta * cos_theta));
+                float phi = 2.0f * PI * sampler.Get(PathSampler::kScatter + 1);
+                glm::vec3 u;
+                if (std::fabs(refract_dir.x) > 0.1f) {
+                    u = glm::normalize(glm::cross(refract_dir, glm::vec3(0, 1, 0)));
+                } else {
+                    u = glm::normalize(glm::cross(refract_dir, glm::vec3(1, 0, 0)));
+                }
+                glm::vec3 v = glm::cross(refract_dir, u);
+                glm::vec3 scatter_dir = glm::normalize(sin_theta * std::cos(phi) * u + sin_theta * std::sin(phi) * v +
+                                                       cos_theta * refract_dir);
+                child.inside_material = true;
+                TraceRay(MakeRay(scatter_pos, scatter_dir), child, pixel);
+                payload.color += child.color;
+                return;
+            }
+        }
+        child.inside_material = !payload.inside_material;
+        TraceRay(MakeRay(hit_point - norm * 0.001f, refract_dir), child, pixel);
+        payload.color += child.color;
+    }
+}
+
+void CpuRenderer::RenderSample(const CameraObject& camera, Film* film, int32_t* entity_ids) {
+    const int width = film->GetWidth();
+    const int height = film->GetHeight();
+    float* accumulated_color = film->GetHostAccumulatedColor();
+    int32_t* accumulated_samples = film->GetHostAccumulatedSamples();
+    float* accumulated_moment = film->GetHostAccumulatedMoment();
+    // Null unless the film allocated the layer
+    float* aov_albedo = film->GetHostAovAlbedo();
+    float* aov_normal = film->GetHostAovNormal();
+    float* aov_depth = film->GetHostAovDepth();
+    int32_t* aov_instance_id = film->GetHostAovInstanceId();
+    const glm::vec4 origin = camera.camera_to_world * glm::vec4(0, 0, 0, 1);
+
+    const int tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const int tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    const size_t tile_count = tiles_.empty() ? static_cast<size_t>(tiles_x) * tiles_y : tiles_.size();
+    ThreadPool::Global().ParallelFor(tile_count, [&](size_t index) {
+        const size_t tile = tiles_.empty() ? index : tiles_[index];
+        const int x0 = static_cast<int>(tile % tiles_x) * TILE_SIZE;
+        const int y0 = static_cast<int>(tile / tiles_x) * TILE_SIZE;
+        const int x1 = std::min(x0 + TILE_SIZE, width);
+        const int y1 = std::min(y0 + TILE_SIZE, height);
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                const size_t pixel_index = static_cast<size_t>(y) * width + x;
+                PixelContext pixel{ static_cast<uint32_t>(x), static_cast<uint32_t>(y),
+                                    static_cast<uint32_t>(accumulated_samples[pixel_index]) + sample_offset_ };
+                PathSampler camera_sampler = PathSampler::ForCamera(sampler_type_, pixel.x, pixel.y, pixel.frame);
+                float random_x = camera_sampler.Get(0);
+                float random_y = camera_sampler.Get(1);
+                glm::vec2 uv((x + random_x) / width, (y + random_y) / height);
+                uv.y = 1.0f - uv.y;
+                glm::vec2 d = uv * 2.0f - glm::vec2(1.0f, 1.0f);
+                glm::vec4 target = camera.screen_to_camera * glm::vec4(d.x, d.y, 1, 1);
+                glm::vec4 direction = camera.camera_to_world * glm::vec4(target.x, target.y, target.z, 0);
+
+                RayPayload payload;
+                payload.color = glm::vec3(0.0f);
+                payload.hit = false;
+                payload.instance_id = 0;
+                payload.hit_distance = 0.0f;
+                payload.depth = 0;
+                payload.throughput = 1.0f;
+                payload.inside_material = false;
+                payload.albedo = glm::vec3(0.0f);
+                payload.normal = glm::vec3(0.0f);
+                TraceRay(MakeRay(glm::vec3(origin), glm::normalize(glm::vec3(direction))), payload, pixel);
+
+                // The primary payload already carries the first-hit entity
+                if (entity_ids) {
+                    entity_ids[pixel_index] = payload.hit ? static_cast<int32_t>(payload.instance_id) : -1;
+                }
+                float* color = accumulated_color + pixel_index * 4;
+                color[0] += payload.color.x;
+                color[1] += payload.color.y;
+                color[2] += payload.color.z;
+                color[3] += 1.0f;
+                accumulated_samples[pixel_index] += 1;
+                float luminance = 0.2126f * payload.color.x + 0.7152f * payload.color.y + 0.0722f * payload.color.z;
+                accumulated_moment[pixel_index] += luminance * luminance;
+                if (aov_albedo) {
+                    aov_albedo[pixel_index * 4 + 0] += payload.albedo.x;
+                    aov_albedo[pixel_index * 4 + 1] += payload.albedo.y;
+                    aov_albedo[pixel_index * 4 + 2] += payload.albedo.z;
+                }
+                if (aov_normal) {
+                    aov_normal[pixel_index * 4 + 0] += payload.normal.x;
+                    aov_normal[pixel_index * 4 + 1] += payload.normal.y;
+                    aov_normal[pixel_index * 4 + 2] += payload.normal.z;
+                }
+                if (aov_depth && payload.hit) {
+                    aov_depth[pixel_index * 4 + 0] += payload.hit_distance;
+                    aov_depth[pixel_index * 4 + 1] += 1.0f;
+                }
+                if (aov_instance_id && payload.hit && aov_instance_id[pixel_index] < 0) {
+                    aov_instance_id[pixel_index] = static_cast<int32_t>(payload.instance_id);
+                }
+            }
+        }
+    });
+}
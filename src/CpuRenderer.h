@@ -0,0 +1,96 @@
+#pragma once
+#include "long_march.h"
+#include "Scene.h"
+#include "Film.h"
+#include "Light.h"
+#include "LightBvh.h"
+#include "AliasTable.h"
+#include "EnvironmentMap.h"
+#include "PathSampler.h"
+#include "Camera.h"
+#include "Texture.h"
+#include <vector>
+
+// Multithreaded CPU implementation of the integrator in shaders/shader.hlsl
+// (RayGenMain / ClosestHitMain / MissMain). It reads the same Scene, Material
+// and texture data as the GPU path and accumulates into the film's host
+// buffers, so it runs on machines without a ray tracing capable device.
+class CpuRenderer {
+public:
+    CpuRenderer(const Scene* scene, const TextureAtlas* textures);
+
+    void SetLights(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights);
+    void SetLightSelection(LightSelection selection) { light_selection_ = selection; }
+    // Light diffuse surfaces with importance-sampled sky radiance instead of
+    // the constant ambient term. environment must outlive the renderer; an
+    // empty map keeps the ambient term.
+    void SetEnvironment(const EnvironmentMap* environment) { environment_ = environment; }
+    void SetEnvironmentLight(bool enabled) { environment_light_ = enabled; }
+    void SetSamplerType(SamplerType type) { sampler_type_ = type; }
+    // Added to every pixel's sample index, so renders that are merged later
+    // (FilmSnapshot.h) do not repeat each other's samples
+    void SetSampleOffset(uint32_t offset) { sample_offset_ = offset; }
+    // Sample only the listed tiles (TileScheduler indices for the film's
+    // size); an empty list samples every pixel
+    void SetTiles(const std::vector<uint32_t>& tiles) { tiles_ = tiles; }
+
+    // Trace one sample per pixel of the current tiles into film's host
+    // accumulation and AOV layers. Worker threads take tiles one at a time, so cheap tiles
+    // do not hold up the rest. The scene's CPU acceleration structures must
+    // have been built.
+    // entity_ids (width * height, optional) receives the primary hit entity or -1.
+    void RenderSample(const CameraObject& camera, Film* film, int32_t* entity_ids = nullptr);
+
+private:
+    struct RayPayload {
+        glm::vec3 color;
+        bool hit;
+        uint32_t instance_id;
+        float hit_distance;
+        uint32_t depth;
+        float throughput;
+        bool inside_material;
+        // Primary hit surface for the film's AOVs, set when depth is 0
+        glm::vec3 albedo;
+        glm::vec3 normal;
+    };
+
+    struct PixelContext {
+        uint32_t x;
+        uint32_t y;
+        uint32_t frame; // accumulated samples of this pixel plus the sample offset: the sample index, like the shader
+    };
+
+    // Closest hit through the scene's CPU TLAS; returns false on miss
+    bool Intersect(const Ray& ray, uint32_t* instance_id, uint32_t* primitive_index, float* t) const;
+
+    void TraceRay(const Ray& ray, RayPayload& payload, const PixelContext& pixel) const;
+    void ClosestHit(const Ray& ray, RayPayload& payload, uint32_t instance_id, uint32_t primitive_index,
+                    const PixelContext& pixel) const;
+    void Miss(const Ray& ray, RayPayload& payload) const;
+
+    glm::vec3 CalcNormal(uint32_t instance_id, uint32_t primitive_index, const glm::vec3& ray_direction) const;
+    float TestShadow(const glm::vec3& hit_point, const glm::vec3& light_pos) const;
+    float TestEnvironmentShadow(const glm::vec3& origin, const glm::vec3& direction) const;
+    glm::vec3 CalculateEnvironmentLight(const glm::vec3& hit_point, const glm::vec3& normal, const Material& mat,
+                                        PathSampler& sampler) const;
+    glm::vec3 CalculatePointLightContribution(const glm::vec3& hit_point, const glm::vec3& normal, const Material& mat,
+                                              const glm::vec3& view_dir, const PointLight& light) const;
+    glm::vec3 CalculateAreaLightContribution(const glm::vec3& hit_point, const glm::vec3& normal, const Material& mat,
+                                             const glm::vec3& view_dir, const AreaLight& light, PathSampler& sampler) const;
+    glm::vec3 CalculateDirectLight(const glm::vec3& hit_point, const glm::vec3& normal, const Material& mat,
+                                   const glm::vec3& view_dir, PathSampler& sampler) const;
+
+    const Scene* scene_;
+    const TextureAtlas* textures_;
+    std::vector<PointLight> point_lights_;
+    std::vector<AreaLight> area_lights_;
+    LightBvh light_bvh_;
+    AliasTable light_power_table_;
+    LightSelection light_selection_ = LightSelection::kBvh;
+    const EnvironmentMap* environment_ = nullptr;
+    bool environment_light_ = false;
+    SamplerType sampler_type_ = SamplerType::kSobol;
+    uint32_t sample_offset_ = 0;
+    std::vector<uint32_t> tiles_;
+};
@@ -0,0 +1,298 @@
+#include "DistributedRenderer.h"
+#include "ChildProcess.h"
+#include "CpuRenderer.h"
+#include "SharedMemory.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kSegmentMagic = 0x464D5353; // "SSMF"
+constexpr uint32_t kSegmentVersion = 2;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "atomics in shared memory must be lock-free");
+
+// Start of the shared segment, followed by the accumulation at kDataOffset:
+// RGBA32F color sum, R32_SINT sample count, R32F luminance second moment
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t samples_per_pixel;
+    int32_t coordinator_id;  // process id the workers watch, so they exit if it dies
+    uint32_t chunk_tiles;   // consecutive tiles (row-major) per chunk
+    uint32_t chunk_count;
+    std::atomic<uint32_t> workers_ready;
+    std::atomic<uint32_t> start;       // set once every worker is ready
+    std::atomic<uint32_t> abort;       // set by the coordinator on failure
+    std::atomic<uint32_t> next_chunk;  // work counter the workers claim chunks from
+    std::atomic<uint32_t> chunks_done;
+};
+constexpr size_t kDataOffset = (sizeof(SegmentHeader) + 63) / 64 * 64;
+
+size_t GetSegmentSize(size_t pixel_count) {
+    return kDataOffset + pixel_count * (4 * sizeof(float) + sizeof(int32_t) + sizeof(float));
+}
+
+struct SegmentData {
+    float* color;
+    int32_t* samples;
+    float* moment;
+};
+
+SegmentData GetSegmentData(uint8_t* segment, size_t pixel_count) {
+    SegmentData data;
+    data.color = reinterpret_cast<float*>(segment + kDataOffset);
+    data.samples = reinterpret_cast<int32_t*>(data.color + pixel_count * 4);
+    data.moment = reinterpret_cast<float*>(data.samples + pixel_count);
+    return data;
+}
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Terminate every worker, then reap them all so none is left a zombie
+void KillWorkers(std::vector<std::unique_ptr<ChildProcess>>& workers) {
+    for (auto& worker : workers) {
+        worker->Kill();
+    }
+    for (auto& worker : workers) {
+        worker->Wait();
+    }
+}
+
+// Copy the accumulation of one tile from the worker's film into the segment
+void CopyTile(Film* film, const SegmentData& data, int tiles_x, uint32_t tile) {
+    const int width = film->GetWidth();
+    const int x0 = static_cast<int>(tile % tiles_x) * TileScheduler::kTileSize;
+    const int y0 = static_cast<int>(tile / tiles_x) * TileScheduler::kTileSize;
+    const int x1 = std::min(x0 + TileScheduler::kTileSize, width);
+    const int y1 = std::min(y0 + TileScheduler::kTileSize, film->GetHeight());
+    const size_t row_pixels = static_cast<size_t>(x1 - x0);
+    for (int y = y0; y < y1; ++y) {
+        size_t first = static_cast<size_t>(y) * width + x0;
+        std::memcpy(data.color + first * 4, film->GetHostAccumulatedColor() + first * 4,
+                    row_pixels * 4 * sizeof(float));
+        std::memcpy(data.samples + first, film->GetHostAccumulatedSamples() + first, row_pixels * sizeof(int32_t));
+        std::memcpy(data.moment + first, film->GetHostAccumulatedMoment() + first, row_pixels * sizeof(float));
+    }
+}
+
+} // namespace
+
+bool RenderDistributed(const BatchSettings& settings, int worker_count, int threads_per_worker, Film* film,
+                       double* seconds) {
+    if (threads_per_worker <= 0) {
+        threads_per_worker = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / worker_count);
+    }
+    // Chunks give each worker's threads a few tiles each, and stay small
+    // enough that the last ones do not leave most workers idle
+    const TileScheduler& tile_grid = film->GetTileScheduler();
+    const size_t tile_count = tile_grid.GetTileCount();
+    const uint32_t chunk_tiles = static_cast<uint32_t>(std::max(4, 2 * threads_per_worker));
+    const uint32_t chunk_count = static_cast<uint32_t>((tile_count + chunk_tiles - 1) / chunk_tiles);
+    const size_t pixel_count = static_cast<size_t>(settings.width) * settings.height;
+
+    SharedMemory segment;
+    std::string segment_name = SharedMemory::MakeProcessName("shortmarch-film");
+    if (!segment.Create(segment_name, GetSegmentSize(pixel_count))) {
+        grassland::LogError("Failed to create shared memory {}", segment_name);
+        return false;
+    }
+    SegmentHeader* header = new (segment.GetData()) SegmentHeader();
+    header->magic = kSegmentMagic;
+    header->version = kSegmentVersion;
+    header->width = settings.width;
+    header->height = settings.height;
+    header->samples_per_pixel = settings.samples_per_pixel;
+    header->coordinator_id = ChildProcess::GetCurrentId();
+    header->chunk_tiles = chunk_tiles;
+    header->chunk_count = chunk_count;
+
+    std::string program = ChildProcess::GetExecutablePath();
+    std::vector<std::string> args = { "--worker", segment_name, std::to_string(threads_per_worker) };
+    std::vector<std::string> options = FormatBatchSettings(settings);
+    args.insert(args.end(), options.begin(), options.end());
+
+    auto setup_start = Clock::now();
+    std::vector<std::unique_ptr<ChildProcess>> workers;
+    for (int i = 0; i < worker_count; ++i) {
+        workers.push_back(std::make_unique<ChildProcess>());
+        if (!workers.back()->Start(program, args)) {
+            grassland::LogError("Failed to start worker {} ({})", i, program);
+            header->abort.store(1);
+            KillWorkers(workers);
+            return false;
+        }
+    }
+
+    // Every worker loads the scene on its own; keep that out of the render time
+    while (header->workers_ready.load() < static_cast<uint32_t>(worker_count)) {
+        for (size_t i = 0; i < workers.size(); ++i) {
+            if (!workers[i]->IsRunning()) {
+                grassland::LogError("Worker {} exited during setup with code {}", i, workers[i]->Wait());
+                header->abort.store(1);
+                KillWorkers(workers);
+                return false;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    grassland::LogInfo("{} workers ({} threads each) ready after {:.2f} s", worker_count, threads_per_worker,
+                       SecondsSince(setup_start));
+
+    auto start = Clock::now();
+    auto last_report = start;
+    header->start.store(1);
+    while (header->chunks_done.load() < chunk_count) {
+        bool running = false;
+        for (auto& worker : workers) {
+            running = worker->IsRunning() || running;
+        }
+        if (!running) {
+            break;
+        }
+        if (SecondsSince(last_report) >= 5.0) {
+            last_report = Clock::now();
+            grassland::LogInfo("{} of {} chunks after {:.1f} s", header->chunks_done.load(), chunk_count,
+                               SecondsSince(start));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    *seconds = SecondsSince(start);
+
+    bool succeeded = true;
+    for (size_t i = 0; i < workers.size(); ++i) {
+        int exit_code = workers[i]->Wait();
+        if (exit_code != 0) {
+            grassland::LogError("Worker {} exited with code {}", i, exit_code);
+            succeeded = false;
+        }
+    }
+    if (header->chunks_done.load() != chunk_count) {
+        grassland::LogError("Only {} of {} chunks were rendered", header->chunks_done.load(), chunk_count);
+        succeeded = false;
+    }
+    if (!succeeded) {
+        return false;
+    }
+
+    SegmentData data = GetSegmentData(segment.GetData(), pixel_count);
+    film->AddHostAccumulation(data.color, data.samples, data.moment, settings.samples_per_pixel);
+    return true;
+}
+
+int RunWorker(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        grassland::LogError("Usage: --worker <segment> <threads> [batch options]");
+        return 1;
+    }
+    int threads = 0;
+    try {
+        threads = std::stoi(args[1]);
+    } catch (const std::exception&) {
+        grassland::LogError("Invalid worker thread count: {}", args[1]);
+        return 1;
+    }
+    // Before anything touches the pool
+    ThreadPool::SetGlobalThreadCount(static_cast<size_t>(std::max(threads, 1)));
+
+    BatchSettings settings;
+    if (!ParseBatchSettings(std::vector<std::string>(args.begin() + 2, args.end()), &settings)) {
+        return 1;
+    }
+    SharedMemory segment;
+    if (!segment.Open(args[0])) {
+        grassland::LogError("Failed to open shared memory {}", args[0]);
+        return 1;
+    }
+    const size_t pixel_count = static_cast<size_t>(settings.width) * settings.height;
+    SegmentHeader* header = reinterpret_cast<SegmentHeader*>(segment.GetData());
+    if (segment.GetSize() < GetSegmentSize(pixel_count) || header->magic != kSegmentMagic ||
+        header->version != kSegmentVersion || header->width != settings.width ||
+        header->height != settings.height) {
+        grassland::LogError("Shared memory {} does not match the worker settings", args[0]);
+        return 1;
+    }
+
+    // Same setup as the CPU path of the batch renderer, without a device
+    Scene scene(nullptr);
+    SceneFileData scene_data;
+    std::string scene_file = settings.scene_file.empty() ? GetDefaultSceneDirectory() + "/default.json"
+                                                         : settings.scene_file;
+    if (!LoadSceneFile(scene_file, &scene, &scene_data)) {
+        return 1;
+    }
+    SceneCamera camera = settings.override_camera ? settings.camera : scene_data.camera;
+    float fov = settings.fov > 0.0f ? settings.fov : camera.fov;
+    TextureAtlas textures;
+    for (const auto& texture : scene_data.textures) {
+        textures.AddTexture(texture.path, texture.mip_levels);
+    }
+    EnvironmentMap environment;
+    if (settings.environment_light) {
+        environment.Build(textures);
+    }
+    scene.BuildAccelerationStructures();
+    scene.BuildCpuAccelerationStructures();
+    CpuRenderer renderer(&scene, &textures);
+    renderer.SetLights(scene_data.point_lights, scene_data.area_lights);
+    renderer.SetLightSelection(settings.light_selection);
+    renderer.SetEnvironment(&environment);
+    renderer.SetEnvironmentLight(settings.environment_light);
+    renderer.SetSamplerType(settings.sampler_type);
+    renderer.SetSampleOffset(settings.sample_offset);
+    CameraObject camera_object = MakeSceneCameraObject(camera, fov, settings.width, settings.height);
+    Film film(nullptr, settings.width, settings.height);
+
+    header->workers_ready.fetch_add(1);
+    while (!header->start.load()) {
+        if (header->abort.load()) {
+            return 1;
+        }
+        if (!ChildProcess::IsParentRunning(header->coordinator_id)) {
+            grassland::LogError("Coordinator exited before the render started");
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    SegmentData data = GetSegmentData(segment.GetData(), pixel_count);
+    const int tiles_x = film.GetTileScheduler().GetTilesX();
+    const uint32_t tile_count = static_cast<uint32_t>(film.GetTileScheduler().GetTileCount());
+    std::vector<uint32_t> tiles;
+    while (!header->abort.load()) {
+        if (!ChildProcess::IsParentRunning(header->coordinator_id)) {
+            grassland::LogError("Coordinator exited during the render");
+            return 1;
+        }
+        uint32_t chunk = header->next_chunk.fetch_add(1);
+        if (chunk >= header->chunk_count) {
+            break;
+        }
+        tiles.clear();
+        for (uint32_t tile = chunk * header->chunk_tiles;
+             tile < std::min(tile_count, (chunk + 1) * header->chunk_tiles); ++tile) {
+            tiles.push_back(tile);
+        }
+        renderer.SetTiles(tiles);
+        for (int sample = 0; sample < header->samples_per_pixel; ++sample) {
+            renderer.RenderSample(camera_object, &film);
+        }
+        for (uint32_t tile : tiles) {
+            CopyTile(&film, data, tiles_x, tile);
+        }
+        header->chunks_done.fetch_add(1);
+    }
+    return 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "BatchRenderer.h"
+#include "Film.h"
+#include <string>
+#include <vector>
+
+// CPU batch rendering split across local worker processes. The coordinator
+// starts copies of this executable in worker mode and shares a memory segment
+// with them that holds a chunk counter and the film's accumulation. Each
+// worker loads the scene headlessly, claims chunks of tiles from the counter
+// and renders every sample of a chunk before writing its pixels back. A pixel
+// is only ever rendered by one process, starting from sample 0, so the merged
+// film matches a single-process render.
+
+// Render settings.samples_per_pixel samples with worker_count workers and add
+// the merged accumulation to film (settings' size). Each worker's thread pool
+// gets threads_per_worker threads (0: the machine's threads divided among the
+// workers). seconds receives the render time, counted from when every worker
+// finished loading. Returns false if a worker could not start or failed.
+bool RenderDistributed(const BatchSettings& settings, int worker_count, int threads_per_worker, Film* film,
+                       double* seconds);
+
+// Entry point of a worker process:
+// ShortMarchDemo --worker <segment> <threads> [batch options]
+// Returns the process exit code.
+int RunWorker(const std::vector<std::string>& args);
@@ -8,62 +8,47 @@ Entity::Entity(const std::string& obj_file_path,
     : material_(material)
     , transform_(transform)
     , velocity_(velocity)
-    , mesh_loaded_(false) {
+    , transform_dirty_(false) {
     
     LoadMesh(obj_file_path);
 }
 
+Entity::Entity(std::shared_ptr<MeshResource> mesh,
+               const Material& material,
+               const glm::mat4& transform,
+               const glm::vec3& velocity)
+    : mesh_(std::move(mesh))
+    , material_(material)
+    , transform_(transform)
+    , velocity_(velocity)
+    , transform_dirty_(false) {
+}
+
 Entity::~Entity() {
-    blas_.reset();
-    index_buffer_.reset();
-    vertex_buffer_.reset();
+    mesh_.reset();
 }
 
 bool Entity::LoadMesh(const std::string& obj_file_path) {
-    // Try to load the OBJ file
-    std::string full_path = grassland::FindAssetFile(obj_file_path);
-    
-    if (mesh_.LoadObjFile(full_path) != 0) {
-        grassland::LogError("Failed to load mesh from: {}", obj_file_path);
-        mesh_loaded_ = false;
-        return false;
-    }
-
-    grassland::LogInfo("Successfully loaded mesh: {} ({} vertices, {} indices)", 
-                       obj_file_path, mesh_.NumVertices(), mesh_.NumIndices());
-    
-    mesh_loaded_ = true;
-    return true;
+    mesh_ = MeshCache::Global().Acquire(obj_file_path);
+    return mesh_ != nullptr;
 }
 
 void Entity::BuildBLAS(grassland::graphics::Core* core) {
-    if (!mesh_loaded_) {
+    if (!IsValid()) {
         grassland::LogError("Cannot build BLAS: mesh not loaded");
         return;
     }
+    if (!core) {
+        return; // Headless: only the CPU renderer will consume this entity
+    }
+    mesh_->BuildBLAS(core);
+}
 
-    // Create vertex buffer
-    size_t vertex_buffer_size = mesh_.NumVertices() * sizeof(glm::vec3);
-    core->CreateBuffer(vertex_buffer_size, 
-                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
-                      &vertex_buffer_);
-    vertex_buffer_->UploadData(mesh_.Positions(), vertex_buffer_size);
-
-    // Create index buffer
-    size_t index_buffer_size = mesh_.NumIndices() * sizeof(uint32_t);
-    core->CreateBuffer(index_buffer_size, 
-                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
-                      &index_buffer_);
-    index_buffer_->UploadData(mesh_.Indices(), index_buffer_size);
-
-    // Build BLAS
-    core->CreateBottomLevelAccelerationStructure(
-        vertex_buffer_.get(), 
-        index_buffer_.get(), 
-        sizeof(glm::vec3), 
-        &blas_);
-
-    grassland::LogInfo("Built BLAS for entity");
+void Entity::BuildBVH() {
+    if (!IsValid()) {
+        return;
+    }
+    mesh_->BuildBVH();
 }
 
 void Entity::UpdateAnimation() {
@@ -71,5 +56,6 @@ void Entity::UpdateAnimation() {
         float move_per_frame = 0.01f;
         glm::vec3 displacement = velocity_ * move_per_frame;
         transform_ = glm::translate(transform_, displacement);
+        transform_dirty_ = true;
     }
 }
\ No newline at end of file
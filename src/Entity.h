@@ -1,8 +1,11 @@
 #pragma once
 #include "long_march.h"
 #include "Material.h"
+#include "MeshResource.h"
 
-// Entity represents a mesh instance with a material and transform
+// Entity represents a mesh instance with a material and transform.
+// Geometry is shared through MeshCache, so entities loading the same OBJ path
+// share one vertex/index allocation, one BLAS and one CPU BVH.
 class Entity {
 public:
     Entity(const std::string& obj_file_path, 
@@ -10,60 +13,73 @@ public:
            const glm::mat4& transform = glm::mat4(1.0f),
 		   const glm::vec3& velocity = glm::vec3(0.0f));
 
+    // Instance geometry that does not come from an OBJ file
+    Entity(std::shared_ptr<MeshResource> mesh,
+           const Material& material = Material(),
+           const glm::mat4& transform = glm::mat4(1.0f),
+           const glm::vec3& velocity = glm::vec3(0.0f));
+
     ~Entity();
 
-    // Load mesh from OBJ file
+    // Queue the OBJ file for loading (or reuse it if another entity already did).
+    // Parsing runs on the thread pool; IsValid() waits for it to finish.
     bool LoadMesh(const std::string& obj_file_path);
 
     // Getters
-    grassland::graphics::Buffer* GetVertexBuffer() const { return vertex_buffer_.get(); }
-    grassland::graphics::Buffer* GetIndexBuffer() const { return index_buffer_.get(); }
+    grassland::graphics::Buffer* GetVertexBuffer() const { return mesh_ ? mesh_->GetVertexBuffer() : nullptr; }
+    grassland::graphics::Buffer* GetIndexBuffer() const { return mesh_ ? mesh_->GetIndexBuffer() : nullptr; }
     const Material& GetMaterial() const { return material_; }
     const glm::vec3& GetVelocity() const { return velocity_; }
     const glm::mat4& GetTransform() const { return transform_; }
-    grassland::graphics::AccelerationStructure* GetBLAS() const { return blas_.get(); }
+    grassland::graphics::AccelerationStructure* GetBLAS() const { return mesh_ ? mesh_->GetBLAS() : nullptr; }
+    const std::shared_ptr<MeshResource>& GetMesh() const { return mesh_; }
     
-    const Eigen::Vector3f* GetMeshPositions() const { return mesh_.Positions(); }
-    const uint32_t* GetMeshIndices() const { return mesh_.Indices(); }
-    uint32_t GetVertexCount() const { return mesh_.NumVertices(); }
-    uint32_t GetIndexCount() const { return mesh_.NumIndices(); }
+    const glm::vec3* GetMeshPositions() const { return mesh_->GetPositions(); }
+    const uint32_t* GetMeshIndices() const { return mesh_->GetIndices(); }
+    uint32_t GetVertexCount() const { return mesh_->GetVertexCount(); }
+    uint32_t GetIndexCount() const { return mesh_->GetIndexCount(); }
     
     std::vector<float> GetMeshPositionsAsFloatArray() const {
-        const Eigen::Vector3f* positions = mesh_.Positions();
-        uint32_t vertex_count = mesh_.NumVertices();
+        const glm::vec3* positions = mesh_->GetPositions();
+        uint32_t vertex_count = mesh_->GetVertexCount();
         std::vector<float> result(vertex_count * 3);
         
         for (uint32_t i = 0; i < vertex_count; i++) {
-            result[i * 3 + 0] = positions[i].x();
-            result[i * 3 + 1] = positions[i].y();
-            result[i * 3 + 2] = positions[i].z();
+            result[i * 3 + 0] = positions[i].x;
+            result[i * 3 + 1] = positions[i].y;
+            result[i * 3 + 2] = positions[i].z;
         }
         return result;
     }
 
-    // Setters
+    // Setters. Entities already in a scene should move through
+    // Scene::SetEntityTransform so their TLAS instance gets rewritten.
     void SetMaterial(const Material& material) { material_ = material; }
-    void SetTransform(const glm::mat4& transform) { transform_ = transform; }
+    void SetTransform(const glm::mat4& transform) { transform_ = transform; transform_dirty_ = true; }
     void SetVelocity(const glm::vec3& velocity) { velocity_ = velocity; }
     
     void UpdateAnimation();
+    bool IsAnimated() const { return velocity_ != glm::vec3(0.0f); }
+
+    // Set whenever the transform changes, cleared once the scene has written it to the TLAS
+    bool IsTransformDirty() const { return transform_dirty_; }
+    void ClearTransformDirty() { transform_dirty_ = false; }
 
-    // Create BLAS for this entity's mesh
+    // Create BLAS for this entity's mesh (no-op without a device or if already built)
     void BuildBLAS(grassland::graphics::Core* core);
 
-    // Check if mesh is loaded
-    bool IsValid() const { return mesh_loaded_; }
+    // Build the CPU-side BVH used by the reference renderer
+    void BuildBVH();
+    const Bvh& GetBVH() const { return mesh_->GetBVH(); }
+
+    // Check if mesh is loaded (blocks until parsing has finished)
+    bool IsValid() const { return mesh_ && mesh_->IsValid(); }
 
 private:
-    grassland::Mesh<float> mesh_;
+    std::shared_ptr<MeshResource> mesh_;
     Material material_;
     glm::mat4 transform_;
     glm::vec3 velocity_;
-
-    std::unique_ptr<grassland::graphics::Buffer> vertex_buffer_;
-    std::unique_ptr<grassland::graphics::Buffer> index_buffer_;
-    std::unique_ptr<grassland::graphics::AccelerationStructure> blas_;
-
-    bool mesh_loaded_;
+    bool transform_dirty_;
 };
 
@@ -0,0 +1,107 @@
+#include "EnvironmentMap.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+constexpr float kPi = 3.14159265358979323846f;
+
+} // namespace
+
+glm::vec2 EnvironmentMap::DirectionToUv(const glm::vec3& direction) {
+    glm::vec3 d = glm::normalize(direction);
+    return glm::vec2(0.5f + std::atan2(d.z, d.x) / (2.0f * kPi), 0.5f - std::asin(std::clamp(d.y, -1.0f, 1.0f)) / kPi);
+}
+
+glm::vec3 EnvironmentMap::UvToDirection(const glm::vec2& uv) {
+    float phi = (uv.x - 0.5f) * 2.0f * kPi;
+    float elevation = (0.5f - uv.y) * kPi;
+    float cos_elevation = std::cos(elevation);
+    return glm::vec3(cos_elevation * std::cos(phi), std::sin(elevation), cos_elevation * std::sin(phi));
+}
+
+void EnvironmentMap::Clear() {
+    width_ = 0;
+    height_ = 0;
+    entries_.clear();
+}
+
+bool EnvironmentMap::Build(const TextureAtlas& textures, uint32_t texture_index) {
+    Clear();
+    if (texture_index >= textures.GetTextureCount()) {
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    const TextureInfo& info = textures.GetInfos()[texture_index];
+    const float* texels = textures.GetData().data() + static_cast<size_t>(info.offset) * 4;
+    const uint32_t width = info.width;
+    const uint32_t height = info.height;
+
+    // Conditional tables per row. Weights are luminance times the solid angle
+    // of the texel (cos of its elevation); a small floor keeps every texel
+    // reachable, so the estimator stays unbiased next to black regions.
+    std::vector<AliasTable::Entry> entries(static_cast<size_t>(height) * (width + 1));
+    std::vector<float> row_weights(height);
+    ThreadPool::Global().ParallelFor(height, [&](size_t y) {
+        float cos_elevation = std::cos((0.5f - (y + 0.5f) / height) * kPi);
+        std::vector<float> weights(width);
+        for (uint32_t x = 0; x < width; ++x) {
+            const float* texel = texels + (y * width + x) * 4;
+            float luminance = 0.2126f * texel[0] + 0.7152f * texel[1] + 0.0722f * texel[2];
+            weights[x] = (std::max(luminance, 0.0f) + 1e-3f) * cos_elevation;
+        }
+        AliasTable row;
+        row.Build(weights);
+        row_weights[y] = static_cast<float>(row.GetTotalWeight());
+        if (row.IsEmpty()) {
+            // Degenerate row: uniform, but the marginal never picks it
+            for (uint32_t x = 0; x < width; ++x) {
+                entries[height + y * width + x] = { 1.0f, x, 1.0f / width, 0 };
+            }
+        } else {
+            std::copy(row.GetEntries().begin(), row.GetEntries().end(), entries.begin() + height + y * width);
+        }
+    });
+
+    AliasTable marginal;
+    marginal.Build(row_weights);
+    if (marginal.IsEmpty()) {
+        return false;
+    }
+    std::copy(marginal.GetEntries().begin(), marginal.GetEntries().end(), entries.begin());
+    entries_ = std::move(entries);
+    width_ = width;
+    height_ = height;
+    grassland::LogInfo("Environment map: {}x{} sampling tables built in {:.1f} ms", width, height,
+                       std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    return true;
+}
+
+glm::vec3 EnvironmentMap::Sample(const glm::vec2& u, float* pdf) const {
+    float row_pdf, column_pdf, jitter_y, jitter_x;
+    uint32_t y = AliasTable::Sample(entries_.data(), height_, u.x, &row_pdf, &jitter_y);
+    uint32_t x = AliasTable::Sample(entries_.data() + height_ + static_cast<size_t>(y) * width_, width_, u.y,
+                                    &column_pdf, &jitter_x);
+    glm::vec2 uv((x + jitter_x) / width_, (y + jitter_y) / height_);
+    // Texels are uniform in uv; the equirectangular map stretches them by
+    // 2 pi^2 cos(elevation) in solid angle
+    float cos_elevation = std::cos((0.5f - uv.y) * kPi);
+    *pdf = cos_elevation > 0.0f
+               ? row_pdf * column_pdf * width_ * height_ / (2.0f * kPi * kPi * cos_elevation)
+               : 0.0f;
+    return UvToDirection(uv);
+}
+
+float EnvironmentMap::GetPdf(const glm::vec3& direction) const {
+    glm::vec2 uv = DirectionToUv(direction);
+    uint32_t x = std::min(static_cast<uint32_t>(std::max(uv.x, 0.0f) * width_), width_ - 1);
+    uint32_t y = std::min(static_cast<uint32_t>(std::max(uv.y, 0.0f) * height_), height_ - 1);
+    float cos_elevation = std::cos((0.5f - uv.y) * kPi);
+    if (cos_elevation <= 0.0f) {
+        return 0.0f;
+    }
+    return entries_[y].pdf * entries_[height_ + static_cast<size_t>(y) * width_ + x].pdf * width_ * height_ /
+           (2.0f * kPi * kPi * cos_elevation);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "long_march.h"
+#include "AliasTable.h"
+#include "Texture.h"
+#include <vector>
+
+// Importance sampling of the equirectangular sky (the texture MissMain
+// samples). Texels are drawn in proportion to luminance times their solid
+// angle through a marginal alias table over rows and one conditional table
+// per row, so the direct-light path can aim rays at the bright parts of the
+// sky. shaders/shader.hlsl samples the same packed tables.
+class EnvironmentMap {
+public:
+    static constexpr uint32_t kTextureIndex = 3;
+
+    // Build from mip 0 of texture_index; the rows are processed in parallel
+    // on the global thread pool. Leaves the map empty (and returns false)
+    // when the texture is missing or black.
+    bool Build(const TextureAtlas& textures, uint32_t texture_index = kTextureIndex);
+    void Clear();
+
+    // Direction towards the sky for u in [0, 1)^2 and its solid angle pdf.
+    // The map must not be empty.
+    glm::vec3 Sample(const glm::vec2& u, float* pdf) const;
+    // Solid angle pdf with which Sample returns direction
+    float GetPdf(const glm::vec3& direction) const;
+
+    // Same mapping as MissMain
+    static glm::vec2 DirectionToUv(const glm::vec3& direction);
+    static glm::vec3 UvToDirection(const glm::vec2& uv);
+
+    bool IsEmpty() const { return entries_.empty(); }
+    uint32_t GetWidth() const { return width_; }
+    uint32_t GetHeight() const { return height_; }
+    // height marginal entries over the rows, then width conditional entries per row
+    const std::vector<AliasTable::Entry>& GetEntries() const { return entries_; }
+
+private:
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    std::vector<AliasTable::Entry> entries_;
+};
@@ -1,22 +1,77 @@
 #include "Film.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define FILM_USE_SSE 1
+#include <immintrin.h>
+#endif
+
+namespace {
+#include "built_in_shaders.inl"
+
+// Pixels per host develop task; large enough to amortize scheduling
+constexpr size_t kDevelopTilePixels = 16384;
+
+// dst += src over pixel_count pixels; moment arrays may be null
+void SumAccumulation(float* dst_color, int32_t* dst_samples, float* dst_moment,
+                     const float* color, const int32_t* samples, const float* moment, size_t pixel_count) {
+    size_t tile_count = (pixel_count + kDevelopTilePixels - 1) / kDevelopTilePixels;
+    ThreadPool::Global().ParallelFor(tile_count, [&](size_t tile) {
+        size_t begin = tile * kDevelopTilePixels;
+        size_t end = std::min(pixel_count, begin + kDevelopTilePixels);
+        for (size_t i = begin * 4; i < end * 4; i++) {
+            dst_color[i] += color[i];
+        }
+        for (size_t i = begin; i < end; i++) {
+            dst_samples[i] += samples[i];
+        }
+        if (dst_moment && moment) {
+            for (size_t i = begin; i < end; i++) {
+                dst_moment[i] += moment[i];
+            }
+        }
+    });
+}
+}
 
 Film::Film(grassland::graphics::Core* core, int width, int height)
     : core_(core)
     , width_(width)
     , height_(height)
-    , sample_count_(0) {
+    , sample_count_(0)
+    , aovs_(0)
+    , host_accumulation_(core == nullptr)
+    , device_develop_(true)
+    , developed_sample_count_(0)
+    , tile_scheduler_(width, height) {
     
     CreateImages();
+    CreateDevelopProgram();
     Reset();
 }
 
 Film::~Film() {
+    develop_program_.reset();
+    develop_shader_.reset();
     accumulated_color_image_.reset();
     accumulated_samples_image_.reset();
+    accumulated_moment_image_.reset();
     output_image_.reset();
+    aov_albedo_image_.reset();
+    aov_normal_image_.reset();
+    aov_depth_image_.reset();
+    aov_instance_id_image_.reset();
 }
 
 void Film::CreateImages() {
+    if (host_accumulation_) {
+        AllocateHostBuffers();
+    }
+    if (!core_) {
+        return;
+    }
+
     // Create accumulated color image (RGBA32F for high precision accumulation)
     core_->CreateImage(width_, height_, 
                       grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT,
@@ -26,49 +81,397 @@ void Film::CreateImages() {
     core_->CreateImage(width_, height_, 
                       grassland::graphics::IMAGE_FORMAT_R32_SINT,
                       &accumulated_samples_image_);
+
+    // Create accumulated moment image (R32F sum of squared luminances)
+    core_->CreateImage(width_, height_, 
+                      grassland::graphics::IMAGE_FORMAT_R32_SFLOAT,
+                      &accumulated_moment_image_);
     
     // Create output image (RGBA32F for final result)
     core_->CreateImage(width_, height_, 
                       grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT,
                       &output_image_);
+
+    CreateAovImages();
+}
+
+void Film::CreateAovImages() {
+    if (!core_) {
+        return;
+    }
+    // Layers that are not requested cost no device memory
+    auto create = [this](uint32_t aov, grassland::graphics::ImageFormat format,
+                         std::unique_ptr<grassland::graphics::Image>* image) {
+        if (aovs_ & aov) {
+            if (!*image) {
+                core_->CreateImage(width_, height_, format, image);
+            }
+        } else {
+            image->reset();
+        }
+    };
+    create(kAovAlbedo, grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT, &aov_albedo_image_);
+    create(kAovNormal, grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT, &aov_normal_image_);
+    create(kAovDepth, grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT, &aov_depth_image_);
+    create(kAovInstanceId, grassland::graphics::IMAGE_FORMAT_R32_SINT, &aov_instance_id_image_);
+}
+
+void Film::CreateDevelopProgram() {
+    if (!core_) {
+        return;
+    }
+    if (core_->CreateShader(GetShaderCode("shaders/develop.hlsl"), "DevelopMain", "cs_6_0", &develop_shader_) != 0 ||
+        core_->CreateComputeProgram(develop_shader_.get(), &develop_program_) != 0) {
+        grassland::LogWarning("Develop compute pass unavailable, developing on the host");
+        develop_program_.reset();
+        return;
+    }
+    develop_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);  // space0 - accumulated color
+    develop_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);  // space1 - accumulated samples
+    develop_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);  // space2 - output
+    develop_program_->Finalize();
 }
 
 void Film::Reset() {
-    // Clear accumulated color to black
-    std::unique_ptr<grassland::graphics::CommandContext> cmd_context;
-    core_->CreateCommandContext(&cmd_context);
-    cmd_context->CmdClearImage(accumulated_color_image_.get(), { {0.0f, 0.0f, 0.0f, 0.0f} });
-    cmd_context->CmdClearImage(accumulated_samples_image_.get(), { {0, 0, 0, 0} });
-    cmd_context->CmdClearImage(output_image_.get(), { {0.0f, 0.0f, 0.0f, 0.0f} });
-    core_->SubmitCommandContext(cmd_context.get());
+    if (core_) {
+        // Clear accumulated color to black
+        std::unique_ptr<grassland::graphics::CommandContext> cmd_context;
+        core_->CreateCommandContext(&cmd_context);
+        cmd_context->CmdClearImage(accumulated_color_image_.get(), { {0.0f, 0.0f, 0.0f, 0.0f} });
+        cmd_context->CmdClearImage(accumulated_samples_image_.get(), { {0, 0, 0, 0} });
+        cmd_context->CmdClearImage(accumulated_moment_image_.get(), { {0.0f, 0.0f, 0.0f, 0.0f} });
+        cmd_context->CmdClearImage(output_image_.get(), { {0.0f, 0.0f, 0.0f, 0.0f} });
+        for (auto* image : { aov_albedo_image_.get(), aov_normal_image_.get(), aov_depth_image_.get() }) {
+            if (image) {
+                cmd_context->CmdClearImage(image, { {0.0f, 0.0f, 0.0f, 0.0f} });
+            }
+        }
+        if (aov_instance_id_image_) {
+            cmd_context->CmdClearImage(aov_instance_id_image_.get(), { {-1, 0, 0, 0} });
+        }
+        core_->SubmitCommandContext(cmd_context.get());
+    }
+    if (host_accumulation_) {
+        std::fill(host_accumulated_color_.begin(), host_accumulated_color_.end(), 0.0f);
+        std::fill(host_accumulated_samples_.begin(), host_accumulated_samples_.end(), 0);
+        std::fill(host_accumulated_moment_.begin(), host_accumulated_moment_.end(), 0.0f);
+        std::fill(host_output_.begin(), host_output_.end(), 0.0f);
+        std::fill(host_aov_albedo_.begin(), host_aov_albedo_.end(), 0.0f);
+        std::fill(host_aov_normal_.begin(), host_aov_normal_.end(), 0.0f);
+        std::fill(host_aov_depth_.begin(), host_aov_depth_.end(), 0.0f);
+        std::fill(host_aov_instance_id_.begin(), host_aov_instance_id_.end(), -1);
+    }
     
     sample_count_ = 0;
+    developed_sample_count_ = 0;
+    tile_scheduler_.Reset();
     grassland::LogInfo("Film accumulation reset");
 }
 
-void Film::DevelopToOutput() {
-    // This would ideally be done in a compute shader for efficiency
-    // For now, we'll do it on the CPU (simple but potentially slow)
-    
-    if (sample_count_ == 0) {
+void Film::DevelopToOutput(grassland::graphics::CommandContext* command_context) {
+    if (sample_count_ == developed_sample_count_) {
         return;
     }
+    developed_sample_count_ = sample_count_;
 
-    // Download accumulated color and samples
-    size_t color_size = width_ * height_ * sizeof(float) * 4;
-    std::vector<float> accumulated_colors(width_ * height_ * 4);
-    accumulated_color_image_->DownloadData(accumulated_colors.data());
+    if (host_accumulation_) {
+        DevelopOnHost(host_accumulated_color_.data(), host_accumulated_samples_.data(), host_output_.data());
+        if (core_) {
+            output_image_->UploadData(host_output_.data());
+        }
+        return;
+    }
 
-    // Divide by sample count to get average
-    std::vector<float> output_colors(width_ * height_ * 4);
-    for (int i = 0; i < width_ * height_ * 4; i++) {
-        output_colors[i] = accumulated_colors[i] / static_cast<float>(sample_count_);
+    if (IsDeviceDevelop()) {
+        std::unique_ptr<grassland::graphics::CommandContext> own_context;
+        if (!command_context) {
+            core_->CreateCommandContext(&own_context);
+            command_context = own_context.get();
+        }
+        command_context->CmdBindComputeProgram(develop_program_.get());
+        command_context->CmdBindResources(0, { accumulated_color_image_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdBindResources(1, { accumulated_samples_image_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdBindResources(2, { output_image_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdDispatch((width_ + 7) / 8, (height_ + 7) / 8, 1);
+        if (own_context) {
+            core_->SubmitCommandContext(own_context.get());
+        }
+        return;
     }
 
-    // Upload to output image
+    // Fallback: round trip through host memory
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    std::vector<float> accumulated_colors(pixel_count * 4);
+    std::vector<int32_t> accumulated_samples(pixel_count);
+    std::vector<float> output_colors(pixel_count * 4);
+    accumulated_color_image_->DownloadData(accumulated_colors.data());
+    accumulated_samples_image_->DownloadData(accumulated_samples.data());
+    DevelopOnHost(accumulated_colors.data(), accumulated_samples.data(), output_colors.data());
     output_image_->UploadData(output_colors.data());
 }
 
+void Film::DevelopOnHost(const float* accumulated_color, const int32_t* accumulated_samples, float* output) const {
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    size_t tile_count = (pixel_count + kDevelopTilePixels - 1) / kDevelopTilePixels;
+    ThreadPool::Global().ParallelFor(tile_count, [&](size_t tile) {
+        size_t begin = tile * kDevelopTilePixels;
+        size_t end = std::min(pixel_count, begin + kDevelopTilePixels);
+        // Neighbouring pixels almost always share a sample count
+        int32_t last_samples = 0;
+        float scale = 0.0f;
+        for (size_t i = begin; i < end; i++) {
+            int32_t samples = accumulated_samples[i];
+            if (samples != last_samples) {
+                last_samples = samples;
+                scale = samples > 0 ? 1.0f / static_cast<float>(samples) : 0.0f;
+            }
+#if FILM_USE_SSE
+            // One RGBA pixel per vector
+            _mm_storeu_ps(output + i * 4, _mm_mul_ps(_mm_loadu_ps(accumulated_color + i * 4), _mm_set1_ps(scale)));
+#else
+            for (size_t c = 0; c < 4; c++) {
+                output[i * 4 + c] = accumulated_color[i * 4 + c] * scale;
+            }
+#endif
+        }
+    });
+}
+
+void Film::AllocateHostBuffers() {
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    host_accumulated_color_.assign(pixel_count * 4, 0.0f);
+    host_accumulated_samples_.assign(pixel_count, 0);
+    host_accumulated_moment_.assign(pixel_count, 0.0f);
+    host_output_.assign(pixel_count * 4, 0.0f);
+    AllocateHostAovBuffers();
+}
+
+void Film::AllocateHostAovBuffers() {
+    // Swapping with an empty vector releases the memory of dropped layers
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    if (aovs_ & kAovAlbedo) {
+        host_aov_albedo_.assign(pixel_count * 4, 0.0f);
+    } else {
+        std::vector<float>().swap(host_aov_albedo_);
+    }
+    if (aovs_ & kAovNormal) {
+        host_aov_normal_.assign(pixel_count * 4, 0.0f);
+    } else {
+        std::vector<float>().swap(host_aov_normal_);
+    }
+    if (aovs_ & kAovDepth) {
+        host_aov_depth_.assign(pixel_count * 4, 0.0f);
+    } else {
+        std::vector<float>().swap(host_aov_depth_);
+    }
+    if (aovs_ & kAovInstanceId) {
+        host_aov_instance_id_.assign(pixel_count, -1);
+    } else {
+        std::vector<int32_t>().swap(host_aov_instance_id_);
+    }
+}
+
+float* Film::GetHostAccumulatedColor() {
+    if (host_accumulated_color_.empty()) {
+        AllocateHostBuffers();
+    }
+    return host_accumulated_color_.data();
+}
+
+int32_t* Film::GetHostAccumulatedSamples() {
+    if (host_accumulated_samples_.empty()) {
+        AllocateHostBuffers();
+    }
+    return host_accumulated_samples_.data();
+}
+
+float* Film::GetHostAccumulatedMoment() {
+    if (host_accumulated_moment_.empty()) {
+        AllocateHostBuffers();
+    }
+    return host_accumulated_moment_.data();
+}
+
+void Film::SetAovs(uint32_t aovs) {
+    if (aovs == aovs_) {
+        return;
+    }
+    aovs_ = aovs;
+    CreateAovImages();
+    if (host_accumulation_) {
+        AllocateHostAovBuffers();
+    }
+    Reset();
+}
+
+grassland::graphics::Image* Film::GetAovImage(Aov aov) const {
+    switch (aov) {
+    case kAovAlbedo:
+        return aov_albedo_image_.get();
+    case kAovNormal:
+        return aov_normal_image_.get();
+    case kAovDepth:
+        return aov_depth_image_.get();
+    case kAovInstanceId:
+        return aov_instance_id_image_.get();
+    }
+    return nullptr;
+}
+
+float* Film::GetHostAovAlbedo() {
+    if (!(aovs_ & kAovAlbedo)) {
+        return nullptr;
+    }
+    if (host_aov_albedo_.empty()) {
+        AllocateHostAovBuffers();
+    }
+    return host_aov_albedo_.data();
+}
+
+float* Film::GetHostAovNormal() {
+    if (!(aovs_ & kAovNormal)) {
+        return nullptr;
+    }
+    if (host_aov_normal_.empty()) {
+        AllocateHostAovBuffers();
+    }
+    return host_aov_normal_.data();
+}
+
+float* Film::GetHostAovDepth() {
+    if (!(aovs_ & kAovDepth)) {
+        return nullptr;
+    }
+    if (host_aov_depth_.empty()) {
+        AllocateHostAovBuffers();
+    }
+    return host_aov_depth_.data();
+}
+
+int32_t* Film::GetHostAovInstanceId() {
+    if (!(aovs_ & kAovInstanceId)) {
+        return nullptr;
+    }
+    if (host_aov_instance_id_.empty()) {
+        AllocateHostAovBuffers();
+    }
+    return host_aov_instance_id_.data();
+}
+
+size_t Film::GetAovPixelSize(Aov aov) {
+    return aov == kAovInstanceId ? sizeof(int32_t) : 4 * sizeof(float);
+}
+
+void Film::CopyAov(Aov aov, void* data) {
+    if (!(aovs_ & aov)) {
+        return;
+    }
+    if (!host_accumulation_) {
+        GetAovImage(aov)->DownloadData(data);
+        return;
+    }
+    const void* source = nullptr;
+    switch (aov) {
+    case kAovAlbedo:
+        source = host_aov_albedo_.data();
+        break;
+    case kAovNormal:
+        source = host_aov_normal_.data();
+        break;
+    case kAovDepth:
+        source = host_aov_depth_.data();
+        break;
+    case kAovInstanceId:
+        source = host_aov_instance_id_.data();
+        break;
+    }
+    std::memcpy(data, source, static_cast<size_t>(width_) * height_ * GetAovPixelSize(aov));
+}
+
+void Film::SetHostAccumulation(bool enabled) {
+    if (!core_) {
+        return; // Headless films are always host-accumulated
+    }
+    if (host_accumulation_ == enabled) {
+        return;
+    }
+    host_accumulation_ = enabled;
+    if (enabled) {
+        AllocateHostBuffers();
+    } else {
+        host_accumulated_color_.clear();
+        host_accumulated_samples_.clear();
+        host_accumulated_moment_.clear();
+        host_output_.clear();
+        std::vector<float>().swap(host_aov_albedo_);
+        std::vector<float>().swap(host_aov_normal_);
+        std::vector<float>().swap(host_aov_depth_);
+        std::vector<int32_t>().swap(host_aov_instance_id_);
+    }
+    Reset();
+}
+
+void Film::UploadHostAccumulation() {
+    if (!core_ || host_accumulated_color_.empty()) {
+        return;
+    }
+    accumulated_color_image_->UploadData(host_accumulated_color_.data());
+    accumulated_samples_image_->UploadData(host_accumulated_samples_.data());
+    accumulated_moment_image_->UploadData(host_accumulated_moment_.data());
+    if (!host_aov_albedo_.empty()) {
+        aov_albedo_image_->UploadData(host_aov_albedo_.data());
+    }
+    if (!host_aov_normal_.empty()) {
+        aov_normal_image_->UploadData(host_aov_normal_.data());
+    }
+    if (!host_aov_depth_.empty()) {
+        aov_depth_image_->UploadData(host_aov_depth_.data());
+    }
+    if (!host_aov_instance_id_.empty()) {
+        aov_instance_id_image_->UploadData(host_aov_instance_id_.data());
+    }
+}
+
+void Film::AddHostAccumulation(const float* color, const int32_t* samples, const float* moment,
+                               int sample_count) {
+    SumAccumulation(GetHostAccumulatedColor(), GetHostAccumulatedSamples(), GetHostAccumulatedMoment(),
+                    color, samples, moment, static_cast<size_t>(width_) * height_);
+    sample_count_ += sample_count;
+}
+
+void Film::CopyAccumulation(float* color, int32_t* samples, float* moment) {
+    if (host_accumulation_) {
+        std::copy(host_accumulated_color_.begin(), host_accumulated_color_.end(), color);
+        std::copy(host_accumulated_samples_.begin(), host_accumulated_samples_.end(), samples);
+        std::copy(host_accumulated_moment_.begin(), host_accumulated_moment_.end(), moment);
+        return;
+    }
+    accumulated_color_image_->DownloadData(color);
+    accumulated_samples_image_->DownloadData(samples);
+    accumulated_moment_image_->DownloadData(moment);
+}
+
+void Film::AddAccumulation(const float* color, const int32_t* samples, const float* moment, int sample_count) {
+    if (host_accumulation_) {
+        AddHostAccumulation(color, samples, moment, sample_count);
+        return;
+    }
+    // Round-trip through local staging so the host buffers stay unallocated
+    // and the AOV images keep their contents
+    size_t pixel_count = static_cast<size_t>(width_) * height_;
+    std::vector<float> staging_color(pixel_count * 4);
+    std::vector<int32_t> staging_samples(pixel_count);
+    std::vector<float> staging_moment(pixel_count);
+    CopyAccumulation(staging_color.data(), staging_samples.data(), staging_moment.data());
+    SumAccumulation(staging_color.data(), staging_samples.data(), staging_moment.data(),
+                    color, samples, moment, pixel_count);
+    accumulated_color_image_->UploadData(staging_color.data());
+    accumulated_samples_image_->UploadData(staging_samples.data());
+    accumulated_moment_image_->UploadData(staging_moment.data());
+    sample_count_ += sample_count;
+    InvalidateOutput();
+}
+
 void Film::Resize(int width, int height) {
     if (width == width_ && height == height_) {
         return;
@@ -80,8 +483,14 @@ void Film::Resize(int width, int height) {
     // Recreate images with new dimensions
     accumulated_color_image_.reset();
     accumulated_samples_image_.reset();
+    accumulated_moment_image_.reset();
     output_image_.reset();
+    aov_albedo_image_.reset();
+    aov_normal_image_.reset();
+    aov_depth_image_.reset();
+    aov_instance_id_image_.reset();
 
+    tile_scheduler_.Resize(width, height);
     CreateImages();
     Reset();
     
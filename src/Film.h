@@ -1,8 +1,10 @@
 #pragma once
 #include "long_march.h"
+#include "TileScheduler.h"
 
 // Film class for accumulating ray tracing samples over time
 // Used for progressive rendering when camera is stationary
+// A null core creates a headless film that only keeps host-side buffers
 class Film {
 public:
     Film(grassland::graphics::Core* core, int width, int height);
@@ -16,6 +18,10 @@ public:
     
     // Get the sample count image (for shader)
     grassland::graphics::Image* GetAccumulatedSamplesImage() const { return accumulated_samples_image_.get(); }
+
+    // Get the luminance second moment image (sum of squared sample
+    // luminances, for the adaptive sampling error estimate)
+    grassland::graphics::Image* GetAccumulatedMomentImage() const { return accumulated_moment_image_.get(); }
     
     // Get the final output image (averaged result)
     grassland::graphics::Image* GetOutputImage() const { return output_image_.get(); }
@@ -26,8 +32,85 @@ public:
     // Increment sample count
     void IncrementSampleCount() { sample_count_++; }
 
-    // Convert accumulated data to final output image (divide by sample count)
-    void DevelopToOutput();
+    // Convert accumulated data to final output image (divide by each pixel's
+    // sample count). Device films record a compute dispatch into
+    // command_context, or submit their own when none is given; host films run
+    // a multithreaded SIMD divide. Does nothing if no sample was added since
+    // the last develop.
+    void DevelopToOutput(grassland::graphics::CommandContext* command_context = nullptr);
+
+    // Make the next DevelopToOutput rewrite the output even without new
+    // samples, e.g. after an overlay was drawn into it or a frame rendered
+    // only part of a tile pass
+    void InvalidateOutput() { developed_sample_count_ = -1; }
+
+    // Device films develop with the compute pass unless disabled here (or the
+    // pass failed to compile); the fallback downloads the accumulation,
+    // divides on the host and uploads the result
+    void SetDeviceDevelop(bool enabled) { device_develop_ = enabled; }
+    bool IsDeviceDevelop() const { return device_develop_ && develop_program_ != nullptr; }
+
+    // Host-side accumulation, same layout as the device images
+    // (RGBA32F color sum, R32_SINT sample count, R32F luminance second
+    // moment). Filled by the CPU renderer.
+    float* GetHostAccumulatedColor();
+    int32_t* GetHostAccumulatedSamples();
+    float* GetHostAccumulatedMoment();
+    const std::vector<float>& GetHostOutput() const { return host_output_; }
+
+    // When enabled, the host buffers are the source of truth: Reset clears them
+    // and DevelopToOutput reads them instead of downloading the device image
+    void SetHostAccumulation(bool enabled);
+    bool IsHostAccumulation() const { return host_accumulation_; }
+
+    // Copy the host accumulation into the device images (no-op when headless)
+    void UploadHostAccumulation();
+
+    // Sum another accumulation of the film's size and layout into the host
+    // buffers (moment may be null), e.g. partial renders of disjoint tiles.
+    // sample_count is added to the film's sample count.
+    void AddHostAccumulation(const float* color, const int32_t* samples, const float* moment, int sample_count);
+
+    // Copy the accumulation (host buffers when host-accumulated, device images
+    // otherwise) into arrays of the film's size. The device must be idle.
+    void CopyAccumulation(float* color, int32_t* samples, float* moment);
+    // Sum an accumulation into whichever side is the source of truth, e.g. a
+    // loaded snapshot; device films round-trip color, samples and moment
+    // through temporary host copies and leave the AOVs untouched
+    void AddAccumulation(const float* color, const int32_t* samples, const float* moment, int sample_count);
+
+    // Auxiliary outputs (AOVs) of the primary hit, for denoising and
+    // compositing. Only the layers passed to SetAovs are allocated. Albedo
+    // and the world-space normal (both RGBA32F, A unused) are summed per
+    // sample like the color and share its sample count; misses add zero.
+    // Depth (RGBA32F) sums the distance along the camera ray in R and counts
+    // the samples that hit in G, so misses do not pull it towards zero. The
+    // instance ID (R32_SINT) keeps the entity of the first sample that hit
+    // the pixel, -1 if none did.
+    enum Aov : uint32_t {
+        kAovAlbedo = 1,
+        kAovNormal = 2,
+        kAovDepth = 4,
+        kAovInstanceId = 8,
+    };
+    // Allocate the layers in aovs (a mask of Aov bits) and free the others;
+    // resets the film when the set changes
+    void SetAovs(uint32_t aovs);
+    uint32_t GetAovs() const { return aovs_; }
+    // Device image of a layer, null when it is not allocated or the film is headless
+    grassland::graphics::Image* GetAovImage(Aov aov) const;
+    // Host buffers of a layer (null when it is not allocated), filled by the CPU renderer
+    float* GetHostAovAlbedo();
+    float* GetHostAovNormal();
+    float* GetHostAovDepth();
+    int32_t* GetHostAovInstanceId();
+    // Copy an allocated layer (albedo, normal and depth: 4 floats per pixel,
+    // instance ID: 1 int32) from the source of truth, like
+    // CopyAccumulation. The device must be idle.
+    void CopyAov(Aov aov, void* data);
+    static size_t GetAovPixelSize(Aov aov);
+
+    bool IsHeadless() const { return core_ == nullptr; }
 
     // Resize the film (call when window resizes)
     void Resize(int width, int height);
@@ -35,6 +118,10 @@ public:
     int GetWidth() const { return width_; }
     int GetHeight() const { return height_; }
 
+    // Tiles for progressive rendering; follows the film's size and restarts
+    // its pass on Reset
+    TileScheduler& GetTileScheduler() { return tile_scheduler_; }
+
 private:
     grassland::graphics::Core* core_;
     int width_;
@@ -46,10 +133,40 @@ private:
     
     // Accumulated sample count per pixel
     std::unique_ptr<grassland::graphics::Image> accumulated_samples_image_;
+
+    // Accumulated squared luminance per pixel
+    std::unique_ptr<grassland::graphics::Image> accumulated_moment_image_;
     
     // Final output image (accumulated_color / accumulated_samples)
     std::unique_ptr<grassland::graphics::Image> output_image_;
 
+    // AOV layers, only created for the bits in aovs_
+    uint32_t aovs_;
+    std::unique_ptr<grassland::graphics::Image> aov_albedo_image_;
+    std::unique_ptr<grassland::graphics::Image> aov_normal_image_;
+    std::unique_ptr<grassland::graphics::Image> aov_depth_image_;
+    std::unique_ptr<grassland::graphics::Image> aov_instance_id_image_;
+
+    bool host_accumulation_;
+    bool device_develop_;
+    int developed_sample_count_; // sample_count_ at the last develop
+    std::unique_ptr<grassland::graphics::Shader> develop_shader_;
+    std::unique_ptr<grassland::graphics::ComputeProgram> develop_program_;
+    std::vector<float> host_accumulated_color_;
+    std::vector<int32_t> host_accumulated_samples_;
+    std::vector<float> host_accumulated_moment_;
+    std::vector<float> host_output_;
+    std::vector<float> host_aov_albedo_;
+    std::vector<float> host_aov_normal_;
+    std::vector<float> host_aov_depth_;
+    std::vector<int32_t> host_aov_instance_id_;
+    TileScheduler tile_scheduler_;
+
     void CreateImages();
+    void CreateAovImages();
+    void AllocateHostAovBuffers();
+    void CreateDevelopProgram();
+    void AllocateHostBuffers();
+    void DevelopOnHost(const float* accumulated_color, const int32_t* accumulated_samples, float* output) const;
 };
 
@@ -0,0 +1,253 @@
+#include "FilmSnapshot.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// Rows converted and written per block
+constexpr int kBlockRows = 32;
+
+constexpr uint64_t kChecksumSeed = 14695981039346656037ull;
+
+// FNV-1a, continued across blocks
+uint64_t UpdateChecksum(uint64_t hash, const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+size_t GetPixelSize(uint32_t flags) {
+    size_t color_size = (flags & FilmSnapshotHeader::kHalf) ? 4 * sizeof(uint16_t) : 4 * sizeof(float);
+    size_t moment_size = (flags & FilmSnapshotHeader::kHasMoment)
+                             ? ((flags & FilmSnapshotHeader::kHalf) ? sizeof(uint16_t) : sizeof(float))
+                             : 0;
+    return color_size + sizeof(int32_t) + moment_size;
+}
+
+uint16_t ToHalf(float value) {
+    // Clamp to the largest half instead of overflowing to infinity
+    return glm::packHalf1x16(std::min(value, 65504.0f));
+}
+
+// Encode pixels [begin, end) of snapshot into out
+void EncodePixels(const FilmSnapshot& snapshot, uint32_t flags, size_t begin, size_t end, uint8_t* out) {
+    const bool half = (flags & FilmSnapshotHeader::kHalf) != 0;
+    const bool has_moment = (flags & FilmSnapshotHeader::kHasMoment) != 0;
+    for (size_t i = begin; i < end; i++) {
+        const float* color = &snapshot.color[i * 4];
+        const int32_t samples = snapshot.samples[i];
+        if (half) {
+            float scale = samples > 0 ? 1.0f / samples : 0.0f;
+            uint16_t mean[4];
+            for (int c = 0; c < 4; c++) {
+                mean[c] = ToHalf(color[c] * scale);
+            }
+            std::memcpy(out, mean, sizeof(mean));
+            out += sizeof(mean);
+        } else {
+            std::memcpy(out, color, 4 * sizeof(float));
+            out += 4 * sizeof(float);
+        }
+        std::memcpy(out, &samples, sizeof(samples));
+        out += sizeof(samples);
+        if (has_moment && half) {
+            uint16_t mean = ToHalf(samples > 0 ? snapshot.moment[i] / samples : 0.0f);
+            std::memcpy(out, &mean, sizeof(mean));
+            out += sizeof(mean);
+        } else if (has_moment) {
+            std::memcpy(out, &snapshot.moment[i], sizeof(float));
+            out += sizeof(float);
+        }
+    }
+}
+
+void DecodePixels(const uint8_t* in, uint32_t flags, size_t begin, size_t end, FilmSnapshot* snapshot) {
+    const bool half = (flags & FilmSnapshotHeader::kHalf) != 0;
+    const bool has_moment = (flags & FilmSnapshotHeader::kHasMoment) != 0;
+    for (size_t i = begin; i < end; i++) {
+        float* color = &snapshot->color[i * 4];
+        uint16_t mean[4];
+        if (half) {
+            std::memcpy(mean, in, sizeof(mean));
+            in += sizeof(mean);
+        } else {
+            std::memcpy(color, in, 4 * sizeof(float));
+            in += 4 * sizeof(float);
+        }
+        int32_t samples;
+        std::memcpy(&samples, in, sizeof(samples));
+        in += sizeof(samples);
+        snapshot->samples[i] = samples;
+        if (half) {
+            for (int c = 0; c < 4; c++) {
+                color[c] = glm::unpackHalf1x16(mean[c]) * samples;
+            }
+        }
+        if (has_moment && half) {
+            uint16_t moment;
+            std::memcpy(&moment, in, sizeof(moment));
+            in += sizeof(moment);
+            snapshot->moment[i] = glm::unpackHalf1x16(moment) * samples;
+        } else if (has_moment) {
+            std::memcpy(&snapshot->moment[i], in, sizeof(float));
+            in += sizeof(float);
+        }
+    }
+}
+
+bool WriteSnapshotFile(const std::string& filename, const FilmSnapshot& snapshot, uint32_t flags) {
+    FilmSnapshotHeader header{};
+    std::memcpy(header.magic, FilmSnapshotHeader::kMagic, sizeof(header.magic));
+    header.version = FilmSnapshotHeader::kVersion;
+    header.width = snapshot.width;
+    header.height = snapshot.height;
+    header.flags = flags;
+    header.sample_count = snapshot.sample_count;
+
+    std::error_code error;
+    std::filesystem::path target(filename);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), error);
+    }
+    std::string temp_path = MakeTempPath(filename);
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        grassland::LogError("Failed to create snapshot file: {}", temp_path);
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    const size_t width = static_cast<size_t>(snapshot.width);
+    const size_t pixel_size = GetPixelSize(flags);
+    std::vector<uint8_t> block(width * kBlockRows * pixel_size);
+    uint64_t checksum = kChecksumSeed;
+    for (int y = 0; ok && y < snapshot.height; y += kBlockRows) {
+        size_t begin = y * width;
+        size_t end = std::min(snapshot.height, y + kBlockRows) * width;
+        size_t size = (end - begin) * pixel_size;
+        EncodePixels(snapshot, flags, begin, end, block.data());
+        checksum = UpdateChecksum(checksum, block.data(), size);
+        ok = std::fwrite(block.data(), 1, size, file) == size;
+    }
+    ok = ok && std::fwrite(&checksum, sizeof(checksum), 1, file) == 1;
+    ok = std::fclose(file) == 0 && ok;
+    if (ok) {
+        // Replaces the previous checkpoint atomically, so a crash never loses both
+        std::filesystem::rename(temp_path, target, error);
+        ok = !error;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, error);
+        grassland::LogError("Failed to write snapshot file: {}", filename);
+    }
+    return ok;
+}
+
+} // namespace
+
+bool LoadFilmSnapshot(const std::string& filename, FilmSnapshot* snapshot) {
+    FILE* file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        grassland::LogError("Failed to open snapshot file: {}", filename);
+        return false;
+    }
+    FilmSnapshotHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 &&
+              std::memcmp(header.magic, FilmSnapshotHeader::kMagic, sizeof(header.magic)) == 0 &&
+              header.version == FilmSnapshotHeader::kVersion && header.width > 0 && header.height > 0 &&
+              header.sample_count >= 0;
+    if (!ok) {
+        std::fclose(file);
+        grassland::LogError("Not a snapshot file of this version: {}", filename);
+        return false;
+    }
+
+    const size_t width = static_cast<size_t>(header.width);
+    const size_t pixel_count = width * header.height;
+    const size_t pixel_size = GetPixelSize(header.flags);
+    snapshot->width = header.width;
+    snapshot->height = header.height;
+    snapshot->sample_count = header.sample_count;
+    snapshot->color.assign(pixel_count * 4, 0.0f);
+    snapshot->samples.assign(pixel_count, 0);
+    snapshot->moment.assign((header.flags & FilmSnapshotHeader::kHasMoment) ? pixel_count : 0, 0.0f);
+    std::vector<uint8_t> block(width * kBlockRows * pixel_size);
+    uint64_t checksum = kChecksumSeed;
+    for (int y = 0; ok && y < header.height; y += kBlockRows) {
+        size_t begin = y * width;
+        size_t end = std::min(header.height, y + kBlockRows) * width;
+        size_t size = (end - begin) * pixel_size;
+        ok = std::fread(block.data(), 1, size, file) == size;
+        if (ok) {
+            checksum = UpdateChecksum(checksum, block.data(), size);
+            DecodePixels(block.data(), header.flags, begin, end, snapshot);
+        }
+    }
+    uint64_t stored_checksum = 0;
+    ok = ok && std::fread(&stored_checksum, sizeof(stored_checksum), 1, file) == 1;
+    std::fclose(file);
+    if (!ok) {
+        grassland::LogError("Snapshot file is truncated: {}", filename);
+        return false;
+    }
+    if (stored_checksum != checksum) {
+        grassland::LogError("Snapshot file is corrupt (checksum mismatch): {}", filename);
+        return false;
+    }
+    return true;
+}
+
+bool MergeFilmSnapshot(const std::string& filename, Film* film) {
+    FilmSnapshot snapshot;
+    if (!LoadFilmSnapshot(filename, &snapshot)) {
+        return false;
+    }
+    if (snapshot.width != film->GetWidth() || snapshot.height != film->GetHeight()) {
+        grassland::LogError("Snapshot {} is {}x{}, the film is {}x{}", filename, snapshot.width, snapshot.height,
+                            film->GetWidth(), film->GetHeight());
+        return false;
+    }
+    film->AddAccumulation(snapshot.color.data(), snapshot.samples.data(),
+                          snapshot.moment.empty() ? nullptr : snapshot.moment.data(), snapshot.sample_count);
+    grassland::LogInfo("Merged {} ({} samples per pixel)", filename, snapshot.sample_count);
+    return true;
+}
+
+FilmSnapshotWriter::~FilmSnapshotWriter() {
+    Wait();
+}
+
+bool FilmSnapshotWriter::Write(Film* film, const std::string& filename, bool half_precision, bool include_moment) {
+    if (IsBusy()) {
+        return false;
+    }
+    Wait();
+    const size_t pixel_count = static_cast<size_t>(film->GetWidth()) * film->GetHeight();
+    staging_.width = film->GetWidth();
+    staging_.height = film->GetHeight();
+    staging_.sample_count = film->GetSampleCount();
+    staging_.color.resize(pixel_count * 4);
+    staging_.samples.resize(pixel_count);
+    staging_.moment.resize(pixel_count);
+    film->CopyAccumulation(staging_.color.data(), staging_.samples.data(), staging_.moment.data());
+
+    uint32_t flags = (half_precision ? FilmSnapshotHeader::kHalf : 0) |
+                     (include_moment ? FilmSnapshotHeader::kHasMoment : 0);
+    pending_ = ThreadPool::Global().Submit(
+        [this, filename, flags]() { return WriteSnapshotFile(filename, staging_, flags); });
+    return true;
+}
+
+bool FilmSnapshotWriter::IsBusy() const {
+    return pending_.valid() && pending_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+bool FilmSnapshotWriter::Wait() {
+    return pending_.valid() ? pending_.get() : true;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "Film.h"
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+// On-disk copy of a film's accumulation, for checkpointing long renders and
+// merging renders of the same view. Layout (little endian):
+//   header      FilmSnapshotHeader
+//   rows        per pixel: color, sample count (int32), moment if kHasMoment
+//   checksum    uint64, over everything between header and checksum
+// Float snapshots store the color sum (RGBA32F) and moment sum (R32F) as the
+// film does. Half snapshots store them divided by the pixel's sample count as
+// 16-bit floats, so a long render's sums cannot overflow the format; loading
+// multiplies back. Sample counts are always exact.
+struct FilmSnapshotHeader {
+    static constexpr char kMagic[4] = { 'S', 'M', 'A', 'C' };
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kHalf = 1;
+    static constexpr uint32_t kHasMoment = 2;
+
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    uint32_t flags;
+    int32_t sample_count; // the film's sample passes
+};
+
+struct FilmSnapshot {
+    int width = 0;
+    int height = 0;
+    int sample_count = 0;
+    std::vector<float> color;     // RGBA sums
+    std::vector<int32_t> samples;
+    std::vector<float> moment;    // Empty when the file had none
+};
+
+// Read and verify a snapshot file; logs and returns false on a bad file
+bool LoadFilmSnapshot(const std::string& filename, FilmSnapshot* snapshot);
+
+// Sum a snapshot file into film, which must have the snapshot's size.
+// Snapshots of the same view add up like one longer render, as long as
+// they were rendered with different sample indices (see --sample-offset).
+bool MergeFilmSnapshot(const std::string& filename, Film* film);
+
+// Writes snapshots on a thread pool task. Write only copies the film's
+// accumulation on the calling thread; conversion, checksumming and the file
+// writes happen in the background, streamed in blocks of rows into a
+// temporary file that replaces filename once complete, so an interrupted
+// write leaves the previous checkpoint intact.
+class FilmSnapshotWriter {
+public:
+    ~FilmSnapshotWriter();
+
+    // Start writing film's accumulation (device films need an idle device).
+    // Returns false without copying while the previous write is running.
+    bool Write(Film* film, const std::string& filename, bool half_precision, bool include_moment = true);
+    bool IsBusy() const;
+    // Block until the current write finishes; returns whether it succeeded
+    // (true if no write was pending)
+    bool Wait();
+
+private:
+    FilmSnapshot staging_;
+    std::future<bool> pending_;
+};
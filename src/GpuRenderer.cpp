@@ -0,0 +1,457 @@
+#include "GpuRenderer.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+#include "built_in_shaders.inl"
+}
+
+GpuRenderer::GpuRenderer(grassland::graphics::Core* core, const Scene* scene, const TextureAtlas* textures)
+    : core_(core), scene_(scene) {
+    size_t buffer_size = textures->GetData().size() * sizeof(float);
+    if (buffer_size > 0) {
+        core_->CreateBuffer(buffer_size, grassland::graphics::BUFFER_TYPE_DYNAMIC, &texture_data_buffer_);
+        texture_data_buffer_->UploadData(textures->GetData().data(), buffer_size);
+    }
+    size_t info_buffer_size = textures->GetInfos().size() * sizeof(TextureInfo);
+    if (info_buffer_size > 0) {
+        core_->CreateBuffer(info_buffer_size, grassland::graphics::BUFFER_TYPE_DYNAMIC, &texture_info_buffer_);
+        texture_info_buffer_->UploadData(textures->GetInfos().data(), info_buffer_size);
+    }
+
+    core_->CreateBuffer(sizeof(CameraObject), grassland::graphics::BUFFER_TYPE_DYNAMIC, &camera_object_buffer_);
+    core_->CreateBuffer(sizeof(HoverInfo), grassland::graphics::BUFFER_TYPE_DYNAMIC, &hover_info_buffer_);
+    core_->CreateBuffer(sizeof(PickResult) * kReadbackSlots, grassland::graphics::BUFFER_TYPE_STATIC, &pick_buffer_);
+    core_->CreateBuffer(sizeof(RenderSettings), grassland::graphics::BUFFER_TYPE_DYNAMIC, &render_settings_buffer_);
+    core_->CreateBuffer(sizeof(uint32_t) * RayStats::kSlotSize * kReadbackSlots, grassland::graphics::BUFFER_TYPE_STATIC,
+                        &ray_stats_buffer_);
+    SetEnvironment(EnvironmentMap()); // Placeholder tables until the caller provides the sky
+    const std::vector<float>& blue_noise = PathSampler::GetBlueNoiseMask();
+    core_->CreateBuffer(blue_noise.size() * sizeof(float), grassland::graphics::BUFFER_TYPE_STATIC, &blue_noise_buffer_);
+    blue_noise_buffer_->UploadData(blue_noise.data(), blue_noise.size() * sizeof(float));
+    SetTiles({}, 0);
+    core_->CreateImage(1, 1, grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT, &aov_placeholder_color_);
+    core_->CreateImage(1, 1, grassland::graphics::IMAGE_FORMAT_R32_SINT, &aov_placeholder_int_);
+
+    CreatePipeline();
+    CreateHighlightProgram();
+    CreateStatsClearProgram();
+}
+
+void GpuRenderer::CreatePipeline() {
+    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "RayGenMain", "lib_6_3", &raygen_shader_);
+    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "MissMain", "lib_6_3", &miss_shader_);
+    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "ClosestHitMain", "lib_6_3", &closest_hit_shader_);
+    grassland::LogInfo("Shader compiled successfully");
+
+    core_->CreateRayTracingProgram(raygen_shader_.get(), miss_shader_.get(), closest_hit_shader_.get(), &program_);
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_ACCELERATION_STRUCTURE, 1);  // space0
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space1 - color output
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space2
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space3 - materials
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space4 - hover info
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space5 - entity ID output
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space6 - accumulated color
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space7 - accumulated samples
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space8 - vertices
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space9 - indices
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space10 - entity offsets
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space11 - texture data
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space12 - point lights
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space13 - area lights
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space14 - texture info
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_STORAGE_BUFFER, 1); // space15 - pick results
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space16 - render settings
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_STORAGE_BUFFER, 1); // space17 - ray statistics
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space18 - light BVH
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space19 - light power alias table
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space20 - environment alias tables
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space21 - blue-noise mask
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space22 - accumulated moment
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space23 - tile list
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space24 - albedo AOV
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space25 - normal AOV
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space26 - depth AOV
+    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space27 - instance ID AOV
+    program_->Finalize();
+}
+
+void GpuRenderer::CreateHighlightProgram() {
+    if (core_->CreateShader(GetShaderCode("shaders/highlight.hlsl"), "HighlightMain", "cs_6_0", &highlight_shader_) != 0 ||
+        core_->CreateComputeProgram(highlight_shader_.get(), &highlight_program_) != 0) {
+        grassland::LogWarning("Highlight compute pass unavailable, highlighting on the host");
+        highlight_program_.reset();
+        return;
+    }
+    highlight_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);  // space0 - highlight info
+    highlight_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);  // space1 - entity IDs
+    highlight_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);  // space2 - image
+    highlight_program_->Finalize();
+    core_->CreateBuffer(sizeof(HighlightInfo), grassland::graphics::BUFFER_TYPE_DYNAMIC, &highlight_info_buffer_);
+}
+
+void GpuRenderer::CreateStatsClearProgram() {
+    if (core_->CreateShader(GetShaderCode("shaders/clear_stats.hlsl"), "ClearStatsMain", "cs_6_0",
+                            &stats_clear_shader_) != 0 ||
+        core_->CreateComputeProgram(stats_clear_shader_.get(), &stats_clear_program_) != 0) {
+        grassland::LogWarning("Statistics clear pass unavailable, clearing slots from the host");
+        stats_clear_program_.reset();
+        return;
+    }
+    stats_clear_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space0 - render settings
+    stats_clear_program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_STORAGE_BUFFER, 1); // space1 - ray statistics
+    stats_clear_program_->Finalize();
+}
+
+void GpuRenderer::SetLights(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights) {
+    // Empty light lists still get a one-element buffer so every space stays bound
+    size_t point_lights_buffer_size = std::max<size_t>(point_lights.size(), 1) * sizeof(PointLight);
+    size_t area_lights_buffer_size = std::max<size_t>(area_lights.size(), 1) * sizeof(AreaLight);
+    core_->CreateBuffer(point_lights_buffer_size, grassland::graphics::BUFFER_TYPE_DYNAMIC, &point_lights_buffer_);
+    core_->CreateBuffer(area_lights_buffer_size, grassland::graphics::BUFFER_TYPE_DYNAMIC, &area_lights_buffer_);
+    if (!point_lights.empty()) {
+        point_lights_buffer_->UploadData(point_lights.data(), point_lights.size() * sizeof(PointLight));
+    }
+    if (!area_lights.empty()) {
+        area_lights_buffer_->UploadData(area_lights.data(), area_lights.size() * sizeof(AreaLight));
+    }
+
+    // The shader only reads light_nodes[0].power when there are no lights
+    LightBvh light_bvh;
+    light_bvh.Build(point_lights, area_lights);
+    std::vector<LightBvh::Node> nodes = light_bvh.GetNodes();
+    if (nodes.empty()) {
+        nodes.push_back({ glm::vec3(0.0f), 0.0f, glm::vec3(0.0f), LightBvh::kLeafFlag });
+    }
+    core_->CreateBuffer(nodes.size() * sizeof(LightBvh::Node), grassland::graphics::BUFFER_TYPE_STATIC,
+                        &light_nodes_buffer_);
+    light_nodes_buffer_->UploadData(nodes.data(), nodes.size() * sizeof(LightBvh::Node));
+    grassland::LogInfo("Light BVH: {} lights, {} nodes", point_lights.size() + area_lights.size(), nodes.size());
+
+    AliasTable power_table;
+    power_table.Build(LightBvh::GetPowers(point_lights, area_lights));
+    std::vector<AliasTable::Entry> entries = power_table.GetEntries();
+    if (entries.empty()) {
+        entries.push_back({ 1.0f, 0, 0.0f, 0 });
+    }
+    core_->CreateBuffer(entries.size() * sizeof(AliasTable::Entry), grassland::graphics::BUFFER_TYPE_STATIC,
+                        &light_alias_buffer_);
+    light_alias_buffer_->UploadData(entries.data(), entries.size() * sizeof(AliasTable::Entry));
+
+    // Lights without power cannot be sampled; the shader skips direct lighting then
+    bool has_power = !power_table.IsEmpty();
+    render_settings_.point_light_count = has_power ? static_cast<uint32_t>(point_lights.size()) : 0;
+    render_settings_.area_light_count = has_power ? static_cast<uint32_t>(area_lights.size()) : 0;
+    render_settings_dirty_ = true;
+}
+
+void GpuRenderer::SetEnvironment(const EnvironmentMap& environment) {
+    std::vector<AliasTable::Entry> entries = environment.GetEntries();
+    if (entries.empty()) {
+        entries.push_back({ 1.0f, 0, 0.0f, 0 });
+    }
+    core_->CreateBuffer(entries.size() * sizeof(AliasTable::Entry), grassland::graphics::BUFFER_TYPE_STATIC,
+                        &environment_alias_buffer_);
+    environment_alias_buffer_->UploadData(entries.data(), entries.size() * sizeof(AliasTable::Entry));
+    render_settings_.environment_width = environment.GetWidth();
+    render_settings_.environment_height = environment.GetHeight();
+    render_settings_dirty_ = true;
+}
+
+void GpuRenderer::SetEnvironmentLight(bool enabled) {
+    uint32_t value = enabled ? 1 : 0;
+    if (render_settings_.environment_light != value) {
+        render_settings_.environment_light = value;
+        render_settings_dirty_ = true;
+    }
+}
+
+void GpuRenderer::SetSamplerType(SamplerType type) {
+    uint32_t value = static_cast<uint32_t>(type);
+    if (render_settings_.sampler_type != value) {
+        render_settings_.sampler_type = value;
+        render_settings_dirty_ = true;
+    }
+}
+
+void GpuRenderer::SetSampleOffset(uint32_t offset) {
+    if (render_settings_.sample_offset != offset) {
+        render_settings_.sample_offset = offset;
+        render_settings_dirty_ = true;
+    }
+}
+
+void GpuRenderer::SetTiles(const std::vector<uint32_t>& tiles, int tiles_x) {
+    // Keep a one-element buffer bound while every pixel is sampled
+    size_t count = std::max<size_t>(tiles.size(), 1);
+    if (count > tiles_capacity_) {
+        core_->CreateBuffer(count * sizeof(uint32_t), grassland::graphics::BUFFER_TYPE_DYNAMIC, &tiles_buffer_);
+        tiles_capacity_ = count;
+    }
+    if (!tiles.empty()) {
+        tiles_buffer_->UploadData(tiles.data(), tiles.size() * sizeof(uint32_t));
+    }
+    uint32_t tile_count = static_cast<uint32_t>(tiles.size());
+    uint32_t grid_width = tiles.empty() ? 0 : static_cast<uint32_t>(tiles_x);
+    if (render_settings_.tile_count != tile_count || render_settings_.tiles_x != grid_width) {
+        render_settings_.tile_count = tile_count;
+        render_settings_.tiles_x = grid_width;
+        render_settings_dirty_ = true;
+    }
+    tiles_ = tiles;
+}
+
+bool GpuRenderer::IsPixelInTiles(int x, int y) const {
+    if (tiles_.empty()) {
+        return true;
+    }
+    uint32_t tile = static_cast<uint32_t>(y / TileScheduler::kTileSize) * render_settings_.tiles_x +
+                    static_cast<uint32_t>(x / TileScheduler::kTileSize);
+    return std::find(tiles_.begin(), tiles_.end(), tile) != tiles_.end();
+}
+
+void GpuRenderer::SetLightSelection(LightSelection selection) {
+    uint32_t value = static_cast<uint32_t>(selection);
+    if (render_settings_.light_selection != value) {
+        render_settings_.light_selection = value;
+        render_settings_dirty_ = true;
+    }
+}
+
+void GpuRenderer::Resize(int width, int height) {
+    if (width == width_ && height == height_ && color_image_) {
+        return;
+    }
+    width_ = width;
+    height_ = height;
+    core_->CreateImage(width, height, grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT, &color_image_);
+    // Entity ID buffer for accurate picking (R32_SINT to store entity indices)
+    core_->CreateImage(width, height, grassland::graphics::IMAGE_FORMAT_R32_SINT, &entity_id_image_);
+    SetPickPixel(-1, -1);
+}
+
+void GpuRenderer::SetCamera(const CameraObject& camera) {
+    camera_object_buffer_->UploadData(&camera, sizeof(CameraObject));
+}
+
+void GpuRenderer::SetHoveredEntity(int entity_id) {
+    if (hover_info_.hovered_entity_id != entity_id) {
+        hover_info_.hovered_entity_id = entity_id;
+        hover_info_dirty_ = true;
+    }
+}
+
+void GpuRenderer::SetPickPixel(int x, int y) {
+    if (x < 0 || y < 0 || x >= width_ || y >= height_) {
+        x = -1;
+        y = -1;
+    }
+    if (hover_info_.pick_pixel[0] != x || hover_info_.pick_pixel[1] != y) {
+        hover_info_.pick_pixel[0] = x;
+        hover_info_.pick_pixel[1] = y;
+        hover_info_dirty_ = true;
+    }
+    if (x < 0) {
+        // Results of an earlier hover are stale once recording stops
+        std::fill(std::begin(pick_slot_written_), std::end(pick_slot_written_), false);
+    }
+}
+
+bool GpuRenderer::ReadPickResult(PickResult* result) const {
+    // The next slot to be written is also the oldest one. DownloadData copies
+    // behind the queued work and waits for it, so this blocks the host.
+    uint32_t slot = static_cast<uint32_t>(pick_frame_ % kReadbackSlots);
+    if (!pick_slot_written_[slot]) {
+        return false;
+    }
+    pick_buffer_->DownloadData(result, sizeof(PickResult), slot * sizeof(PickResult));
+    return true;
+}
+
+void GpuRenderer::SetEntityIdOutput(bool enabled) {
+    uint32_t value = enabled ? 1 : 0;
+    if (render_settings_.write_entity_ids != value) {
+        render_settings_.write_entity_ids = value;
+        render_settings_dirty_ = true;
+    }
+}
+
+void GpuRenderer::SetStatsCollection(bool enabled) {
+    if (enabled == IsCollectingStats()) {
+        return;
+    }
+    if (enabled) {
+        std::fill(std::begin(stats_slot_pending_), std::end(stats_slot_pending_), false);
+        last_sample_stats_.Clear();
+        total_stats_.Clear();
+    }
+    render_settings_.collect_stats = enabled ? 1 : 0;
+    render_settings_dirty_ = true;
+}
+
+void GpuRenderer::ReadRayStats(uint32_t slot) {
+    if (!stats_slot_pending_[slot]) {
+        return;
+    }
+    uint32_t counters[RayStats::kSlotSize];
+    ray_stats_buffer_->DownloadData(counters, sizeof(counters), slot * sizeof(counters));
+    stats_slot_pending_[slot] = false;
+    last_sample_stats_.Clear();
+    last_sample_stats_.AddSlot(counters);
+    total_stats_.Add(last_sample_stats_);
+}
+
+void GpuRenderer::FlushRayStats() {
+    // Oldest first, so the last read is the latest sample
+    for (uint32_t i = 0; i < kReadbackSlots; i++) {
+        ReadRayStats(static_cast<uint32_t>((sample_index_ + i) % kReadbackSlots));
+    }
+}
+
+void GpuRenderer::RenderSample(grassland::graphics::CommandContext* command_context, Film* film) {
+    command_context->CmdClearImage(color_image_.get(), { {0.6, 0.7, 0.8, 1.0} });
+
+    // A tile subset leaves the other pixels' IDs from earlier samples in place
+    if (render_settings_.write_entity_ids && tiles_.empty()) {
+        // Clear entity ID buffer with -1 (no entity)
+        command_context->CmdClearImage(entity_id_image_.get(), { {-1, 0, 0, 0} });
+    }
+
+    if (render_settings_.aovs != film->GetAovs()) {
+        render_settings_.aovs = film->GetAovs();
+        render_settings_dirty_ = true;
+    }
+
+    // This sample reuses the oldest statistics slot: collect it, then zero it
+    uint32_t stats_slot = static_cast<uint32_t>(sample_index_ % kReadbackSlots);
+    ReadRayStats(stats_slot);
+    if (render_settings_.collect_stats) {
+        if (!stats_clear_program_) {
+            uint32_t zeros[RayStats::kSlotSize] = {};
+            ray_stats_buffer_->UploadData(zeros, sizeof(zeros), stats_slot * sizeof(zeros));
+        }
+        stats_slot_pending_[stats_slot] = true;
+        render_settings_.stats_slot = stats_slot;
+        render_settings_dirty_ = true;
+    }
+    if (render_settings_dirty_) {
+        render_settings_buffer_->UploadData(&render_settings_, sizeof(RenderSettings));
+        render_settings_dirty_ = false;
+    }
+    // The clear is recorded ahead of the rays, so it stays in queue order
+    if (render_settings_.collect_stats && stats_clear_program_) {
+        command_context->CmdBindComputeProgram(stats_clear_program_.get());
+        command_context->CmdBindResources(0, { render_settings_buffer_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdBindResources(1, { ray_stats_buffer_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdDispatch(1, 1, 1);
+    }
+    sample_index_++;
+
+    // Only a sample that traces the pick pixel advances the ring; otherwise
+    // the hover info stays as uploaded
+    bool picking =
+        hover_info_.pick_pixel[0] >= 0 && IsPixelInTiles(hover_info_.pick_pixel[0], hover_info_.pick_pixel[1]);
+    if (picking) {
+        hover_info_.pick_slot = static_cast<uint32_t>(pick_frame_ % kReadbackSlots);
+        hover_info_dirty_ = true;
+    }
+    if (hover_info_dirty_) {
+        hover_info_buffer_->UploadData(&hover_info_, sizeof(HoverInfo));
+        hover_info_dirty_ = false;
+    }
+    if (picking) {
+        pick_slot_written_[hover_info_.pick_slot] = true;
+        pick_frame_++;
+    }
+
+    command_context->CmdBindRayTracingProgram(program_.get());
+    command_context->CmdBindResources(0, scene_->GetTLAS(), grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(1, { color_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(2, { camera_object_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(3, { scene_->GetMaterialsBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(4, { hover_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(5, { entity_id_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(6, { film->GetAccumulatedColorImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(7, { film->GetAccumulatedSamplesImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(8, { scene_->GetVertexDataBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(9, { scene_->GetIndexDataBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(10, { scene_->GetEntityOffsetBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    if (texture_data_buffer_) {
+        command_context->CmdBindResources(11, { texture_data_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    }
+    command_context->CmdBindResources(12, { point_lights_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(13, { area_lights_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    if (texture_info_buffer_) {
+        command_context->CmdBindResources(14, { texture_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    }
+    command_context->CmdBindResources(15, { pick_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(16, { render_settings_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(17, { ray_stats_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(18, { light_nodes_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(19, { light_alias_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(20, { environment_alias_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(21, { blue_noise_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(22, { film->GetAccumulatedMomentImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(23, { tiles_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
+    // Every space stays bound; the shader only writes the layers in render_settings_.aovs
+    auto aov_image = [film](Film::Aov aov, grassland::graphics::Image* placeholder) {
+        grassland::graphics::Image* image = film->GetAovImage(aov);
+        return image ? image : placeholder;
+    };
+    command_context->CmdBindResources(24, { aov_image(Film::kAovAlbedo, aov_placeholder_color_.get()) },
+                                      grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(25, { aov_image(Film::kAovNormal, aov_placeholder_color_.get()) },
+                                      grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(26, { aov_image(Film::kAovDepth, aov_placeholder_color_.get()) },
+                                      grassland::graphics::BIND_POINT_RAYTRACING);
+    command_context->CmdBindResources(27, { aov_image(Film::kAovInstanceId, aov_placeholder_int_.get()) },
+                                      grassland::graphics::BIND_POINT_RAYTRACING);
+    if (tiles_.empty()) {
+        command_context->CmdDispatchRays(width_, height_, 1);
+    } else {
+        // The listed tiles packed into rows of the tile grid's width
+        uint32_t tiles_x = render_settings_.tiles_x;
+        uint32_t rows = (static_cast<uint32_t>(tiles_.size()) + tiles_x - 1) / tiles_x;
+        uint32_t columns = std::min<uint32_t>(static_cast<uint32_t>(tiles_.size()), tiles_x);
+        command_context->CmdDispatchRays(columns * TileScheduler::kTileSize, rows * TileScheduler::kTileSize, 1);
+    }
+}
+
+void GpuRenderer::HighlightEntity(grassland::graphics::CommandContext* command_context,
+                                  grassland::graphics::Image* image, int entity_id, const Scene::ScreenRect& rect) {
+    const float kHighlightFactor = 0.4f; // Blend factor for white highlight
+    int rect_width = rect.x1 - rect.x0;
+    int rect_height = rect.y1 - rect.y0;
+    if (rect_width <= 0 || rect_height <= 0) {
+        return;
+    }
+
+    if (highlight_program_) {
+        HighlightInfo info{ { rect.x0, rect.y0 }, { rect.x1, rect.y1 }, entity_id, kHighlightFactor };
+        highlight_info_buffer_->UploadData(&info, sizeof(HighlightInfo));
+        command_context->CmdBindComputeProgram(highlight_program_.get());
+        command_context->CmdBindResources(0, { highlight_info_buffer_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdBindResources(1, { entity_id_image_.get() }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdBindResources(2, { image }, grassland::graphics::BIND_POINT_COMPUTE);
+        command_context->CmdDispatch((rect_width + 7) / 8, (rect_height + 7) / 8, 1);
+        return;
+    }
+
+    // Fallback: only the rectangle goes through host memory
+    grassland::graphics::Offset2D offset{ rect.x0, rect.y0 };
+    grassland::graphics::Extent2D extent{ static_cast<uint32_t>(rect_width), static_cast<uint32_t>(rect_height) };
+    size_t pixel_count = static_cast<size_t>(rect_width) * rect_height;
+    std::vector<float> image_data(pixel_count * 4);
+    std::vector<int32_t> entity_ids(pixel_count);
+    image->DownloadData(image_data.data(), offset, extent);
+    entity_id_image_->DownloadData(entity_ids.data(), offset, extent);
+    for (size_t i = 0; i < pixel_count; i++) {
+        if (entity_ids[i] == entity_id) {
+            // Lerp towards white, alpha unchanged
+            for (int c = 0; c < 3; c++) {
+                image_data[i * 4 + c] = image_data[i * 4 + c] * (1.0f - kHighlightFactor) + kHighlightFactor;
+            }
+        }
+    }
+    image->UploadData(image_data.data(), offset, extent);
+}
@@ -0,0 +1,194 @@
+#pragma once
+#include "long_march.h"
+#include "Scene.h"
+#include "Film.h"
+#include "Light.h"
+#include "LightBvh.h"
+#include "AliasTable.h"
+#include "EnvironmentMap.h"
+#include "PathSampler.h"
+#include "Camera.h"
+#include "Texture.h"
+#include "RayStats.h"
+#include <vector>
+
+// Hardware ray tracing path: the pipeline built from shaders/shader.hlsl and
+// the device-side camera, light and texture buffers it binds. Counterpart of
+// CpuRenderer; needs no window, so the interactive app and the batch renderer
+// share it.
+class GpuRenderer {
+public:
+    // Textures must already be loaded into the atlas
+    GpuRenderer(grassland::graphics::Core* core, const Scene* scene, const TextureAtlas* textures);
+
+    // Upload the lights with their BVH and power alias table; the shader
+    // takes the light counts from the render settings
+    void SetLights(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights);
+    void SetLightSelection(LightSelection selection);
+    // Upload the sky sampling tables. With environment light enabled, diffuse
+    // surfaces take one importance-sampled sky direction instead of the
+    // constant ambient term; an empty map keeps the ambient term.
+    void SetEnvironment(const EnvironmentMap& environment);
+    void SetEnvironmentLight(bool enabled);
+    void SetSamplerType(SamplerType type);
+    // Added to every pixel's sample index, see CpuRenderer::SetSampleOffset
+    void SetSampleOffset(uint32_t offset);
+    // Sample only the listed tiles (TileScheduler indices, row-major grid
+    // tiles_x wide) from the next RenderSample on; an empty list samples every pixel
+    void SetTiles(const std::vector<uint32_t>& tiles, int tiles_x);
+
+    // (Re)create the per-pixel color and entity ID outputs
+    void Resize(int width, int height);
+
+    // Matches PickResult in shader.hlsl
+    struct PickResult {
+        int32_t entity_id; // primary hit entity, -1 on miss
+        int32_t sample_count; // accumulated samples at the pixel, this one included
+        int32_t padding[2];
+        glm::vec4 accumulated_color;
+    };
+
+    // Picks and ray statistics go through rings of slots: the host reads the
+    // one written kReadbackSlots - 1 samples ago rather than the one the frame
+    // it just recorded writes. LongMarch has no fenced or persistently mapped
+    // readback, so each read is a synchronous DownloadData that waits for the
+    // queued work; the ring keeps results consistent, it does not hide the stall.
+    static constexpr uint32_t kReadbackSlots = 3;
+
+    void SetCamera(const CameraObject& camera);
+    void SetHoveredEntity(int entity_id);
+
+    // Record the primary hit and accumulation at pixel (x, y) during the next
+    // RenderSample calls; (-1, -1) stops recording
+    void SetPickPixel(int x, int y);
+
+    // Oldest result in the ring. False while it has not been written yet or
+    // that sample had no pick pixel. Blocks until the device is idle.
+    bool ReadPickResult(PickResult* result) const;
+
+    // Write the per-pixel entity ID image. Only the hover highlight reads it,
+    // so it is off by default; picking uses the pick ring.
+    void SetEntityIdOutput(bool enabled);
+
+    // Count rays per kind, Russian roulette terminations and shaded hits per
+    // depth (see RayStats). Slots are read back kReadbackSlots samples late and
+    // zeroed by a compute dispatch recorded ahead of the sample that reuses
+    // them; FlushRayStats collects the rest once the GPU is idle.
+    void SetStatsCollection(bool enabled);
+    bool IsCollectingStats() const { return render_settings_.collect_stats != 0; }
+    void FlushRayStats();
+    // Latest sample read back (empty before the first one); with one sample
+    // per frame this is the per-frame delta
+    const RayStats& GetLastSampleStats() const { return last_sample_stats_; }
+    // Totals over the samples read back since collection was enabled
+    const RayStats& GetTotalStats() const { return total_stats_; }
+
+    // Blend the pixels of entity_id in image towards white, visiting only
+    // rect. Recorded as a compute dispatch when the pass is available;
+    // otherwise the rectangle is read, blended and written back right away,
+    // so image must already hold the frame.
+    void HighlightEntity(grassland::graphics::CommandContext* command_context, grassland::graphics::Image* image,
+                         int entity_id, const Scene::ScreenRect& rect);
+    bool HasHighlightPass() const { return highlight_program_ != nullptr; }
+
+    // Record one sample per pixel of the current tiles (see SetTiles). The
+    // shader adds it to the film's device accumulation and AOV layers; the
+    // caller increments the film's sample count.
+    void RenderSample(grassland::graphics::CommandContext* command_context, Film* film);
+
+    // Latest single sample (unaccumulated) and primary hit entity per pixel (-1 on miss)
+    grassland::graphics::Image* GetColorImage() const { return color_image_.get(); }
+    grassland::graphics::Image* GetEntityIdImage() const { return entity_id_image_.get(); }
+
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+
+private:
+    struct HoverInfo {
+        int hovered_entity_id;
+        int pick_pixel[2];
+        uint32_t pick_slot;
+    };
+
+    // Matches HighlightInfo in shaders/highlight.hlsl
+    struct HighlightInfo {
+        int rect_min[2];
+        int rect_max[2];
+        int entity_id;
+        float factor;
+    };
+
+    // Matches RenderSettings in shader.hlsl
+    struct RenderSettings {
+        uint32_t write_entity_ids;
+        uint32_t collect_stats;
+        uint32_t stats_slot;
+        uint32_t point_light_count;
+        uint32_t area_light_count;
+        uint32_t light_selection;
+        uint32_t environment_light;
+        uint32_t environment_width; // 0 when there are no sampling tables
+        uint32_t environment_height;
+        uint32_t sampler_type;
+        uint32_t tiles_x;    // width of the tile grid
+        uint32_t tile_count; // tiles in the tile list, 0 when every pixel is sampled
+        uint32_t sample_offset;
+        uint32_t aovs; // Film::Aov bits of the layers to write
+    };
+
+    void CreatePipeline();
+    void CreateHighlightProgram();
+    void CreateStatsClearProgram();
+    void ReadRayStats(uint32_t slot);
+    bool IsPixelInTiles(int x, int y) const;
+
+    grassland::graphics::Core* core_;
+    const Scene* scene_;
+    int width_ = 0;
+    int height_ = 0;
+
+    std::unique_ptr<grassland::graphics::Shader> raygen_shader_;
+    std::unique_ptr<grassland::graphics::Shader> miss_shader_;
+    std::unique_ptr<grassland::graphics::Shader> closest_hit_shader_;
+    std::unique_ptr<grassland::graphics::RayTracingProgram> program_;
+    std::unique_ptr<grassland::graphics::Shader> highlight_shader_;
+    std::unique_ptr<grassland::graphics::ComputeProgram> highlight_program_;
+    std::unique_ptr<grassland::graphics::Shader> stats_clear_shader_;
+    std::unique_ptr<grassland::graphics::ComputeProgram> stats_clear_program_;
+
+    std::unique_ptr<grassland::graphics::Buffer> camera_object_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> hover_info_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> pick_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> highlight_info_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> render_settings_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> ray_stats_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> texture_data_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> texture_info_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> point_lights_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> area_lights_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> light_nodes_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> light_alias_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> environment_alias_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> blue_noise_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> tiles_buffer_;
+    size_t tiles_capacity_ = 0;
+    std::vector<uint32_t> tiles_; // host copy of the tile list, for picking
+
+    std::unique_ptr<grassland::graphics::Image> color_image_;
+    std::unique_ptr<grassland::graphics::Image> entity_id_image_;
+    // 1x1 stand-ins bound for the AOV layers a film did not allocate
+    std::unique_ptr<grassland::graphics::Image> aov_placeholder_color_;
+    std::unique_ptr<grassland::graphics::Image> aov_placeholder_int_;
+
+    HoverInfo hover_info_{ -1, { -1, -1 }, 0 };
+    bool hover_info_dirty_ = true;
+    uint64_t pick_frame_ = 0; // samples that recorded a pick
+    bool pick_slot_written_[kReadbackSlots] = {};
+
+    RenderSettings render_settings_{ 0, 0, 0, 0, 0, 0, 0, 0, 0, static_cast<uint32_t>(SamplerType::kSobol), 0, 0, 0, 0 };
+    bool render_settings_dirty_ = true;
+    uint64_t sample_index_ = 0;
+    bool stats_slot_pending_[kReadbackSlots] = {};
+    RayStats last_sample_stats_;
+    RayStats total_stats_;
+};
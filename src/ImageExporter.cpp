@@ -0,0 +1,97 @@
+#include "ImageExporter.h"
+#include "ThreadPool.h"
+#include "long_march.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+RenderImageData ImageExporter::Image::GetRenderData() const {
+    RenderImageData data;
+    data.width = width;
+    data.height = height;
+    data.accumulated_rgba = accumulated_rgba.data();
+    data.entity_ids = entity_ids.empty() ? nullptr : entity_ids.data();
+    data.albedo = albedo.empty() ? nullptr : albedo.data();
+    data.normal = normal.empty() ? nullptr : normal.data();
+    data.depth = depth.empty() ? nullptr : depth.data();
+    return data;
+}
+
+ImageExporter::Image ImageExporter::CaptureFilm(Film* film) {
+    Image image;
+    image.width = film->GetWidth();
+    image.height = film->GetHeight();
+    image.sample_count = film->GetSampleCount();
+    const size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+    image.accumulated_rgba.resize(pixel_count * 4);
+    if (film->IsHostAccumulation()) {
+        const float* host_colors = film->GetHostAccumulatedColor();
+        std::copy(host_colors, host_colors + image.accumulated_rgba.size(), image.accumulated_rgba.begin());
+    } else {
+        film->GetAccumulatedColorImage()->DownloadData(image.accumulated_rgba.data());
+    }
+    const uint32_t aovs = film->GetAovs();
+    if (aovs & Film::kAovInstanceId) {
+        image.entity_ids.resize(pixel_count);
+        film->CopyAov(Film::kAovInstanceId, image.entity_ids.data());
+    }
+    if (aovs & Film::kAovAlbedo) {
+        image.albedo.resize(pixel_count * 4);
+        film->CopyAov(Film::kAovAlbedo, image.albedo.data());
+    }
+    if (aovs & Film::kAovNormal) {
+        image.normal.resize(pixel_count * 4);
+        film->CopyAov(Film::kAovNormal, image.normal.data());
+    }
+    if (aovs & Film::kAovDepth) {
+        image.depth.resize(pixel_count * 4);
+        film->CopyAov(Film::kAovDepth, image.depth.data());
+    }
+    return image;
+}
+
+ImageExporter::~ImageExporter() {
+    WaitAll();
+}
+
+bool ImageExporter::Export(const std::string& filename, Image image, const HdrWriteOptions& options) {
+    Poll();
+    if (exports_.size() >= kMaxInFlight) {
+        grassland::LogWarning("Skipping export of {}: {} exports still running", filename, exports_.size());
+        return false;
+    }
+    PendingExport pending{ filename, image.width, image.height, image.sample_count };
+    pending.result = ThreadPool::Global().Submit([filename, options, image = std::move(image)]() {
+        return WriteRenderImage(filename, image.GetRenderData(), options);
+    });
+    exports_.push_back(std::move(pending));
+    return true;
+}
+
+void ImageExporter::Poll() {
+    for (size_t i = 0; i < exports_.size();) {
+        if (exports_[i].result.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            Finish(exports_[i]);
+            exports_.erase(exports_.begin() + i);
+        } else {
+            i++;
+        }
+    }
+}
+
+void ImageExporter::WaitAll() {
+    for (auto& pending : exports_) {
+        Finish(pending);
+    }
+    exports_.clear();
+}
+
+void ImageExporter::Finish(PendingExport& pending) {
+    if (pending.result.get()) {
+        std::filesystem::path abs_path = std::filesystem::absolute(pending.filename);
+        grassland::LogInfo("Screenshot saved: {} ({}x{}, {} samples)", abs_path.string(), pending.width,
+                           pending.height, pending.sample_count);
+    } else {
+        grassland::LogError("Failed to save screenshot: {}", pending.filename);
+    }
+}
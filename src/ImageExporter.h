@@ -0,0 +1,63 @@
+#pragma once
+#include "Film.h"
+#include "ImageWriter.h"
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+
+// Background export of accumulated images (e.g. screenshots). The caller
+// hands over copies of the buffers; the conversion (parallel, SSE for PNG)
+// and the encode run as a thread pool task, so the render loop only pays for
+// the copy. Up to kMaxInFlight exports run at once, each on its own copy.
+// Not thread-safe: queue and poll from one thread.
+class ImageExporter {
+public:
+    // Each export holds a float copy of the image until it is encoded
+    static constexpr size_t kMaxInFlight = 4;
+
+    // Buffers owned by one export, see RenderImageData
+    struct Image {
+        int width = 0;
+        int height = 0;
+        int sample_count = 0;
+        std::vector<float> accumulated_rgba;
+        std::vector<int32_t> entity_ids; // Empty: no ID layer
+        // Film AOV sums; empty when the film did not allocate the layer
+        std::vector<float> albedo;
+        std::vector<float> normal;
+        std::vector<float> depth;
+
+        RenderImageData GetRenderData() const;
+    };
+
+    // Copy film's color and allocated AOV layers, e.g. for Export. Device
+    // films download their images, so the device must be idle.
+    static Image CaptureFilm(Film* film);
+
+    ~ImageExporter();
+
+    // Queue image for writing to filename (PNG, or an HDR format by
+    // extension, see WriteRenderImage). Returns false, dropping the image,
+    // when kMaxInFlight exports are still running.
+    bool Export(const std::string& filename, Image image, const HdrWriteOptions& options = HdrWriteOptions());
+
+    // Log the exports that finished since the last call
+    void Poll();
+    size_t GetPendingCount() const { return exports_.size(); }
+    // Block until every queued export has finished, then log them
+    void WaitAll();
+
+private:
+    struct PendingExport {
+        std::string filename;
+        int width;
+        int height;
+        int sample_count;
+        std::future<bool> result;
+    };
+
+    void Finish(PendingExport& pending);
+
+    std::vector<PendingExport> exports_;
+};
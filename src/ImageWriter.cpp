@@ -0,0 +1,503 @@
+#include "ImageWriter.h"
+#include "ThreadPool.h"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define IMAGE_WRITER_USE_SSE 1
+#include <immintrin.h>
+#endif
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace {
+
+// Pixels per conversion task; large enough to amortize scheduling
+constexpr size_t kConvertTilePixels = 16384;
+
+void ConvertPixel(const float* accumulated, uint8_t* out) {
+    float samples = accumulated[3];
+    float inv_samples = samples > 0.0f ? 1.0f / samples : 0.0f;
+    for (size_t c = 0; c < 4; c++) {
+        float value = accumulated[c] * inv_samples;
+        out[c] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, value)) * 255.0f);
+    }
+}
+
+#if IMAGE_WRITER_USE_SSE
+// Same result as ConvertPixel for one RGBA pixel, as four int32 lanes
+__m128i ConvertPixelSse(const float* accumulated) {
+    __m128 color = _mm_loadu_ps(accumulated);
+    float samples = accumulated[3];
+    __m128 scale = _mm_set1_ps(samples > 0.0f ? 1.0f / samples : 0.0f);
+    // Clamp in the scalar order, so NaN maps to 255 there as well
+    __m128 value = _mm_max_ps(_mm_min_ps(_mm_mul_ps(color, scale), _mm_set1_ps(1.0f)), _mm_setzero_ps());
+    return _mm_cvttps_epi32(_mm_mul_ps(value, _mm_set1_ps(255.0f)));
+}
+#endif
+
+} // namespace
+
+void ConvertAccumulatedToRgba8(const float* accumulated_rgba, size_t pixel_count, uint8_t* rgba8) {
+    size_t tile_count = (pixel_count + kConvertTilePixels - 1) / kConvertTilePixels;
+    ThreadPool::Global().ParallelFor(tile_count, [&](size_t tile) {
+        size_t begin = tile * kConvertTilePixels;
+        size_t end = std::min(pixel_count, begin + kConvertTilePixels);
+        size_t i = begin;
+#if IMAGE_WRITER_USE_SSE
+        // Four pixels per iteration, packed down to 16 bytes
+        for (; i + 4 <= end; i += 4) {
+            const float* in = accumulated_rgba + i * 4;
+            __m128i low = _mm_packs_epi32(ConvertPixelSse(in), ConvertPixelSse(in + 4));
+            __m128i high = _mm_packs_epi32(ConvertPixelSse(in + 8), ConvertPixelSse(in + 12));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(rgba8 + i * 4), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; i < end; i++) {
+            ConvertPixel(accumulated_rgba + i * 4, rgba8 + i * 4);
+        }
+    });
+}
+
+bool WriteAccumulatedPng(const std::string& filename, const float* accumulated_rgba, int width, int height) {
+    size_t pixel_count = static_cast<size_t>(width) * height;
+
+    // Convert from accumulated sum to averaged color, then to 8-bit
+    std::vector<uint8_t> byte_data(pixel_count * 4);
+    ConvertAccumulatedToRgba8(accumulated_rgba, pixel_count, byte_data.data());
+    return stbi_write_png(filename.c_str(), width, height, 4, byte_data.data(), width * 4) != 0;
+}
+
+namespace {
+
+constexpr char kExrMagic[4] = { 0x76, 0x2f, 0x31, 0x01 };
+constexpr int kExrZipLines = 16;
+
+uint16_t ToHalf(float value) {
+    // Clamp to the largest half instead of overflowing to infinity
+    return glm::packHalf1x16(std::max(-65504.0f, std::min(value, 65504.0f)));
+}
+
+template <typename T>
+void Append(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+void AppendString(std::vector<uint8_t>& out, const std::string& text) {
+    out.insert(out.end(), text.begin(), text.end());
+    out.push_back(0);
+}
+
+void AppendAttribute(std::vector<uint8_t>& out, const std::string& name, const std::string& type,
+                     const std::vector<uint8_t>& value) {
+    AppendString(out, name);
+    AppendString(out, type);
+    Append(out, static_cast<int32_t>(value.size()));
+    out.insert(out.end(), value.begin(), value.end());
+}
+
+// OpenEXR's ZIP preprocessing: split even and odd bytes, then delta-encode
+void ExrZipPredict(const std::vector<uint8_t>& raw, std::vector<uint8_t>& out) {
+    out.resize(raw.size());
+    size_t half = (raw.size() + 1) / 2;
+    for (size_t i = 0; i < raw.size(); i++) {
+        out[(i & 1) ? half + i / 2 : i / 2] = raw[i];
+    }
+    int previous = out.empty() ? 0 : out[0];
+    for (size_t i = 1; i < out.size(); i++) {
+        int current = out[i];
+        out[i] = static_cast<uint8_t>(current - previous + (128 + 256));
+        previous = current;
+    }
+}
+
+struct ExrChannel {
+    std::string name;
+    size_t layer;
+    size_t component;
+    bool half;
+};
+
+bool WriteExr(const std::string& filename, int width, int height, const std::vector<ImageLayer>& layers,
+              const HdrWriteOptions& options) {
+    // Channels are stored in name order, as the format requires
+    std::vector<ExrChannel> channels;
+    for (size_t l = 0; l < layers.size(); l++) {
+        for (size_t c = 0; c < layers[l].channels.size(); c++) {
+            channels.push_back({ layers[l].channels[c], l, c, options.half && !layers[l].exact });
+        }
+    }
+    std::sort(channels.begin(), channels.end(),
+              [](const ExrChannel& a, const ExrChannel& b) { return a.name < b.name; });
+
+    std::vector<uint8_t> header(kExrMagic, kExrMagic + 4);
+    Append(header, static_cast<int32_t>(2)); // version 2, single-part scanline
+    std::vector<uint8_t> value;
+    for (const auto& channel : channels) {
+        AppendString(value, channel.name);
+        Append(value, static_cast<int32_t>(channel.half ? 1 : 2)); // HALF or FLOAT
+        Append(value, static_cast<uint32_t>(0));                   // pLinear and reserved
+        Append(value, static_cast<int32_t>(1));                    // x and y sampling
+        Append(value, static_cast<int32_t>(1));
+    }
+    value.push_back(0);
+    AppendAttribute(header, "channels", "chlist", value);
+    uint8_t compression = options.compression == ExrCompression::kZip    ? 3
+                          : options.compression == ExrCompression::kZips ? 2
+                                                                         : 0;
+    AppendAttribute(header, "compression", "compression", { compression });
+    value.clear();
+    for (int32_t v : { 0, 0, width - 1, height - 1 }) {
+        Append(value, v);
+    }
+    AppendAttribute(header, "dataWindow", "box2i", value);
+    AppendAttribute(header, "displayWindow", "box2i", value);
+    AppendAttribute(header, "lineOrder", "lineOrder", { 0 }); // increasing y
+    value.clear();
+    Append(value, 1.0f);
+    AppendAttribute(header, "pixelAspectRatio", "float", value);
+    AppendAttribute(header, "screenWindowWidth", "float", value);
+    value.clear();
+    Append(value, 0.0f);
+    Append(value, 0.0f);
+    AppendAttribute(header, "screenWindowCenter", "v2f", value);
+    header.push_back(0);
+
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const int block_lines = options.compression == ExrCompression::kZip ? kExrZipLines : 1;
+    const int block_count = (height + block_lines - 1) / block_lines;
+    // Chunk offsets are only known once the chunks are written; reserve the table
+    std::vector<uint64_t> offsets(block_count, 0);
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+              std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    uint64_t position = header.size() + offsets.size() * sizeof(uint64_t);
+
+    std::vector<std::vector<float>> rows(layers.size());
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> predicted;
+    for (int block = 0; ok && block < block_count; block++) {
+        const int y0 = block * block_lines;
+        const int lines = std::min(block_lines, height - y0);
+        for (size_t l = 0; l < layers.size(); l++) {
+            size_t row_size = static_cast<size_t>(width) * layers[l].channels.size();
+            rows[l].resize(row_size * lines);
+            for (int line = 0; line < lines; line++) {
+                layers[l].read_row(y0 + line, rows[l].data() + row_size * line);
+            }
+        }
+        raw.clear();
+        for (int line = 0; line < lines; line++) {
+            for (const auto& channel : channels) {
+                const size_t stride = layers[channel.layer].channels.size();
+                const float* row = rows[channel.layer].data() + static_cast<size_t>(width) * stride * line;
+                for (int x = 0; x < width; x++) {
+                    float v = row[x * stride + channel.component];
+                    if (channel.half) {
+                        Append(raw, ToHalf(v));
+                    } else {
+                        Append(raw, v);
+                    }
+                }
+            }
+        }
+
+        const uint8_t* data = raw.data();
+        int size = static_cast<int>(raw.size());
+        unsigned char* compressed = nullptr;
+        if (options.compression != ExrCompression::kNone) {
+            ExrZipPredict(raw, predicted);
+            int compressed_size = 0;
+            compressed = stbi_zlib_compress(predicted.data(), static_cast<int>(predicted.size()), &compressed_size,
+                                            stbi_write_png_compression_level);
+            // Readers take a chunk as stored when it is not smaller than the raw data
+            if (compressed && compressed_size < size) {
+                data = compressed;
+                size = compressed_size;
+            }
+        }
+        offsets[block] = position;
+        int32_t chunk_header[2] = { y0, size };
+        ok = std::fwrite(chunk_header, sizeof(chunk_header), 1, file) == 1 &&
+             std::fwrite(data, 1, size, file) == static_cast<size_t>(size);
+        position += sizeof(chunk_header) + size;
+        STBIW_FREE(compressed);
+    }
+    ok = ok && std::fseek(file, static_cast<long>(header.size()), SEEK_SET) == 0 &&
+         std::fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+// Grey for one channel, otherwise the first three (missing ones are 0)
+bool WritePfm(const std::string& filename, int width, int height, const ImageLayer& layer) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const size_t stride = layer.channels.size();
+    const size_t out_channels = stride == 1 ? 1 : 3;
+    // A negative scale marks little-endian data
+    std::string header = std::string(stride == 1 ? "Pf" : "PF") + "\n" + std::to_string(width) + " " +
+                         std::to_string(height) + "\n-1.0\n";
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    std::vector<float> row(width * stride);
+    std::vector<float> out(width * out_channels);
+    // Rows run bottom to top
+    for (int y = height - 1; ok && y >= 0; y--) {
+        layer.read_row(y, row.data());
+        for (int x = 0; x < width; x++) {
+            for (size_t c = 0; c < out_channels; c++) {
+                out[x * out_channels + c] = c < stride ? row[x * stride + c] : 0.0f;
+            }
+        }
+        ok = std::fwrite(out.data(), sizeof(float), out.size(), file) == out.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+// Run-length encode one RGBE component of a scanline (runs of 3 or more
+// repeat a byte, the rest are literal)
+void AppendRleComponent(std::vector<uint8_t>& out, const uint8_t* data, int width) {
+    int x = 0;
+    while (x < width) {
+        int run_start = x;
+        int run_length = 0;
+        while (run_start < width) {
+            run_length = 1;
+            while (run_start + run_length < width && run_length < 127 &&
+                   data[run_start + run_length] == data[run_start]) {
+                run_length++;
+            }
+            if (run_length >= 3) {
+                break;
+            }
+            run_start += run_length;
+        }
+        run_start = std::min(run_start, width);
+        while (x < run_start) {
+            int count = std::min(128, run_start - x);
+            out.push_back(static_cast<uint8_t>(count));
+            out.insert(out.end(), data + x, data + x + count);
+            x += count;
+        }
+        if (run_start < width) {
+            out.push_back(static_cast<uint8_t>(128 + run_length));
+            out.push_back(data[run_start]);
+            x = run_start + run_length;
+        }
+    }
+}
+
+// Grey for one channel, otherwise the first three; negative values clamp to 0
+bool WriteRadianceHdr(const std::string& filename, int width, int height, const ImageLayer& layer) {
+    FILE* file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " +
+                         std::to_string(width) + "\n";
+    bool ok = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+    const size_t stride = layer.channels.size();
+    // New-style RLE scanlines are only defined for these widths
+    const bool rle = width >= 8 && width < 32768;
+    std::vector<float> row(width * stride);
+    std::vector<uint8_t> rgbe(width * 4);
+    std::vector<uint8_t> components(width);
+    std::vector<uint8_t> out;
+    for (int y = 0; ok && y < height; y++) {
+        layer.read_row(y, row.data());
+        for (int x = 0; x < width; x++) {
+            float color[3];
+            for (size_t c = 0; c < 3; c++) {
+                float v = stride == 1 ? row[x] : c < stride ? row[x * stride + c] : 0.0f;
+                color[c] = std::max(v, 0.0f);
+            }
+            float largest = std::max(color[0], std::max(color[1], color[2]));
+            uint8_t* pixel = &rgbe[x * 4];
+            if (!(largest >= 1e-32f)) {
+                pixel[0] = pixel[1] = pixel[2] = pixel[3] = 0;
+                continue;
+            }
+            int exponent;
+            float scale = std::frexp(largest, &exponent) * 256.0f / largest;
+            for (int c = 0; c < 3; c++) {
+                pixel[c] = static_cast<uint8_t>(std::min(color[c] * scale, 255.0f));
+            }
+            pixel[3] = static_cast<uint8_t>(exponent + 128);
+        }
+        out.clear();
+        if (rle) {
+            out.insert(out.end(), { 2, 2, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width & 255) });
+            for (int c = 0; c < 4; c++) {
+                for (int x = 0; x < width; x++) {
+                    components[x] = rgbe[x * 4 + c];
+                }
+                AppendRleComponent(out, components.data(), width);
+            }
+        } else {
+            out = rgbe;
+        }
+        ok = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+bool GetHdrFormat(const std::string& filename, HdrFormat* format) {
+    std::string extension = std::filesystem::path(filename).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == ".exr") {
+        *format = HdrFormat::kExr;
+    } else if (extension == ".pfm") {
+        *format = HdrFormat::kPfm;
+    } else if (extension == ".hdr") {
+        *format = HdrFormat::kHdr;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool WriteHdrImage(const std::string& filename, int width, int height, const std::vector<ImageLayer>& layers,
+                   const HdrWriteOptions& options) {
+    HdrFormat format;
+    if (!GetHdrFormat(filename, &format) || layers.empty() || width <= 0 || height <= 0) {
+        return false;
+    }
+    for (const auto& layer : layers) {
+        if (layer.channels.empty() || !layer.read_row) {
+            return false;
+        }
+    }
+    if (format == HdrFormat::kExr) {
+        return WriteExr(filename, width, height, layers, options);
+    }
+    // One file per layer
+    std::filesystem::path path(filename);
+    for (size_t l = 0; l < layers.size(); l++) {
+        std::filesystem::path layer_path = path;
+        if (l > 0) {
+            layer_path.replace_filename(path.stem().string() + "." + layers[l].name + path.extension().string());
+        }
+        bool ok = format == HdrFormat::kPfm ? WritePfm(layer_path.string(), width, height, layers[l])
+                                            : WriteRadianceHdr(layer_path.string(), width, height, layers[l]);
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ImageLayer MakeBeautyLayer(const float* accumulated_rgba, int width) {
+    ImageLayer layer;
+    layer.channels = { "R", "G", "B", "A" };
+    layer.read_row = [accumulated_rgba, width](int y, float* row) {
+        const float* in = accumulated_rgba + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            float samples = in[x * 4 + 3];
+            float inv_samples = samples > 0.0f ? 1.0f / samples : 0.0f;
+            for (int c = 0; c < 4; c++) {
+                row[x * 4 + c] = in[x * 4 + c] * inv_samples;
+            }
+        }
+    };
+    return layer;
+}
+
+ImageLayer MakeEntityIdLayer(const int32_t* entity_ids, int width) {
+    ImageLayer layer;
+    layer.name = "id";
+    layer.channels = { "id" };
+    layer.exact = true;
+    layer.read_row = [entity_ids, width](int y, float* row) {
+        const int32_t* in = entity_ids + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            row[x] = static_cast<float>(in[x]);
+        }
+    };
+    return layer;
+}
+
+ImageLayer MakeAovLayer(const std::string& name, const std::vector<std::string>& channels, const float* sums,
+                        int components, const float* accumulated_rgba, int width, bool exact) {
+    ImageLayer layer;
+    layer.name = name;
+    layer.channels = channels;
+    layer.exact = exact;
+    const int channel_count = static_cast<int>(channels.size());
+    layer.read_row = [=](int y, float* row) {
+        const size_t first = static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            float samples = accumulated_rgba[(first + x) * 4 + 3];
+            float inv_samples = samples > 0.0f ? 1.0f / samples : 0.0f;
+            const float* in = sums + (first + x) * components;
+            for (int c = 0; c < channel_count; c++) {
+                row[x * channel_count + c] = in[c] * inv_samples;
+            }
+        }
+    };
+    return layer;
+}
+
+ImageLayer MakeDepthLayer(const float* depth, int width) {
+    ImageLayer layer;
+    // Z is the channel name compositors look for
+    layer.name = "depth";
+    layer.channels = { "Z" };
+    layer.exact = true;
+    layer.read_row = [=](int y, float* row) {
+        const float* in = depth + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            float hits = in[x * 4 + 1];
+            row[x] = hits > 0.0f ? in[x * 4] / hits : kDepthNoHit;
+        }
+    };
+    return layer;
+}
+
+ImageLayer MakeFloatLayer(const std::string& name, const std::vector<std::string>& channels, const float* data,
+                          int width, bool exact) {
+    ImageLayer layer;
+    layer.name = name;
+    layer.channels = channels;
+    layer.exact = exact;
+    const size_t row_size = static_cast<size_t>(width) * channels.size();
+    layer.read_row = [data, row_size](int y, float* row) {
+        std::copy(data + row_size * y, data + row_size * (y + 1), row);
+    };
+    return layer;
+}
+
+bool WriteRenderImage(const std::string& filename, const RenderImageData& data, const HdrWriteOptions& options) {
+    HdrFormat format;
+    if (!GetHdrFormat(filename, &format)) {
+        return WriteAccumulatedPng(filename, data.accumulated_rgba, data.width, data.height);
+    }
+    std::vector<ImageLayer> layers = { MakeBeautyLayer(data.accumulated_rgba, data.width) };
+    if (data.entity_ids) {
+        layers.push_back(MakeEntityIdLayer(data.entity_ids, data.width));
+    }
+    if (data.albedo) {
+        layers.push_back(MakeAovLayer("albedo", { "albedo.R", "albedo.G", "albedo.B" }, data.albedo, 4,
+                                      data.accumulated_rgba, data.width));
+    }
+    if (data.normal) {
+        layers.push_back(MakeAovLayer("normal", { "normal.X", "normal.Y", "normal.Z" }, data.normal, 4,
+                                      data.accumulated_rgba, data.width));
+    }
+    if (data.depth) {
+        layers.push_back(MakeDepthLayer(data.depth, data.width));
+    }
+    return WriteHdrImage(filename, data.width, data.height, layers, options);
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Write an accumulated RGBA32F sum (rows top to bottom) as an 8-bit PNG.
+// Every sample adds 1 to alpha, so each pixel is averaged over its own
+// sample count, which adaptive sampling lets differ between pixels. Colors
+// are clamped to [0, 1].
+bool WriteAccumulatedPng(const std::string& filename, const float* accumulated_rgba, int width, int height);
+
+// The conversion WriteAccumulatedPng does before encoding: average, clamp
+// and quantize pixel_count RGBA pixels to 8 bits, in parallel on the global
+// thread pool (SSE where available)
+void ConvertAccumulatedToRgba8(const float* accumulated_rgba, size_t pixel_count, uint8_t* rgba8);
+
+// Float outputs, chosen by extension: .exr (OpenEXR scanline image, any
+// number of layers in one file), .pfm (portable float map) and .hdr
+// (Radiance RGBE). PFM and HDR hold one RGB or grey image; their first layer
+// goes to filename and every further layer to <stem>.<layer name><ext>.
+enum class HdrFormat {
+    kExr,
+    kPfm,
+    kHdr,
+};
+
+enum class ExrCompression {
+    kNone,
+    kZips, // zlib per scanline
+    kZip,  // zlib per 16 scanlines: smaller, coarser random access
+};
+
+struct HdrWriteOptions {
+    bool half = true; // EXR: 16-bit float channels (layers marked exact stay 32-bit)
+    ExrCompression compression = ExrCompression::kZip;
+};
+
+// One layer of an HDR image. Writers pull it a row at a time (PFM bottom to
+// top, the others top to bottom) and only keep a block of scanlines
+// converted, so their memory does not grow with the image height.
+struct ImageLayer {
+    std::string name;                  // PFM/HDR file suffix, e.g. albedo
+    std::vector<std::string> channels; // EXR channel names, e.g. R, G, B, A or albedo.R, albedo.G, albedo.B
+    bool exact = false;                // EXR: always 32-bit float, e.g. IDs and depth
+    // Fill row y (0 = top) with width * channels.size() interleaved values
+    std::function<void(int y, float* row)> read_row;
+};
+
+// False if filename has none of the extensions above
+bool GetHdrFormat(const std::string& filename, HdrFormat* format);
+
+// Write layers (all width x height) to filename in the format its extension names
+bool WriteHdrImage(const std::string& filename, int width, int height, const std::vector<ImageLayer>& layers,
+                   const HdrWriteOptions& options = HdrWriteOptions());
+
+// Standard layers over buffers that must outlive the write.
+// Beauty: RGBA from an accumulated sum, averaged by each pixel's alpha count
+ImageLayer MakeBeautyLayer(const float* accumulated_rgba, int width);
+// Entity ID: one exact channel "id", -1 where the primary ray missed
+ImageLayer MakeEntityIdLayer(const int32_t* entity_ids, int width);
+// Film AOV sums with components values per pixel, averaged by the beauty's
+// alpha count like the color; the first channels.size() components are written
+ImageLayer MakeAovLayer(const std::string& name, const std::vector<std::string>& channels, const float* sums,
+                        int components, const float* accumulated_rgba, int width, bool exact = false);
+// Film depth AOV (distance sum, hit count) as one exact channel "Z": the mean
+// distance of the samples that hit, kDepthNoHit where none did
+constexpr float kDepthNoHit = 10000.0f; // the camera ray's range
+ImageLayer MakeDepthLayer(const float* depth, int width);
+// Any other per-pixel float data, channel_count values per pixel
+ImageLayer MakeFloatLayer(const std::string& name, const std::vector<std::string>& channels, const float* data,
+                          int width, bool exact = false);
+
+// Buffers of a rendered image (rows top to bottom); optional ones may be null
+struct RenderImageData {
+    int width = 0;
+    int height = 0;
+    const float* accumulated_rgba = nullptr; // RGBA32F sum, as WriteAccumulatedPng takes it
+    const int32_t* entity_ids = nullptr;     // primary hit entity per pixel, -1 on miss
+    // Film AOV sums (Film.h): albedo, normal and depth RGBA32F
+    const float* albedo = nullptr;
+    const float* normal = nullptr;
+    const float* depth = nullptr;
+};
+
+// 8-bit PNG of the beauty pass, or for .exr/.pfm/.hdr names an HDR image with
+// a layer per buffer present
+bool WriteRenderImage(const std::string& filename, const RenderImageData& data,
+                      const HdrWriteOptions& options = HdrWriteOptions());
@@ -0,0 +1,236 @@
+#include "JsonReader.h"
+#include <cstdlib>
+
+namespace {
+
+constexpr size_t kChunkSize = 1 << 16;
+
+void AppendUtf8(std::string* out, unsigned code_point) {
+    if (code_point < 0x80) {
+        out->push_back(static_cast<char>(code_point));
+    } else if (code_point < 0x800) {
+        out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else if (code_point < 0x10000) {
+        out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    } else {
+        out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+        out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+    }
+}
+
+} // namespace
+
+JsonReader::JsonReader()
+    : file_(nullptr)
+    , buffer_(kChunkSize)
+    , position_(0)
+    , size_(0)
+    , bytes_read_(0)
+    , line_(1)
+    , column_(0)
+    , expect_(Expect::Value)
+    , number_(0.0)
+    , boolean_(false) {
+}
+
+JsonReader::~JsonReader() {
+    if (file_) {
+        std::fclose(file_);
+    }
+}
+
+bool JsonReader::Open(const std::string& path) {
+    file_ = std::fopen(path.c_str(), "rb");
+    return file_ != nullptr;
+}
+
+int JsonReader::Peek() {
+    if (position_ == size_) {
+        if (!file_) return EOF;
+        size_ = std::fread(buffer_.data(), 1, buffer_.size(), file_);
+        position_ = 0;
+        bytes_read_ += size_;
+        if (size_ == 0) return EOF;
+    }
+    return static_cast<unsigned char>(buffer_[position_]);
+}
+
+int JsonReader::Get() {
+    int c = Peek();
+    if (c != EOF) {
+        ++position_;
+        if (c == '\n') {
+            ++line_;
+            column_ = 0;
+        } else {
+            ++column_;
+        }
+    }
+    return c;
+}
+
+void JsonReader::SkipWhitespace() {
+    for (int c = Peek(); c == ' ' || c == '\t' || c == '\n' || c == '\r'; c = Peek()) {
+        Get();
+    }
+}
+
+JsonReader::Token JsonReader::Fail(const std::string& message) {
+    error_ = message;
+    return Token::Error;
+}
+
+JsonReader::Token JsonReader::Unexpected(int c) {
+    const char* expected = "";
+    switch (expect_) {
+    case Expect::Value: expected = "a value"; break;
+    case Expect::ValueOrEnd: expected = "a value or ']'"; break;
+    case Expect::Key: expected = "a key"; break;
+    case Expect::KeyOrEnd: expected = "a key or '}'"; break;
+    case Expect::Colon: expected = "':'"; break;
+    case Expect::CommaOrEnd: expected = containers_.back() == '{' ? "',' or '}'" : "',' or ']'"; break;
+    case Expect::Done: expected = "end of file"; break;
+    }
+    std::string found = c == EOF ? std::string("end of file") : std::string("'") + static_cast<char>(c) + "'";
+    return Fail("unexpected " + found + ", expected " + expected);
+}
+
+// Called once a complete value (scalar or closed container) was read
+JsonReader::Token JsonReader::EndValue(Token token) {
+    if (token != Token::Error) {
+        expect_ = containers_.empty() ? Expect::Done : Expect::CommaOrEnd;
+    }
+    return token;
+}
+
+JsonReader::Token JsonReader::Next() {
+    if (!error_.empty()) return Token::Error;
+    for (;;) {
+        SkipWhitespace();
+        int c = Get();
+        switch (c) {
+        case EOF:
+            return expect_ == Expect::Done ? Token::End : Unexpected(c);
+        case '{':
+        case '[':
+            if (!IsValueExpected()) return Unexpected(c);
+            containers_.push_back(static_cast<char>(c));
+            expect_ = c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+            return c == '{' ? Token::BeginObject : Token::BeginArray;
+        case '}':
+        case ']': {
+            char open = c == '}' ? '{' : '[';
+            bool empty_close = expect_ == (c == '}' ? Expect::KeyOrEnd : Expect::ValueOrEnd);
+            if (containers_.empty() || containers_.back() != open || (expect_ != Expect::CommaOrEnd && !empty_close)) {
+                return Unexpected(c);
+            }
+            containers_.pop_back();
+            return EndValue(c == '}' ? Token::EndObject : Token::EndArray);
+        }
+        case ',':
+            if (expect_ != Expect::CommaOrEnd) return Unexpected(c);
+            expect_ = containers_.back() == '{' ? Expect::Key : Expect::Value;
+            continue;
+        case ':':
+            if (expect_ != Expect::Colon) return Unexpected(c);
+            expect_ = Expect::Value;
+            continue;
+        case '"':
+            if (expect_ == Expect::Key || expect_ == Expect::KeyOrEnd) {
+                expect_ = Expect::Colon;
+                return ReadString(Token::Key);
+            }
+            if (!IsValueExpected()) return Unexpected(c);
+            return EndValue(ReadString(Token::String));
+        default:
+            if (!IsValueExpected()) return Unexpected(c);
+            if (c == '-' || (c >= '0' && c <= '9')) return EndValue(ReadNumber(c));
+            if (c == 't' || c == 'f' || c == 'n') return EndValue(ReadLiteral(c));
+            return Fail(std::string("unexpected character '") + static_cast<char>(c) + "'");
+        }
+    }
+}
+
+bool JsonReader::SkipValue(Token first) {
+    if (first != Token::BeginObject && first != Token::BeginArray) {
+        return first != Token::Error && first != Token::End;
+    }
+    int depth = 1;
+    while (depth > 0) {
+        Token token = Next();
+        if (token == Token::BeginObject || token == Token::BeginArray) ++depth;
+        else if (token == Token::EndObject || token == Token::EndArray) --depth;
+        else if (token == Token::Error || token == Token::End) return false;
+    }
+    return true;
+}
+
+JsonReader::Token JsonReader::ReadString(Token kind) {
+    string_.clear();
+    for (;;) {
+        int c = Get();
+        if (c == EOF) return Fail("unterminated string");
+        if (c == '"') return kind;
+        if (c != '\\') {
+            string_.push_back(static_cast<char>(c));
+            continue;
+        }
+        c = Get();
+        switch (c) {
+        case '"': string_.push_back('"'); break;
+        case '\\': string_.push_back('\\'); break;
+        case '/': string_.push_back('/'); break;
+        case 'b': string_.push_back('\b'); break;
+        case 'f': string_.push_back('\f'); break;
+        case 'n': string_.push_back('\n'); break;
+        case 'r': string_.push_back('\r'); break;
+        case 't': string_.push_back('\t'); break;
+        case 'u': {
+            unsigned code_point = 0;
+            for (int i = 0; i < 4; ++i) {
+                int h = Get();
+                code_point <<= 4;
+                if (h >= '0' && h <= '9') code_point |= h - '0';
+                else if (h >= 'a' && h <= 'f') code_point |= h - 'a' + 10;
+                else if (h >= 'A' && h <= 'F') code_point |= h - 'A' + 10;
+                else return Fail("bad \\u escape");
+            }
+            AppendUtf8(&string_, code_point);
+            break;
+        }
+        default:
+            return Fail("bad escape sequence");
+        }
+    }
+}
+
+JsonReader::Token JsonReader::ReadNumber(int first) {
+    char text[64];
+    size_t length = 0;
+    text[length++] = static_cast<char>(first);
+    for (int c = Peek(); (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-';
+         c = Peek()) {
+        if (length + 1 >= sizeof(text)) return Fail("number too long");
+        text[length++] = static_cast<char>(Get());
+    }
+    text[length] = '\0';
+    char* end = nullptr;
+    number_ = std::strtod(text, &end);
+    if (end != text + length) return Fail(std::string("bad number '") + text + "'");
+    return Token::Number;
+}
+
+JsonReader::Token JsonReader::ReadLiteral(int first) {
+    const char* expected = first == 't' ? "rue" : first == 'f' ? "alse" : "ull";
+    for (const char* p = expected; *p; ++p) {
+        if (Get() != *p) return Fail("bad literal");
+    }
+    if (first == 'n') return Token::Null;
+    boolean_ = first == 't';
+    return Token::Boolean;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Streaming pull parser for JSON. It reads the file in fixed-size chunks and
+// hands out one token at a time, so memory use does not depend on the size
+// of the document. Object keys are reported as Key tokens, values follow.
+// Commas and colons are checked, so a malformed document fails at the first
+// misplaced token, reported by GetLine and GetColumn.
+class JsonReader {
+public:
+    enum class Token {
+        BeginObject,
+        EndObject,
+        BeginArray,
+        EndArray,
+        Key,
+        String,
+        Number,
+        Boolean,
+        Null,
+        End,
+        Error,
+    };
+
+    JsonReader();
+    ~JsonReader();
+
+    bool Open(const std::string& path);
+
+    Token Next();
+
+    // Skip the value whose first token was just returned (no-op for scalars)
+    bool SkipValue(Token first);
+
+    // Valid after Key / String, Number and Boolean respectively
+    const std::string& GetString() const { return string_; }
+    double GetNumber() const { return number_; }
+    bool GetBoolean() const { return boolean_; }
+
+    // Position of the last character read; after an error, the offending one
+    int GetLine() const { return line_; }
+    int GetColumn() const { return column_; }
+    const std::string& GetError() const { return error_; }
+    size_t GetBytesRead() const { return bytes_read_; }
+
+private:
+    // What the grammar allows next
+    enum class Expect {
+        Value,
+        ValueOrEnd, // right after '['
+        Key,
+        KeyOrEnd,   // right after '{'
+        Colon,
+        CommaOrEnd,
+        Done,       // the top-level value is complete
+    };
+
+    int Peek();
+    int Get();
+    void SkipWhitespace();
+    Token Fail(const std::string& message);
+    Token Unexpected(int c);
+    bool IsValueExpected() const { return expect_ == Expect::Value || expect_ == Expect::ValueOrEnd; }
+    Token EndValue(Token token);
+    Token ReadString(Token kind);
+    Token ReadNumber(int first);
+    Token ReadLiteral(int first);
+
+    FILE* file_;
+    std::vector<char> buffer_;
+    size_t position_;
+    size_t size_;
+    size_t bytes_read_;
+    int line_;
+    int column_;
+
+    std::vector<char> containers_; // '{' or '[' for every open container
+    Expect expect_;
+
+    std::string string_;
+    double number_;
+    bool boolean_;
+    std::string error_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+#include "long_march.h"
+
+struct PointLight {
+    glm::vec3 position;
+    glm::vec3 color;
+    float intensity;
+
+    PointLight() : position(0.0f), color(1.0f), intensity(1.0f) {}
+    PointLight(const glm::vec3& pos, const glm::vec3& col, float intens) 
+        : position(pos), color(col), intensity(intens) {}
+};
+
+struct AreaLight {
+    glm::vec3 center;
+    glm::vec3 normal;
+    glm::vec3 left;
+    float width;
+    float height;
+    glm::vec3 color;
+    float intensity;
+
+    AreaLight() : center(0.0f), normal(0.0f, 1.0f, 0.0f), left(1.0f, 0.0f, 0.0f), 
+                  width(1.0f), height(1.0f), color(1.0f), intensity(1.0f) {}
+    AreaLight(const glm::vec3& cen, const glm::vec3& norm, const glm::vec3& lft, 
+              float w, float h, const glm::vec3& col, float intens)
+        : center(cen), normal(norm), left(lft), width(w), height(h), 
+          color(col), intensity(intens) {}
+};
+
+// How direct lighting picks the one light it evaluates per shading point
+enum class LightSelection : uint32_t {
+    kBvh = 0,   // LightBvh: power over distance, O(log N)
+    kPower = 1, // alias table over emitted power alone, O(1)
+};
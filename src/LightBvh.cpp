@@ -0,0 +1,139 @@
+#include "LightBvh.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Importance of a node seen from position: its power over the squared
+// distance to its center, clamped by its own extent so nodes that contain
+// the point do not blow up. Must match LightNodeImportance in shader.hlsl.
+float NodeImportance(const LightBvh::Node& node, const glm::vec3& position) {
+    glm::vec3 center = (node.bounds_min + node.bounds_max) * 0.5f;
+    glm::vec3 half_extent = (node.bounds_max - node.bounds_min) * 0.5f;
+    glm::vec3 offset = position - center;
+    float distance2 = glm::dot(offset, offset);
+    float radius2 = glm::dot(half_extent, half_extent);
+    return node.power / std::max(std::max(distance2, radius2), 1e-4f);
+}
+
+} // namespace
+
+float LightBvh::GetPower(const glm::vec3& color, float intensity) {
+    float luminance = 0.2126f * color.x + 0.7152f * color.y + 0.0722f * color.z;
+    return std::max(0.0f, luminance * intensity);
+}
+
+std::vector<float> LightBvh::GetPowers(const std::vector<PointLight>& point_lights,
+                                      const std::vector<AreaLight>& area_lights) {
+    std::vector<float> powers;
+    powers.reserve(point_lights.size() + area_lights.size());
+    for (const PointLight& light : point_lights) {
+        powers.push_back(GetPower(light.color, light.intensity));
+    }
+    for (const AreaLight& light : area_lights) {
+        powers.push_back(GetPower(light.color, light.intensity));
+    }
+    return powers;
+}
+
+void LightBvh::Build(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights) {
+    nodes_.clear();
+    std::vector<Item> items;
+    items.reserve(point_lights.size() + area_lights.size());
+    for (size_t i = 0; i < point_lights.size(); ++i) {
+        const PointLight& light = point_lights[i];
+        items.push_back({ light.position, light.position, GetPower(light.color, light.intensity),
+                          kLeafFlag | static_cast<uint32_t>(i) });
+    }
+    for (size_t i = 0; i < area_lights.size(); ++i) {
+        // Corners of the rectangle SampleAreaLight draws from
+        const AreaLight& light = area_lights[i];
+        glm::vec3 up = glm::normalize(glm::cross(light.normal, light.left));
+        glm::vec3 du = up * (0.5f * light.width);
+        glm::vec3 dv = light.left * (0.5f * light.height);
+        Item item{ glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()),
+                   GetPower(light.color, light.intensity), kLeafFlag | kAreaLightFlag | static_cast<uint32_t>(i) };
+        for (int corner = 0; corner < 4; ++corner) {
+            glm::vec3 p = light.center + ((corner & 1) ? du : -du) + ((corner & 2) ? dv : -dv);
+            item.bounds_min = glm::min(item.bounds_min, p);
+            item.bounds_max = glm::max(item.bounds_max, p);
+        }
+        items.push_back(item);
+    }
+    if (items.empty()) {
+        return;
+    }
+    nodes_.reserve(items.size() * 2 - 1);
+    nodes_.emplace_back();
+    BuildNode(0, items, 0, items.size());
+}
+
+void LightBvh::BuildNode(uint32_t node_index, std::vector<Item>& items, size_t first, size_t count) {
+    glm::vec3 bounds_min(std::numeric_limits<float>::max());
+    glm::vec3 bounds_max(-std::numeric_limits<float>::max());
+    glm::vec3 centroid_min(std::numeric_limits<float>::max());
+    glm::vec3 centroid_max(-std::numeric_limits<float>::max());
+    float power = 0.0f;
+    for (size_t i = first; i < first + count; ++i) {
+        bounds_min = glm::min(bounds_min, items[i].bounds_min);
+        bounds_max = glm::max(bounds_max, items[i].bounds_max);
+        glm::vec3 centroid = (items[i].bounds_min + items[i].bounds_max) * 0.5f;
+        centroid_min = glm::min(centroid_min, centroid);
+        centroid_max = glm::max(centroid_max, centroid);
+        power += items[i].power;
+    }
+    nodes_[node_index].bounds_min = bounds_min;
+    nodes_[node_index].bounds_max = bounds_max;
+    nodes_[node_index].power = power;
+    if (count == 1) {
+        nodes_[node_index].child = items[first].code;
+        return;
+    }
+
+    glm::vec3 extent = centroid_max - centroid_min;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+    size_t mid = first + count / 2;
+    std::nth_element(items.begin() + first, items.begin() + mid, items.begin() + first + count,
+                     [axis](const Item& a, const Item& b) {
+                         return a.bounds_min[axis] + a.bounds_max[axis] < b.bounds_min[axis] + b.bounds_max[axis];
+                     });
+
+    uint32_t left = static_cast<uint32_t>(nodes_.size());
+    nodes_.emplace_back();
+    nodes_.emplace_back();
+    nodes_[node_index].child = left;
+    BuildNode(left, items, first, mid - first);
+    BuildNode(left + 1, items, mid, first + count - mid);
+}
+
+uint32_t LightBvh::Sample(const glm::vec3& position, float u, float* pdf) const {
+    *pdf = 0.0f;
+    if (nodes_.empty() || nodes_[0].power <= 0.0f) {
+        return kNoLight;
+    }
+    uint32_t node = 0;
+    float probability = 1.0f;
+    while (!(nodes_[node].child & kLeafFlag)) {
+        uint32_t left = nodes_[node].child;
+        float left_importance = NodeImportance(nodes_[left], position);
+        float right_importance = NodeImportance(nodes_[left + 1], position);
+        float total = left_importance + right_importance;
+        if (total <= 0.0f) {
+            return kNoLight;
+        }
+        // Reuse u for the next level by rescaling it into the chosen range
+        float left_probability = left_importance / total;
+        if (u < left_probability) {
+            node = left;
+            probability *= left_probability;
+            u = u / left_probability;
+        } else {
+            node = left + 1;
+            probability *= 1.0f - left_probability;
+            u = (u - left_probability) / (1.0f - left_probability);
+        }
+        u = std::min(u, 0.99999994f);
+    }
+    *pdf = probability;
+    return nodes_[node].child;
+}
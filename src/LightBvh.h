@@ -0,0 +1,58 @@
+#pragma once
+#include "long_march.h"
+#include "Light.h"
+#include <vector>
+
+// Tree over all point and area lights for many-light sampling. A shading
+// point walks a single root-to-leaf path, entering each child with
+// probability proportional to its importance (power over squared distance),
+// so choosing a light costs O(log N) however many lights the scene has.
+// shaders/shader.hlsl traverses the same node array in SampleLightBvh.
+class LightBvh {
+public:
+    static constexpr uint32_t kLeafFlag = 0x80000000u;
+    static constexpr uint32_t kAreaLightFlag = 0x40000000u;
+    static constexpr uint32_t kLightIndexMask = 0x3FFFFFFFu;
+    static constexpr uint32_t kNoLight = 0xFFFFFFFFu;
+
+    // Matches LightNode in shader.hlsl. Interior nodes keep their children at
+    // child and child + 1; a leaf's child is kLeafFlag, kAreaLightFlag for area
+    // lights, and the index into the point or area light array.
+    struct Node {
+        glm::vec3 bounds_min;
+        float power;
+        glm::vec3 bounds_max;
+        uint32_t child;
+    };
+
+    // Balanced build: each node splits its lights at the median of the
+    // widest centroid axis
+    void Build(const std::vector<PointLight>& point_lights, const std::vector<AreaLight>& area_lights);
+
+    // Pick a light for a shading point with u in [0, 1). Returns the leaf's
+    // child code and the probability of having picked it, or kNoLight when
+    // no light emits anything.
+    uint32_t Sample(const glm::vec3& position, float u, float* pdf) const;
+
+    // Emitted power used for the importance, the same for both light kinds
+    // since area lights are sampled as point lights of full intensity
+    static float GetPower(const glm::vec3& color, float intensity);
+    // Power of every light, point lights first: the order the power alias table indexes
+    static std::vector<float> GetPowers(const std::vector<PointLight>& point_lights,
+                                        const std::vector<AreaLight>& area_lights);
+
+    const std::vector<Node>& GetNodes() const { return nodes_; }
+    bool IsEmpty() const { return nodes_.empty(); }
+
+private:
+    struct Item {
+        glm::vec3 bounds_min;
+        glm::vec3 bounds_max;
+        float power;
+        uint32_t code;
+    };
+
+    void BuildNode(uint32_t node_index, std::vector<Item>& items, size_t first, size_t count);
+
+    std::vector<Node> nodes_;
+};
@@ -0,0 +1,151 @@
+#include "MeshBinary.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+uint64_t AlignUp(uint64_t offset) {
+    return (offset + kMeshBinaryAlignment - 1) / kMeshBinaryAlignment * kMeshBinaryAlignment;
+}
+
+// Pads from *position up to the section start, then writes the section
+bool WriteAt(FILE* file, uint64_t* position, uint64_t offset, const void* data, uint64_t size) {
+    static const char zeros[kMeshBinaryAlignment] = {};
+    while (*position < offset) {
+        size_t pad = static_cast<size_t>(std::min<uint64_t>(offset - *position, kMeshBinaryAlignment));
+        if (std::fwrite(zeros, 1, pad, file) != pad) return false;
+        *position += pad;
+    }
+    if (size > 0 && std::fwrite(data, 1, static_cast<size_t>(size), file) != size) return false;
+    *position += size;
+    return true;
+}
+
+bool SectionFits(uint64_t offset, uint64_t size, size_t file_size) {
+    return offset % kMeshBinaryAlignment == 0 && offset <= file_size && size <= file_size - offset;
+}
+
+} // namespace
+
+void GetSourceStamp(const std::string& path, uint64_t* size, int64_t* time) {
+    std::error_code error;
+    *size = std::filesystem::file_size(path, error);
+    if (error) *size = 0;
+    auto write_time = std::filesystem::last_write_time(path, error);
+    *time = error ? 0 : static_cast<int64_t>(write_time.time_since_epoch().count());
+}
+
+bool WriteMeshBinary(const std::string& path, uint64_t source_size, int64_t source_time,
+                     const glm::vec3* positions, uint32_t vertex_count,
+                     const uint32_t* indices, uint32_t index_count, const Bvh* bvh) {
+    MeshBinaryHeader header{};
+    std::memcpy(header.magic, kMeshBinaryMagic, sizeof(header.magic));
+    header.version = kMeshBinaryVersion;
+    header.source_size = source_size;
+    header.source_time = source_time;
+    header.vertex_count = vertex_count;
+    header.index_count = index_count;
+    header.bvh_width = Bvh::kWidth;
+
+    const uint64_t positions_size = uint64_t(vertex_count) * sizeof(glm::vec3);
+    const uint64_t indices_size = uint64_t(index_count) * sizeof(uint32_t);
+    header.positions_offset = AlignUp(sizeof(MeshBinaryHeader));
+    header.indices_offset = AlignUp(header.positions_offset + positions_size);
+    uint64_t end = header.indices_offset + indices_size;
+    if (bvh && bvh->IsBuilt()) {
+        header.flags |= kMeshBinaryHasBvh;
+        header.bvh_node_count = bvh->GetNodeCount();
+        header.bvh_block_count = bvh->GetTriangleBlockCount();
+        glm::vec3 lo = bvh->GetBoundsMin();
+        glm::vec3 hi = bvh->GetBoundsMax();
+        for (int axis = 0; axis < 3; ++axis) {
+            header.bvh_bounds_min[axis] = lo[axis];
+            header.bvh_bounds_max[axis] = hi[axis];
+        }
+        header.bvh_nodes_offset = AlignUp(end);
+        header.bvh_blocks_offset = AlignUp(header.bvh_nodes_offset + uint64_t(header.bvh_node_count) * sizeof(Bvh::Node));
+    }
+
+    std::error_code error;
+    std::filesystem::path target(path);
+    if (target.has_parent_path()) {
+        std::filesystem::create_directories(target.parent_path(), error);
+    }
+    std::string temp_path = MakeTempPath(path);
+    FILE* file = std::fopen(temp_path.c_str(), "wb");
+    if (!file) {
+        grassland::LogError("Failed to create mesh cache file: {}", temp_path);
+        return false;
+    }
+    uint64_t position = 0;
+    bool ok = WriteAt(file, &position, 0, &header, sizeof(header)) &&
+              WriteAt(file, &position, header.positions_offset, positions, positions_size) &&
+              WriteAt(file, &position, header.indices_offset, indices, indices_size);
+    if (ok && (header.flags & kMeshBinaryHasBvh)) {
+        ok = WriteAt(file, &position, header.bvh_nodes_offset, bvh->GetNodes(),
+                     uint64_t(header.bvh_node_count) * sizeof(Bvh::Node)) &&
+             WriteAt(file, &position, header.bvh_blocks_offset, bvh->GetTriangleBlocks(),
+                     uint64_t(header.bvh_block_count) * sizeof(Bvh::TriangleBlock));
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (ok) {
+        // Replaces any existing cache atomically; readers see the old or the new file
+        std::filesystem::rename(temp_path, target, error);
+        ok = !error;
+    }
+    if (!ok) {
+        std::filesystem::remove(temp_path, error);
+        grassland::LogError("Failed to write mesh cache file: {}", path);
+    }
+    return ok;
+}
+
+bool OpenMeshBinary(const std::string& path, uint64_t source_size, int64_t source_time,
+                    MappedFile* file, MeshBinaryView* view) {
+    if (!file->Open(path)) {
+        return false;
+    }
+    const size_t file_size = file->GetSize();
+    MeshBinaryHeader header;
+    if (file_size < sizeof(header)) {
+        file->Close();
+        return false;
+    }
+    std::memcpy(&header, file->GetData(), sizeof(header));
+    bool valid = std::memcmp(header.magic, kMeshBinaryMagic, sizeof(header.magic)) == 0 &&
+                 header.version == kMeshBinaryVersion &&
+                 header.source_size == source_size && header.source_time == source_time &&
+                 SectionFits(header.positions_offset, uint64_t(header.vertex_count) * sizeof(glm::vec3), file_size) &&
+                 SectionFits(header.indices_offset, uint64_t(header.index_count) * sizeof(uint32_t), file_size);
+    if (valid && (header.flags & kMeshBinaryHasBvh)) {
+        valid = header.bvh_width == Bvh::kWidth &&
+                SectionFits(header.bvh_nodes_offset, uint64_t(header.bvh_node_count) * sizeof(Bvh::Node), file_size) &&
+                SectionFits(header.bvh_blocks_offset,
+                            uint64_t(header.bvh_block_count) * sizeof(Bvh::TriangleBlock), file_size);
+    }
+    if (!valid) {
+        file->Close();
+        return false;
+    }
+
+    const uint8_t* data = file->GetData();
+    view->positions = reinterpret_cast<const glm::vec3*>(data + header.positions_offset);
+    view->indices = reinterpret_cast<const uint32_t*>(data + header.indices_offset);
+    view->vertex_count = header.vertex_count;
+    view->index_count = header.index_count;
+    view->bvh_nodes = nullptr;
+    view->bvh_blocks = nullptr;
+    view->bvh_node_count = 0;
+    view->bvh_block_count = 0;
+    if (header.flags & kMeshBinaryHasBvh) {
+        view->bvh_nodes = reinterpret_cast<const Bvh::Node*>(data + header.bvh_nodes_offset);
+        view->bvh_blocks = reinterpret_cast<const Bvh::TriangleBlock*>(data + header.bvh_blocks_offset);
+        view->bvh_node_count = header.bvh_node_count;
+        view->bvh_block_count = header.bvh_block_count;
+        view->bvh_bounds_min = glm::vec3(header.bvh_bounds_min[0], header.bvh_bounds_min[1], header.bvh_bounds_min[2]);
+        view->bvh_bounds_max = glm::vec3(header.bvh_bounds_max[0], header.bvh_bounds_max[1], header.bvh_bounds_max[2]);
+    }
+    return true;
+}
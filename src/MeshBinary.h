@@ -0,0 +1,65 @@
+#pragma once
+#include "long_march.h"
+#include "Bvh.h"
+#include "MappedFile.h"
+#include <string>
+
+// Preprocessed mesh file written the first time an OBJ is parsed and
+// memory-mapped on later runs. Layout (native endianness):
+//   MeshBinaryHeader
+//   positions    vertex_count * 3 floats (glm::vec3)
+//   indices      index_count uint32_t
+//   bvh nodes    bvh_node_count Bvh::Node           (kMeshBinaryHasBvh)
+//   bvh blocks   bvh_block_count Bvh::TriangleBlock (kMeshBinaryHasBvh)
+// Each section starts on a kMeshBinaryAlignment boundary. Bump
+// kMeshBinaryVersion whenever the layout, the BVH node format or the BVH
+// depth bound (kBvhMaxDepth) changes.
+constexpr char kMeshBinaryMagic[4] = { 'S', 'M', 'M', 'B' };
+constexpr uint32_t kMeshBinaryVersion = 2;
+constexpr uint32_t kMeshBinaryAlignment = 64;
+constexpr uint32_t kMeshBinaryHasBvh = 1u << 0;
+
+struct MeshBinaryHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t source_size;  // Size and modification time of the OBJ it was
+    int64_t source_time;   // produced from, to detect stale files
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t flags;
+    uint32_t bvh_width;
+    uint32_t bvh_node_count;
+    uint32_t bvh_block_count;
+    float bvh_bounds_min[3];
+    float bvh_bounds_max[3];
+    uint64_t positions_offset;
+    uint64_t indices_offset;
+    uint64_t bvh_nodes_offset;
+    uint64_t bvh_blocks_offset;
+};
+
+// Views into a mapped mesh binary; nothing is copied
+struct MeshBinaryView {
+    const glm::vec3* positions;
+    const uint32_t* indices;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    const Bvh::Node* bvh_nodes;          // nullptr without kMeshBinaryHasBvh
+    const Bvh::TriangleBlock* bvh_blocks;
+    uint32_t bvh_node_count;
+    uint32_t bvh_block_count;
+    glm::vec3 bvh_bounds_min;
+    glm::vec3 bvh_bounds_max;
+};
+
+// Size and modification time of a source file (zeros if it cannot be read)
+void GetSourceStamp(const std::string& path, uint64_t* size, int64_t* time);
+
+// Write atomically (temporary file + rename). bvh may be null or unbuilt.
+bool WriteMeshBinary(const std::string& path, uint64_t source_size, int64_t source_time,
+                     const glm::vec3* positions, uint32_t vertex_count,
+                     const uint32_t* indices, uint32_t index_count, const Bvh* bvh);
+
+// Map a mesh binary and validate it against the source stamp
+bool OpenMeshBinary(const std::string& path, uint64_t source_size, int64_t source_time,
+                    MappedFile* file, MeshBinaryView* view);
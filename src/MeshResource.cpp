@@ -0,0 +1,199 @@
+#include "MeshResource.h"
+#include "MeshBinary.h"
+#include "ThreadPool.h"
+#include <cctype>
+
+MeshResource::MeshResource(const std::string& obj_file_path, const std::string& cache_file_path)
+    : path_(obj_file_path)
+    , cache_path_(cache_file_path)
+    , positions_(nullptr)
+    , indices_(nullptr)
+    , vertex_count_(0)
+    , index_count_(0)
+    , loaded_(false) {
+}
+
+MeshResource::MeshResource(const std::string& name, std::vector<glm::vec3> positions, std::vector<uint32_t> indices)
+    : path_(name)
+    , owned_positions_(std::move(positions))
+    , owned_indices_(std::move(indices))
+    , positions_(owned_positions_.data())
+    , indices_(owned_indices_.data())
+    , vertex_count_(static_cast<uint32_t>(owned_positions_.size()))
+    , index_count_(static_cast<uint32_t>(owned_indices_.size()))
+    , loaded_(true) {
+    ComputeBounds();
+    std::call_once(load_once_, []() {});
+}
+
+MeshResource::~MeshResource() {
+    blas_.reset();
+    index_buffer_.reset();
+    vertex_buffer_.reset();
+}
+
+void MeshResource::Wait() {
+    std::call_once(load_once_, [this]() { Load(); });
+}
+
+void MeshResource::Load() {
+    std::string full_path = grassland::FindAssetFile(path_);
+    uint64_t source_size = 0;
+    int64_t source_time = 0;
+    if (!cache_path_.empty()) {
+        GetSourceStamp(full_path, &source_size, &source_time);
+        if (LoadFromCache(source_size, source_time)) {
+            ComputeBounds();
+            loaded_ = true;
+            return;
+        }
+    }
+
+    if (mesh_.LoadObjFile(full_path) != 0) {
+        grassland::LogError("Failed to load mesh from: {}", path_);
+        return;
+    }
+
+    // Eigen::Vector3f and glm::vec3 share the packed xyz layout
+    positions_ = reinterpret_cast<const glm::vec3*>(mesh_.Positions());
+    indices_ = mesh_.Indices();
+    vertex_count_ = mesh_.NumVertices();
+    index_count_ = mesh_.NumIndices();
+    grassland::LogInfo("Successfully loaded mesh: {} ({} vertices, {} indices)", 
+                       path_, vertex_count_, index_count_);
+    ComputeBounds();
+    loaded_ = true;
+
+    if (!cache_path_.empty()) {
+        // The BVH is stored too, so later runs skip both parsing and building
+        BuildBVHOnce();
+        WriteMeshBinary(cache_path_, source_size, source_time, positions_, vertex_count_, indices_, index_count_,
+                        &bvh_);
+    }
+}
+
+bool MeshResource::LoadFromCache(uint64_t source_size, int64_t source_time) {
+    MeshBinaryView view;
+    if (!OpenMeshBinary(cache_path_, source_size, source_time, &mapped_, &view)) {
+        return false;
+    }
+    positions_ = view.positions;
+    indices_ = view.indices;
+    vertex_count_ = view.vertex_count;
+    index_count_ = view.index_count;
+    if (view.bvh_nodes) {
+        // Mark the BVH as done so BuildBVH never replaces the adopted tree
+        std::call_once(bvh_once_, [&]() {
+            bvh_.Adopt(view.bvh_nodes, view.bvh_node_count, view.bvh_blocks, view.bvh_block_count,
+                       view.bvh_bounds_min, view.bvh_bounds_max);
+        });
+    }
+    grassland::LogInfo("Mapped cached mesh: {} ({} vertices, {} indices)", path_, vertex_count_, index_count_);
+    return true;
+}
+
+void MeshResource::ComputeBounds() {
+    if (vertex_count_ == 0) {
+        return;
+    }
+    bounds_min_ = positions_[0];
+    bounds_max_ = positions_[0];
+    for (uint32_t i = 1; i < vertex_count_; ++i) {
+        bounds_min_ = glm::min(bounds_min_, positions_[i]);
+        bounds_max_ = glm::max(bounds_max_, positions_[i]);
+    }
+}
+
+void MeshResource::BuildBLAS(grassland::graphics::Core* core) {
+    Wait();
+    if (!loaded_ || !core || blas_) {
+        return;
+    }
+
+    // Create vertex buffer
+    size_t vertex_buffer_size = vertex_count_ * sizeof(glm::vec3);
+    core->CreateBuffer(vertex_buffer_size, 
+                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
+                      &vertex_buffer_);
+    vertex_buffer_->UploadData(positions_, vertex_buffer_size);
+
+    // Create index buffer
+    size_t index_buffer_size = index_count_ * sizeof(uint32_t);
+    core->CreateBuffer(index_buffer_size, 
+                      grassland::graphics::BUFFER_TYPE_DYNAMIC, 
+                      &index_buffer_);
+    index_buffer_->UploadData(indices_, index_buffer_size);
+
+    // Build BLAS
+    core->CreateBottomLevelAccelerationStructure(
+        vertex_buffer_.get(), 
+        index_buffer_.get(), 
+        sizeof(glm::vec3), 
+        &blas_);
+
+    grassland::LogInfo("Built BLAS for mesh: {}", path_);
+}
+
+void MeshResource::BuildBVH() {
+    Wait();
+    if (!loaded_) {
+        return;
+    }
+    BuildBVHOnce();
+}
+
+void MeshResource::BuildBVHOnce() {
+    std::call_once(bvh_once_, [this]() {
+        bvh_.Build(positions_, indices_, index_count_ / 3);
+    });
+}
+
+std::shared_ptr<MeshResource> MeshCache::Acquire(const std::string& obj_file_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = meshes_[obj_file_path];
+    std::shared_ptr<MeshResource> mesh = entry.lock();
+    if (!mesh) {
+        mesh = std::make_shared<MeshResource>(obj_file_path, GetCacheFilePath(obj_file_path));
+        entry = mesh;
+        ThreadPool::Global().Submit([mesh]() { mesh->Wait(); });
+    }
+    return mesh;
+}
+
+void MeshCache::SetCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cache_directory_ = directory;
+}
+
+std::string MeshCache::GetCacheFilePath(const std::string& obj_file_path) const {
+    if (cache_directory_.empty()) {
+        return std::string();
+    }
+    // Flatten the asset path into a single file name
+    std::string name = obj_file_path;
+    for (char& c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-') {
+            c = '_';
+        }
+    }
+    return cache_directory_ + "/" + name + ".smmesh";
+}
+
+size_t MeshCache::GetLiveMeshCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t count = 0;
+    for (auto it = meshes_.begin(); it != meshes_.end();) {
+        if (it->second.expired()) {
+            it = meshes_.erase(it);
+        } else {
+            ++count;
+            ++it;
+        }
+    }
+    return count;
+}
+
+MeshCache& MeshCache::Global() {
+    static MeshCache cache;
+    return cache;
+}
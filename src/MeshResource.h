@@ -0,0 +1,101 @@
+#pragma once
+#include "long_march.h"
+#include "Bvh.h"
+#include "MappedFile.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Geometry shared by every entity that references the same OBJ file:
+// the mesh data, its device vertex/index buffers, its BLAS and its CPU BVH.
+// Loading happens asynchronously; geometry getters are only valid after Wait().
+//
+// With a cache file set, the first load parses the OBJ and writes a binary
+// copy (see MeshBinary.h). Later loads map that file and point positions,
+// indices and the BVH straight into the mapping.
+class MeshResource {
+public:
+    MeshResource(const std::string& obj_file_path, const std::string& cache_file_path);
+    // Procedural geometry; already loaded, never cached on disk
+    MeshResource(const std::string& name, std::vector<glm::vec3> positions, std::vector<uint32_t> indices);
+    ~MeshResource();
+
+    // Block until the mesh has been loaded. If no worker has picked the load
+    // up yet it runs on the calling thread, so waiting from a worker is safe.
+    void Wait();
+
+    bool IsValid() { Wait(); return loaded_; }
+    bool IsFromCache() const { return mapped_.IsOpen(); }
+    const std::string& GetPath() const { return path_; }
+
+    const glm::vec3* GetPositions() const { return positions_; }
+    const uint32_t* GetIndices() const { return indices_; }
+    uint32_t GetVertexCount() const { return vertex_count_; }
+    uint32_t GetIndexCount() const { return index_count_; }
+    // Object-space bounds of all vertices
+    const glm::vec3& GetBoundsMin() const { return bounds_min_; }
+    const glm::vec3& GetBoundsMax() const { return bounds_max_; }
+
+    grassland::graphics::Buffer* GetVertexBuffer() const { return vertex_buffer_.get(); }
+    grassland::graphics::Buffer* GetIndexBuffer() const { return index_buffer_.get(); }
+    grassland::graphics::AccelerationStructure* GetBLAS() const { return blas_.get(); }
+    const Bvh& GetBVH() const { return bvh_; }
+
+    // Both builds run once no matter how many entities ask for them
+    void BuildBLAS(grassland::graphics::Core* core);
+    void BuildBVH();
+
+private:
+    void Load();
+    bool LoadFromCache(uint64_t source_size, int64_t source_time);
+    void BuildBVHOnce();
+    void ComputeBounds();
+
+    std::string path_;
+    std::string cache_path_;
+    grassland::Mesh<float> mesh_;
+    std::vector<glm::vec3> owned_positions_;
+    std::vector<uint32_t> owned_indices_;
+    MappedFile mapped_;
+    const glm::vec3* positions_;
+    const uint32_t* indices_;
+    uint32_t vertex_count_;
+    uint32_t index_count_;
+    glm::vec3 bounds_min_{ 0.0f };
+    glm::vec3 bounds_max_{ 0.0f };
+    bool loaded_;
+    std::once_flag load_once_;
+
+    std::unique_ptr<grassland::graphics::Buffer> vertex_buffer_;
+    std::unique_ptr<grassland::graphics::Buffer> index_buffer_;
+    std::unique_ptr<grassland::graphics::AccelerationStructure> blas_;
+
+    Bvh bvh_;
+    std::once_flag bvh_once_;
+};
+
+// Path-keyed cache of MeshResources. Entries are weak so geometry (and its
+// device buffers) is released together with the last entity that uses it.
+class MeshCache {
+public:
+    // Returns the shared resource for a path. A path seen for the first time
+    // is queued for loading on ThreadPool::Global() and returned immediately.
+    std::shared_ptr<MeshResource> Acquire(const std::string& obj_file_path);
+
+    // Directory for preprocessed mesh files ("mesh_cache" by default, relative
+    // to the working directory). An empty string disables the binary cache.
+    void SetCacheDirectory(const std::string& directory);
+
+    // Number of distinct meshes currently alive
+    size_t GetLiveMeshCount();
+
+    static MeshCache& Global();
+
+private:
+    std::string GetCacheFilePath(const std::string& obj_file_path) const;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::weak_ptr<MeshResource>> meshes_;
+    std::string cache_directory_{ "mesh_cache" };
+};
@@ -0,0 +1,208 @@
+#include "PathSampler.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+uint32_t ReverseBits(uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+uint32_t HashUint(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Owen scrambling as a hash over the reversed bits (Burley, "Practical
+// Hash-based Owen Scrambling"): each bit is flipped depending on the bits
+// above it only, so stratification is kept
+uint32_t NestedUniformScramble(uint32_t x, uint32_t seed) {
+    x = ReverseBits(x);
+    x += seed;
+    x ^= x * 0x6C50B47Cu;
+    x ^= x * 0xB82F1E52u;
+    x ^= x * 0xC7AFE638u;
+    x ^= x * 0x8D22F6E6u;
+    return ReverseBits(x);
+}
+
+// First two Sobol dimensions
+uint32_t Sobol(uint32_t index, uint32_t dimension) {
+    if (dimension == 0) {
+        return ReverseBits(index);
+    }
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+        if (index & 1) {
+            result ^= v;
+        }
+    }
+    return result;
+}
+
+float ToUnitFloat(uint32_t x) {
+    return static_cast<float>(x >> 8) * (1.0f / 16777216.0f);
+}
+
+// Dimensions are drawn in pairs from 2D Sobol; every pair gets its own
+// index shuffle and scramble, which decorrelates the pairs ("padding")
+float SobolOwen(uint32_t index, uint32_t dimension, uint32_t seed) {
+    uint32_t pair_seed = HashUint(seed ^ HashUint(dimension >> 1));
+    uint32_t shuffled = NestedUniformScramble(index, pair_seed);
+    uint32_t value = Sobol(shuffled, dimension & 1);
+    return ToUnitFloat(NestedUniformScramble(value, HashUint(pair_seed + (dimension & 1) + 1)));
+}
+
+std::vector<float> GenerateBlueNoise() {
+    // Void and cluster (Ulichney 1993) on a torus with a Gaussian of sigma 1.9
+    const int size = PathSampler::kBlueNoiseSize;
+    const int count = size * size;
+    std::vector<float> kernel(count);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int dx = std::min(x, size - x);
+            int dy = std::min(y, size - y);
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.9f * 1.9f));
+        }
+    }
+    std::vector<float> energy(count, 0.0f);
+    std::vector<uint8_t> pattern(count, 0);
+    auto splat = [&](int index, float sign) {
+        int px = index % size;
+        int py = index / size;
+        for (int y = 0; y < size; ++y) {
+            const float* row = &kernel[((y - py + size) % size) * size];
+            for (int x = 0; x < size; ++x) {
+                energy[y * size + x] += sign * row[(x - px + size) % size];
+            }
+        }
+    };
+    auto tightest_cluster = [&]() {
+        int best = -1;
+        for (int i = 0; i < count; ++i) {
+            if (pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+        }
+        return best;
+    };
+    auto largest_void = [&]() {
+        int best = -1;
+        for (int i = 0; i < count; ++i) {
+            if (!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+        }
+        return best;
+    };
+
+    // Initial pattern: a tenth of the pixels, relaxed until moving the
+    // tightest cluster into the largest void changes nothing
+    std::mt19937 rng(20240611);
+    const int initial_count = count / 10;
+    for (int placed = 0; placed < initial_count;) {
+        int index = static_cast<int>(rng() % count);
+        if (!pattern[index]) {
+            pattern[index] = 1;
+            splat(index, 1.0f);
+            ++placed;
+        }
+    }
+    for (int iteration = 0; iteration < count; ++iteration) {
+        int cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        int hole = largest_void();
+        pattern[hole] = 1;
+        splat(hole, 1.0f);
+        if (hole == cluster) break;
+    }
+    std::vector<uint8_t> initial_pattern = pattern;
+    std::vector<float> initial_energy = energy;
+
+    std::vector<int> rank(count, 0);
+    // Phase 1: ranks below the initial count, removing clusters
+    for (int r = initial_count - 1; r >= 0; --r) {
+        int cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        splat(cluster, -1.0f);
+        rank[cluster] = r;
+    }
+    // Phases 2 and 3: filling voids up to the full grid. Past half the
+    // grid this equals Ulichney's inverted clusters, since the energy of
+    // the zeros is the kernel sum minus the energy of the ones.
+    pattern = initial_pattern;
+    energy = initial_energy;
+    for (int r = initial_count; r < count; ++r) {
+        int hole = largest_void();
+        pattern[hole] = 1;
+        splat(hole, 1.0f);
+        rank[hole] = r;
+    }
+
+    std::vector<float> mask(count);
+    for (int i = 0; i < count; ++i) {
+        mask[i] = (rank[i] + 0.5f) / count;
+    }
+    return mask;
+}
+
+} // namespace
+
+uint32_t RandomSeed(uint32_t x, uint32_t y, uint32_t depth, uint32_t frame) {
+    return (x * 73856093u) ^ (y * 19349663u) ^ (depth * 83492789u) ^ (frame * 735682483u);
+}
+
+float Random(uint32_t& seed) {
+    seed = seed * 747796405u + 2891336453u;
+    uint32_t result = ((seed >> ((seed >> 28u) + 4u)) ^ seed) * 277803737u;
+    result = (result >> 22u) ^ result;
+    return float(result) / 4294967295.0f;
+}
+
+PathSampler::PathSampler(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index, uint32_t depth,
+                         uint32_t first_dimension)
+    : type_(type)
+    , x_(x)
+    , y_(y)
+    , index_(sample_index)
+    , first_dimension_(first_dimension)
+    , seed_(RandomSeed(x, y, depth, sample_index)) {
+}
+
+PathSampler PathSampler::ForCamera(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index) {
+    return PathSampler(type, x, y, sample_index, 0, 0);
+}
+
+PathSampler PathSampler::ForBounce(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index, uint32_t depth) {
+    return PathSampler(type, x, y, sample_index, depth,
+                       kPixelDimensions + std::min(depth, kMaxDepth) * kDimensionsPerBounce);
+}
+
+float PathSampler::Get(uint32_t offset) {
+    if (type_ == SamplerType::kRandom) {
+        return Random(seed_);
+    }
+    uint32_t dimension = first_dimension_ + offset;
+    if (type_ == SamplerType::kSobol) {
+        return SobolOwen(index_, dimension, HashUint((x_ * 73856093u) ^ (y_ * 19349663u)));
+    }
+    // One sequence for all pixels, decorrelated by a toroidal shift taken
+    // from the mask at a per-dimension offset
+    float u = SobolOwen(index_, dimension, 0);
+    uint32_t offset_hash = HashUint(dimension + 1);
+    uint32_t mask_x = (x_ + offset_hash) % kBlueNoiseSize;
+    uint32_t mask_y = (y_ + (offset_hash >> 8)) % kBlueNoiseSize;
+    u += GetBlueNoiseMask()[mask_y * kBlueNoiseSize + mask_x];
+    return u >= 1.0f ? u - 1.0f : u;
+}
+
+const std::vector<float>& PathSampler::GetBlueNoiseMask() {
+    static const std::vector<float> mask = GenerateBlueNoise();
+    return mask;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Source of the random numbers a path consumes
+enum class SamplerType : uint32_t {
+    kRandom = 0,    // PCG hash reseeded per pixel, depth and sample (white noise)
+    kSobol = 1,     // Owen-scrambled Sobol, scrambled per pixel
+    kBlueNoise = 2, // Owen-scrambled Sobol shared by all pixels, shifted per pixel by a blue-noise mask
+};
+
+// Random numbers for one ray of a path, same as PathSampler in shaders/shader.hlsl.
+// Every decision reads its own dimension, so the low-discrepancy samplers
+// stratify each of them over the pixel's samples: the camera ray owns
+// kPixelDimensions, and each path depth a block of kDimensionsPerBounce
+// laid out by the offsets below. kRandom ignores the dimension and returns
+// the next number of the PCG sequence, exactly as the renderers did before.
+class PathSampler {
+public:
+    static constexpr uint32_t kPixelDimensions = 2;
+    static constexpr uint32_t kDimensionsPerBounce = 10;
+    static constexpr uint32_t kMaxDepth = 7;
+
+    // Offsets within a bounce's block
+    static constexpr uint32_t kLightSelect = 0;
+    static constexpr uint32_t kLightPosition = 1; // 2 dimensions
+    static constexpr uint32_t kEnvironment = 3;   // 2 dimensions
+    static constexpr uint32_t kRussianRoulette = 5;
+    static constexpr uint32_t kLobe = 6;
+    static constexpr uint32_t kSssDistance = 7;
+    static constexpr uint32_t kScatter = 8; // 2 dimensions
+
+    static constexpr int kBlueNoiseSize = 64;
+
+    // Sampler for the camera ray of sample sample_index of pixel (x, y)
+    static PathSampler ForCamera(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index);
+    // Sampler for the shading at a hit of the given path depth
+    static PathSampler ForBounce(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index, uint32_t depth);
+
+    // Number in [0, 1) for dimension offset within this ray's block
+    float Get(uint32_t offset);
+
+    // Tileable kBlueNoiseSize^2 void-and-cluster mask with values in [0, 1),
+    // generated on first use. The GPU renderer uploads the same mask.
+    static const std::vector<float>& GetBlueNoiseMask();
+
+private:
+    PathSampler(SamplerType type, uint32_t x, uint32_t y, uint32_t sample_index, uint32_t depth,
+                uint32_t first_dimension);
+
+    SamplerType type_;
+    uint32_t x_;
+    uint32_t y_;
+    uint32_t index_;
+    uint32_t first_dimension_;
+    uint32_t seed_; // PCG state for kRandom
+};
+
+// The renderers' original white-noise generator
+uint32_t RandomSeed(uint32_t x, uint32_t y, uint32_t depth, uint32_t frame);
+float Random(uint32_t& seed);
@@ -0,0 +1,60 @@
+#include "RayStats.h"
+#include <sstream>
+
+void RayStats::AddSlot(const uint32_t* slot) {
+    for (int i = 0; i < kCounterCount; ++i) {
+        counters[i] += slot[i];
+    }
+    for (int i = 0; i < kDepthBins; ++i) {
+        depth_histogram[i] += slot[kCounterCount + i];
+    }
+    samples++;
+}
+
+void RayStats::Add(const RayStats& other) {
+    for (int i = 0; i < kCounterCount; ++i) {
+        counters[i] += other.counters[i];
+    }
+    for (int i = 0; i < kDepthBins; ++i) {
+        depth_histogram[i] += other.depth_histogram[i];
+    }
+    samples += other.samples;
+}
+
+uint64_t RayStats::GetRayCount() const {
+    uint64_t rays = 0;
+    for (int i = 0; i < kCounterCount; ++i) {
+        if (i != kRussianRoulette) {
+            rays += counters[i];
+        }
+    }
+    return rays;
+}
+
+const char* RayStats::GetCounterName(int counter) {
+    static const char* kNames[kCounterCount] = { "primary", "shadow", "reflection", "refraction",
+                                                 "scatter", "test", "russian_roulette" };
+    return counter >= 0 && counter < kCounterCount ? kNames[counter] : "unknown";
+}
+
+std::string RayStats::ToJson(double pixel_samples) const {
+    double scale = pixel_samples > 0.0 ? 1.0 / pixel_samples : 0.0;
+    std::ostringstream json;
+    json << "{\n    \"samples\": " << samples << ",\n    \"pixel_samples\": " << static_cast<uint64_t>(pixel_samples) << ",\n";
+    json << "    \"rays\": " << GetRayCount() << ",\n";
+    json << "    \"rays_per_pixel_sample\": " << GetRayCount() * scale << ",\n";
+    json << "    \"counters\": {";
+    for (int i = 0; i < kCounterCount; ++i) {
+        json << (i ? ", " : " ") << "\"" << GetCounterName(i) << "\": " << counters[i];
+    }
+    json << " },\n    \"per_pixel_sample\": {";
+    for (int i = 0; i < kCounterCount; ++i) {
+        json << (i ? ", " : " ") << "\"" << GetCounterName(i) << "\": " << counters[i] * scale;
+    }
+    json << " },\n    \"depth_histogram\": [";
+    for (int i = 0; i < kDepthBins; ++i) {
+        json << (i ? ", " : "") << depth_histogram[i];
+    }
+    json << "]\n}\n";
+    return json.str();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Ray statistics gathered by the ray tracing shaders (CountStat in
+// shaders/shader.hlsl). The device writes one slot of kSlotSize 32-bit
+// counters per sample; RayStats adds such slots up on the host.
+struct RayStats {
+    enum Counter {
+        kPrimary,
+        kShadow,
+        kReflection,
+        kRefraction,
+        kScatter,
+        kTest,            // subsurface distance probes
+        kRussianRoulette, // paths ended by Russian roulette, not a ray
+        kCounterCount
+    };
+    static constexpr int kDepthBins = 8; // shaded hits per path depth; the last bin collects deeper hits
+    static constexpr int kSlotSize = 16; // device counters per sample
+    static_assert(kCounterCount + kDepthBins <= kSlotSize, "device slot too small");
+
+    uint64_t counters[kCounterCount] = {};
+    uint64_t depth_histogram[kDepthBins] = {};
+    uint64_t samples = 0;
+
+    // Add one device slot (kSlotSize counters) as one sample
+    void AddSlot(const uint32_t* slot);
+    void Add(const RayStats& other);
+    void Clear() { *this = RayStats{}; }
+
+    // All traced rays (every counter except Russian roulette terminations)
+    uint64_t GetRayCount() const;
+
+    static const char* GetCounterName(int counter);
+
+    // JSON object with the totals and per pixel sample averages, for tools.
+    // pixel_samples is the number of pixel samples traced, which adaptive
+    // sampling makes smaller than pixels times samples
+    std::string ToJson(double pixel_samples) const;
+};
@@ -1,4 +1,12 @@
 #include "Scene.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
 
 Scene::Scene(grassland::graphics::Core* core)
     : core_(core) {
@@ -9,89 +17,283 @@ Scene::~Scene() {
 }
 
 void Scene::AddEntity(std::shared_ptr<Entity> entity) {
-    if (!entity || !entity->IsValid()) {
+    if (!entity) {
         grassland::LogError("Cannot add invalid entity to scene");
         return;
     }
 
-    // Build BLAS for the entity
-    entity->BuildBLAS(core_);
-    
     entities_.push_back(entity);
     grassland::LogInfo("Added entity to scene (total: {})", entities_.size());
 }
 
 void Scene::Clear() {
     entities_.clear();
+    cpu_instances_.clear();
+    cpu_bounds_min_.clear();
+    cpu_bounds_max_.clear();
+    cpu_tlas_ = InstanceBvh();
+    instances_.clear();
+    instance_slots_.clear();
+    animated_entities_.clear();
+    dirty_entities_.clear();
     tlas_.reset();
     materials_buffer_.reset();
 }
 
+void Scene::WaitForMeshes() {
+    auto start = std::chrono::steady_clock::now();
+    size_t before = entities_.size();
+    entities_.erase(std::remove_if(entities_.begin(), entities_.end(), [](const std::shared_ptr<Entity>& entity) {
+        if (entity->IsValid()) {
+            return false;
+        }
+        grassland::LogError("Cannot add invalid entity to scene");
+        return true;
+    }), entities_.end());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    grassland::LogInfo("Waited {:.3f} s for mesh loading ({} of {} entities valid)", seconds, entities_.size(), before);
+
+    // Entity indices are final from here on
+    animated_entities_.clear();
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        if (entities_[i]->IsAnimated()) {
+            animated_entities_.push_back(static_cast<uint32_t>(i));
+        }
+    }
+}
+
+grassland::graphics::RayTracingInstance Scene::MakeInstance(size_t index) const {
+    const auto& entity = entities_[index];
+    // instanceCustomIndex is used to index into materials buffer
+    // Convert mat4 to mat4x3 (drop the last row which is always [0,0,0,1] for affine transforms)
+    glm::mat4x3 transform_3x4 = glm::mat4x3(entity->GetTransform());
+    return entity->GetBLAS()->MakeInstance(
+        transform_3x4,
+        static_cast<uint32_t>(index),  // instanceCustomIndex for material lookup
+        0xFF,                           // instanceMask
+        0,                              // instanceShaderBindingTableRecordOffset
+        grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
+    );
+}
+
 void Scene::BuildAccelerationStructures() {
+    WaitForMeshes();
     if (entities_.empty()) {
         grassland::LogWarning("No entities to build acceleration structures");
         return;
     }
+    if (!core_) {
+        return;
+    }
 
-    // Create TLAS instances from all entities
-    std::vector<grassland::graphics::RayTracingInstance> instances;
-    instances.reserve(entities_.size());
+    // Build BLAS for each entity; entities sharing a mesh share its BLAS
+    for (auto& entity : entities_) {
+        entity->BuildBLAS(core_);
+    }
 
+    // Create TLAS instances from all entities; kept for incremental updates
+    instances_.clear();
+    instances_.reserve(entities_.size());
+    instance_slots_.assign(entities_.size(), -1);
     for (size_t i = 0; i < entities_.size(); ++i) {
-        auto& entity = entities_[i];
-        if (entity->GetBLAS()) {
-            // Create instance with entity's transform
-            // instanceCustomIndex is used to index into materials buffer
-            // Convert mat4 to mat4x3 (drop the last row which is always [0,0,0,1] for affine transforms)
-            glm::mat4x3 transform_3x4 = glm::mat4x3(entity->GetTransform());
-            
-            auto instance = entity->GetBLAS()->MakeInstance(
-                transform_3x4,
-                static_cast<uint32_t>(i),  // instanceCustomIndex for material lookup
-                0xFF,                       // instanceMask
-                0,                          // instanceShaderBindingTableRecordOffset
-                grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
-            );
-            instances.push_back(instance);
+        if (entities_[i]->GetBLAS()) {
+            instance_slots_[i] = static_cast<int32_t>(instances_.size());
+            instances_.push_back(MakeInstance(i));
         }
     }
 
     // Build TLAS
-    core_->CreateTopLevelAccelerationStructure(instances, &tlas_);
-    grassland::LogInfo("Built TLAS with {} instances", instances.size());
+    core_->CreateTopLevelAccelerationStructure(instances_, &tlas_);
+    std::unordered_set<const MeshResource*> meshes;
+    for (const auto& entity : entities_) {
+        meshes.insert(entity->GetMesh().get());
+    }
+    grassland::LogInfo("Built TLAS with {} instances over {} shared BLAS ({} animated)", instances_.size(),
+                       meshes.size(), animated_entities_.size());
+
+    // The TLAS starts from the current transforms
+    for (auto& entity : entities_) {
+        entity->ClearTransformDirty();
+    }
+    dirty_entities_.clear();
 
     // Update materials buffer
     UpdateMaterialsBuffer();
 }
 
-void Scene::UpdateInstances() {
-    if (!tlas_ || entities_.empty()) {
-        return;
+void Scene::UpdateAnimation() {
+    for (uint32_t index : animated_entities_) {
+        Entity& entity = *entities_[index];
+        bool was_dirty = entity.IsTransformDirty();
+        entity.UpdateAnimation();
+        if (!was_dirty && entity.IsTransformDirty()) {
+            dirty_entities_.push_back(index);
+        }
     }
+}
 
-    // Recreate instances with updated transforms
-    std::vector<grassland::graphics::RayTracingInstance> instances;
-    instances.reserve(entities_.size());
+void Scene::SetEntityTransform(size_t index, const glm::mat4& transform) {
+    Entity& entity = *entities_[index];
+    bool was_dirty = entity.IsTransformDirty();
+    entity.SetTransform(transform);
+    if (!was_dirty) {
+        dirty_entities_.push_back(static_cast<uint32_t>(index));
+    }
+}
+
+bool Scene::UpdateInstances() {
+    if (dirty_entities_.empty()) {
+        return false;
+    }
+
+    for (uint32_t index : dirty_entities_) {
+        if (index < instance_slots_.size() && instance_slots_[index] >= 0) {
+            instances_[instance_slots_[index]] = MakeInstance(index);
+        }
+        if (cpu_tlas_.IsBuilt()) {
+            UpdateCpuInstance(index);
+        }
+        entities_[index]->ClearTransformDirty();
+    }
+    dirty_entities_.clear();
+
+    if (cpu_tlas_.IsBuilt()) {
+        cpu_tlas_.Refit(cpu_bounds_min_, cpu_bounds_max_);
+    }
+    if (tlas_) {
+        tlas_->UpdateInstances(instances_);
+    }
+    return true;
+}
+
+void Scene::BuildCpuAccelerationStructures() {
+    WaitForMeshes();
+    // One BVH per distinct mesh, however many entities instance it
+    std::vector<MeshResource*> meshes;
+    std::unordered_set<MeshResource*> seen;
+    for (const auto& entity : entities_) {
+        MeshResource* mesh = entity->GetMesh().get();
+        if (seen.insert(mesh).second) {
+            meshes.push_back(mesh);
+        }
+    }
+    ThreadPool::Global().ParallelFor(meshes.size(), [&meshes](size_t i) {
+        meshes[i]->BuildBVH();
+    });
+    UpdateCpuInstances();
+    grassland::LogInfo("Built CPU BVHs for {} meshes shared by {} entities", meshes.size(), entities_.size());
+}
 
+void Scene::UpdateCpuInstances() {
+    cpu_instances_.resize(entities_.size());
+    cpu_bounds_min_.resize(entities_.size());
+    cpu_bounds_max_.resize(entities_.size());
     for (size_t i = 0; i < entities_.size(); ++i) {
-        auto& entity = entities_[i];
-        if (entity->GetBLAS()) {
-            // Convert mat4 to mat4x3
-            glm::mat4x3 transform_3x4 = glm::mat4x3(entity->GetTransform());
-            
-            auto instance = entity->GetBLAS()->MakeInstance(
-                transform_3x4,
-                static_cast<uint32_t>(i),
-                0xFF,
-                0,
-                grassland::graphics::RAYTRACING_INSTANCE_FLAG_NONE
-            );
-            instances.push_back(instance);
+        UpdateCpuInstance(i);
+    }
+    cpu_tlas_.Build(cpu_bounds_min_, cpu_bounds_max_);
+}
+
+void Scene::UpdateCpuInstance(size_t index) {
+    const Entity& entity = *entities_[index];
+    const glm::mat4& transform = entity.GetTransform();
+    CpuInstance& instance = cpu_instances_[index];
+    instance.bvh = &entity.GetBVH();
+    instance.world_to_object = glm::inverse(transform);
+
+    // World bounds from the eight corners of the object-space BVH root
+    glm::vec3 lo = instance.bvh->GetBoundsMin();
+    glm::vec3 hi = instance.bvh->GetBoundsMax();
+    glm::vec3& bounds_min = cpu_bounds_min_[index];
+    glm::vec3& bounds_max = cpu_bounds_max_[index];
+    bounds_min = glm::vec3(std::numeric_limits<float>::max());
+    bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 p((corner & 1) ? hi.x : lo.x, (corner & 2) ? hi.y : lo.y, (corner & 4) ? hi.z : lo.z);
+        glm::vec3 world = glm::vec3(transform * glm::vec4(p, 1.0f));
+        bounds_min = glm::min(bounds_min, world);
+        bounds_max = glm::max(bounds_max, world);
+    }
+}
+
+bool Scene::IntersectCpu(const Ray& ray, uint32_t* instance_id, uint32_t* primitive_index, float* t) const {
+    float closest = ray.tmax;
+    bool found = false;
+    cpu_tlas_.Traverse(ray, &closest, [&](uint32_t i) {
+        const CpuInstance& instance = cpu_instances_[i];
+        // Affine transform keeps the ray parameter t identical in both spaces
+        Ray local = ray;
+        local.origin = glm::vec3(instance.world_to_object * glm::vec4(ray.origin, 1.0f));
+        local.direction = glm::vec3(instance.world_to_object * glm::vec4(ray.direction, 0.0f));
+        local.tmax = closest;
+        TriangleHit hit;
+        if (instance.bvh->Intersect(local, &hit)) {
+            closest = hit.t;
+            *instance_id = i;
+            *primitive_index = hit.primitive_index;
+            found = true;
         }
+    });
+    *t = closest;
+    return found;
+}
+
+int Scene::PickEntity(const CameraObject& camera, int x, int y, int width, int height) const {
+    glm::vec2 uv((x + 0.5f) / width, (y + 0.5f) / height);
+    uv.y = 1.0f - uv.y;
+    glm::vec2 d = uv * 2.0f - glm::vec2(1.0f, 1.0f);
+    glm::vec4 origin = camera.camera_to_world * glm::vec4(0, 0, 0, 1);
+    glm::vec4 target = camera.screen_to_camera * glm::vec4(d.x, d.y, 1, 1);
+    glm::vec4 direction = camera.camera_to_world * glm::vec4(target.x, target.y, target.z, 0);
+
+    Ray ray;
+    ray.origin = glm::vec3(origin);
+    ray.direction = glm::normalize(glm::vec3(direction));
+    ray.tmin = 0.001f;
+    ray.tmax = 10000.0f;
+    uint32_t instance_id, primitive_index;
+    float t;
+    if (!IntersectCpu(ray, &instance_id, &primitive_index, &t)) {
+        return -1;
     }
+    return static_cast<int>(instance_id);
+}
 
-    // Update TLAS
-    tlas_->UpdateInstances(instances);
+bool Scene::GetEntityScreenRect(size_t index, const CameraObject& camera, int width, int height,
+                                ScreenRect* rect) const {
+    if (index >= entities_.size()) {
+        return false;
+    }
+    const Entity& entity = *entities_[index];
+    glm::vec3 lo = entity.GetMesh()->GetBoundsMin();
+    glm::vec3 hi = entity.GetMesh()->GetBoundsMax();
+    glm::mat4 object_to_clip =
+        glm::inverse(camera.screen_to_camera) * glm::inverse(camera.camera_to_world) * entity.GetTransform();
+
+    glm::vec2 ndc_min(std::numeric_limits<float>::max());
+    glm::vec2 ndc_max(-std::numeric_limits<float>::max());
+    for (int corner = 0; corner < 8; ++corner) {
+        glm::vec3 p((corner & 1) ? hi.x : lo.x, (corner & 2) ? hi.y : lo.y, (corner & 4) ? hi.z : lo.z);
+        glm::vec4 clip = object_to_clip * glm::vec4(p, 1.0f);
+        if (clip.w <= 1e-6f) {
+            // Straddles the camera plane: the projection is unbounded
+            *rect = { 0, 0, width, height };
+            return true;
+        }
+        glm::vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+        ndc_min = glm::min(ndc_min, ndc);
+        ndc_max = glm::max(ndc_max, ndc);
+    }
+
+    // Inverse of the uv -> d mapping in RayGenMain (y points down in pixels),
+    // widened by a pixel for the sample jitter
+    ndc_min = glm::clamp(ndc_min, -2.0f, 2.0f);
+    ndc_max = glm::clamp(ndc_max, -2.0f, 2.0f);
+    rect->x0 = std::max(0, static_cast<int>(std::floor((ndc_min.x + 1.0f) * 0.5f * width)) - 1);
+    rect->x1 = std::min(width, static_cast<int>(std::ceil((ndc_max.x + 1.0f) * 0.5f * width)) + 1);
+    rect->y0 = std::max(0, static_cast<int>(std::floor((1.0f - ndc_max.y) * 0.5f * height)) - 1);
+    rect->y1 = std::min(height, static_cast<int>(std::ceil((1.0f - ndc_min.y) * 0.5f * height)) + 1);
+    return rect->x0 < rect->x1 && rect->y0 < rect->y1;
 }
 
 void Scene::UpdateMaterialsBuffer() {
@@ -120,33 +322,95 @@ void Scene::UpdateMaterialsBuffer() {
     grassland::LogInfo("Updated materials buffer with {} materials", materials.size());
 }
 
-void Scene::BuildVertexIndexData() {
-    if (entities_.empty()) return;
-    std::vector<float> all_vertices;
-    std::vector<uint32_t> all_indices;
-    entity_offsets_.clear();
-    uint32_t vertex_offset = 0;
-    uint32_t index_offset = 0;
-    for (const auto& entity : entities_) {
-        std::vector<float> positions = entity->GetMeshPositionsAsFloatArray();
-        const uint32_t* indices = entity->GetMeshIndices();
-        uint32_t vertex_count = entity->GetVertexCount();
-        uint32_t index_count = entity->GetIndexCount();
-        EntityOffset offset;
-        offset.vertex_offset = vertex_offset;
-        offset.index_offset = index_offset;
-        offset.vertex_count = vertex_count;
-        offset.index_count = index_count;
-        entity_offsets_.push_back(offset);
-        all_vertices.insert(all_vertices.end(), positions.begin(), positions.end());
-        for (uint32_t i = 0; i < index_count; i++) {
-            all_indices.push_back(indices[i] + vertex_offset);
+void Scene::FlattenGeometry(FlattenedGeometry* geometry) const {
+    // Pass 1: one range per distinct mesh
+    struct MeshRange {
+        const MeshResource* mesh;
+        uint64_t vertex_offset;
+        uint64_t index_offset;
+    };
+    std::vector<MeshRange> ranges;
+    std::unordered_map<const MeshResource*, size_t> range_of_mesh;
+    geometry->entity_offsets.resize(entities_.size());
+    uint64_t vertex_total = 0;
+    uint64_t index_total = 0;
+    for (size_t i = 0; i < entities_.size(); ++i) {
+        const MeshResource* mesh = entities_[i]->GetMesh().get();
+        auto inserted = range_of_mesh.emplace(mesh, ranges.size());
+        if (inserted.second) {
+            ranges.push_back({ mesh, vertex_total, index_total });
+            vertex_total += mesh->GetVertexCount();
+            index_total += mesh->GetIndexCount();
         }
-        vertex_offset += vertex_count;
-        index_offset += index_count;
+        const MeshRange& range = ranges[inserted.first->second];
+        EntityOffset& offset = geometry->entity_offsets[i];
+        offset.vertex_offset = static_cast<uint32_t>(range.vertex_offset);
+        offset.index_offset = static_cast<uint32_t>(range.index_offset);
+        offset.vertex_count = mesh->GetVertexCount();
+        offset.index_count = mesh->GetIndexCount();
     }
-    size_t vertex_buffer_size = all_vertices.size() * sizeof(float);
-    size_t index_buffer_size = all_indices.size() * sizeof(uint32_t);
+    if (vertex_total > std::numeric_limits<uint32_t>::max() || index_total > std::numeric_limits<uint32_t>::max()) {
+        grassland::LogError("Scene geometry exceeds 32-bit vertex/index addressing");
+        geometry->entity_offsets.clear();
+        return;
+    }
+
+    // Uninitialized on purpose: every element is written in pass 2
+    geometry->vertices.reset(new float[vertex_total * 3]);
+    geometry->indices.reset(new uint32_t[index_total]);
+    geometry->vertex_count = vertex_total;
+    geometry->index_count = index_total;
+    geometry->mesh_count = ranges.size();
+
+    // Pass 2: fixed-size chunks so one huge mesh still spreads over all threads
+    const uint32_t kChunkSize = 1 << 16;
+    struct Chunk {
+        uint32_t range;
+        uint32_t begin;
+        uint32_t end;
+        bool indices;
+    };
+    std::vector<Chunk> chunks;
+    for (uint32_t r = 0; r < ranges.size(); ++r) {
+        uint32_t vertex_count = ranges[r].mesh->GetVertexCount();
+        uint32_t index_count = ranges[r].mesh->GetIndexCount();
+        for (uint32_t begin = 0; begin < vertex_count; begin += kChunkSize) {
+            chunks.push_back({ r, begin, std::min(vertex_count, begin + kChunkSize), false });
+        }
+        for (uint32_t begin = 0; begin < index_count; begin += kChunkSize) {
+            chunks.push_back({ r, begin, std::min(index_count, begin + kChunkSize), true });
+        }
+    }
+    float* vertices = geometry->vertices.get();
+    uint32_t* indices = geometry->indices.get();
+    ThreadPool::Global().ParallelFor(chunks.size(), [&](size_t c) {
+        const Chunk& chunk = chunks[c];
+        const MeshRange& range = ranges[chunk.range];
+        if (chunk.indices) {
+            const uint32_t* source = range.mesh->GetIndices();
+            uint32_t* target = indices + range.index_offset;
+            const uint32_t base = static_cast<uint32_t>(range.vertex_offset);
+            for (uint32_t i = chunk.begin; i < chunk.end; ++i) {
+                target[i] = source[i] + base;
+            }
+        } else {
+            std::memcpy(vertices + (range.vertex_offset + chunk.begin) * 3, range.mesh->GetPositions() + chunk.begin,
+                        (chunk.end - chunk.begin) * sizeof(glm::vec3));
+        }
+    });
+}
+
+void Scene::BuildVertexIndexData() {
+    if (entities_.empty() || !core_) return;
+    auto start = std::chrono::steady_clock::now();
+    FlattenedGeometry geometry;
+    FlattenGeometry(&geometry);
+    if (geometry.entity_offsets.empty()) return;
+    double flatten_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    entity_offsets_ = std::move(geometry.entity_offsets);
+
+    size_t vertex_buffer_size = geometry.vertex_count * 3 * sizeof(float);
+    size_t index_buffer_size = geometry.index_count * sizeof(uint32_t);
     size_t offset_buffer_size = entity_offsets_.size() * sizeof(EntityOffset);
     core_->CreateBuffer(vertex_buffer_size, 
                        grassland::graphics::BUFFER_TYPE_DYNAMIC,
@@ -157,11 +421,12 @@ void Scene::BuildVertexIndexData() {
     core_->CreateBuffer(offset_buffer_size,
                        grassland::graphics::BUFFER_TYPE_DYNAMIC,
                        &entity_offset_buffer_);
-    vertex_data_buffer_->UploadData(all_vertices.data(), vertex_buffer_size);
-    index_data_buffer_->UploadData(all_indices.data(), index_buffer_size);
+    vertex_data_buffer_->UploadData(geometry.vertices.get(), vertex_buffer_size);
+    index_data_buffer_->UploadData(geometry.indices.get(), index_buffer_size);
     entity_offset_buffer_->UploadData(entity_offsets_.data(), offset_buffer_size);
     
-    grassland::LogInfo("Built vertex/index buffers: {} vertices ({} floats), {} indices across {} entities",
-                      all_vertices.size() / 3, all_vertices.size(), 
-                      all_indices.size(), entities_.size());
-}
\ No newline at end of file
+    grassland::LogInfo("Built vertex/index buffers: {} vertices, {} indices for {} meshes across {} entities "
+                      "(flatten {:.3f} s)",
+                      geometry.vertex_count, geometry.index_count, geometry.mesh_count, entities_.size(),
+                      flatten_seconds);
+}
@@ -2,26 +2,61 @@
 #include "long_march.h"
 #include "Entity.h"
 #include "Material.h"
+#include "Camera.h"
 #include <vector>
 #include <memory>
 
 // Scene manages a collection of entities and builds the TLAS
+// A null core gives a headless scene that only feeds the CPU renderer
 class Scene {
 public:
     Scene(grassland::graphics::Core* core);
     ~Scene();
 
-    // Add an entity to the scene
+    // Add an entity to the scene. Its mesh may still be loading; it is
+    // awaited (and dropped if it failed) by BuildAccelerationStructures.
     void AddEntity(std::shared_ptr<Entity> entity);
 
     // Remove all entities
     void Clear();
 
-    // Build/rebuild the TLAS from all entities
+    // Wait for pending mesh loads, then build the BLAS of each distinct mesh
+    // and the TLAS from all entities
     void BuildAccelerationStructures();
 
-    // Update TLAS instances (e.g., for animation)
-    void UpdateInstances();
+    // Advance entities that have a velocity; the ones that moved are queued for UpdateInstances
+    void UpdateAnimation();
+
+    // Move an entity that is already in the scene
+    void SetEntityTransform(size_t index, const glm::mat4& transform);
+
+    // Rewrite only the instances whose entity moved since the last call.
+    // Returns false, without touching the TLAS, when nothing moved.
+    bool UpdateInstances();
+
+    // Build the per-mesh CPU BVHs (in parallel) and the CPU TLAS over them
+    void BuildCpuAccelerationStructures();
+
+    // Closest hit against the CPU TLAS; instance_id indexes GetEntities() like
+    // InstanceIndex() does on the GPU. Returns false on miss.
+    bool IntersectCpu(const Ray& ray, uint32_t* instance_id, uint32_t* primitive_index, float* t) const;
+
+    bool HasCpuAccelerationStructures() const { return cpu_tlas_.IsBuilt(); }
+
+    // Entity under the center of pixel (x, y) of a width x height view, cast
+    // through the CPU TLAS the same way RayGenMain builds its primary ray.
+    // Returns -1 on miss.
+    int PickEntity(const CameraObject& camera, int x, int y, int width, int height) const;
+
+    // Pixels [x0, x1) x [y0, y1)
+    struct ScreenRect {
+        int x0, y0, x1, y1;
+    };
+
+    // Rectangle covering the projected bounds of an entity in a width x height
+    // view; the whole view when the bounds reach behind the camera. Returns
+    // false when the entity is entirely off screen.
+    bool GetEntityScreenRect(size_t index, const CameraObject& camera, int width, int height, ScreenRect* rect) const;
 
     // Get the TLAS for rendering
     grassland::graphics::AccelerationStructure* GetTLAS() const { return tlas_.get(); }
@@ -41,21 +76,57 @@ public:
     
     void BuildVertexIndexData();
 
-private:
-    void UpdateMaterialsBuffer();
-    
+    // Matches EntityOffset in shader.hlsl
     struct EntityOffset {
         uint32_t vertex_offset;
         uint32_t index_offset;
         uint32_t vertex_count;
         uint32_t index_count;
     };
+
+    // All entity geometry in one vertex and one index array, with indices
+    // rebased to the global vertex numbering. Entities sharing a mesh share
+    // its range, so every mesh is written once.
+    struct FlattenedGeometry {
+        std::unique_ptr<float[]> vertices; // xyz per vertex
+        std::unique_ptr<uint32_t[]> indices;
+        size_t vertex_count = 0;
+        size_t index_count = 0;
+        size_t mesh_count = 0;
+        std::vector<EntityOffset> entity_offsets;
+    };
+
+    // Two passes: size every range first, then copy positions and rebase
+    // indices in parallel straight into the final arrays. Meshes must be loaded.
+    void FlattenGeometry(FlattenedGeometry* geometry) const;
+
+private:
+    void UpdateMaterialsBuffer();
+    void UpdateCpuInstances();
+    void UpdateCpuInstance(size_t index);
+    void WaitForMeshes();
+    grassland::graphics::RayTracingInstance MakeInstance(size_t index) const;
     
     std::unique_ptr<grassland::graphics::Buffer> vertex_data_buffer_;
     std::unique_ptr<grassland::graphics::Buffer> index_data_buffer_;
     std::unique_ptr<grassland::graphics::Buffer> entity_offset_buffer_;
     std::vector<EntityOffset> entity_offsets_;
 
+    struct CpuInstance {
+        const Bvh* bvh;
+        glm::mat4 world_to_object;
+    };
+    std::vector<CpuInstance> cpu_instances_;
+    std::vector<glm::vec3> cpu_bounds_min_;
+    std::vector<glm::vec3> cpu_bounds_max_;
+    InstanceBvh cpu_tlas_;
+
+    // Persistent TLAS input; instance_slots_ maps entity index to its slot (-1 without BLAS)
+    std::vector<grassland::graphics::RayTracingInstance> instances_;
+    std::vector<int32_t> instance_slots_;
+    std::vector<uint32_t> animated_entities_;
+    std::vector<uint32_t> dirty_entities_;
+
     grassland::graphics::Core* core_;
     std::vector<std::shared_ptr<Entity>> entities_;
     std::unique_ptr<grassland::graphics::AccelerationStructure> tlas_;
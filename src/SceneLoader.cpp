@@ -0,0 +1,345 @@
+#include "SceneLoader.h"
+#include "JsonReader.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <unordered_map>
+
+#ifndef SHORTMARCH_SCENE_DIR
+#define SHORTMARCH_SCENE_DIR "scenes"
+#endif
+
+namespace {
+
+using Token = JsonReader::Token;
+
+class SceneFileParser {
+public:
+    SceneFileParser(const std::string& path, Scene* scene, SceneFileData* data)
+        : path_(path), scene_(scene), data_(data) {
+    }
+
+    bool Parse() {
+        if (!reader_.Open(path_)) {
+            grassland::LogError("Failed to open scene file: {}", path_);
+            return false;
+        }
+        if (!Expect(reader_.Next(), Token::BeginObject, "scene object")) return false;
+        return ReadObject([this](const std::string& key) {
+            if (key == "camera") return ReadCamera();
+            if (key == "textures") return ReadArray([this]() { return ReadTexture(); });
+            if (key == "materials") return ReadMaterials();
+            if (key == "point_lights") return ReadArray([this]() { return ReadPointLight(); });
+            if (key == "area_lights") return ReadArray([this]() { return ReadAreaLight(); });
+            if (key == "entities") return ReadArray([this]() { return ReadEntity(); });
+            return SkipUnknown(key);
+        });
+    }
+
+private:
+    bool Error(const std::string& message) {
+        std::string detail = reader_.GetError().empty() ? message : reader_.GetError();
+        grassland::LogError("{}:{}:{}: {}", path_, reader_.GetLine(), reader_.GetColumn(), detail);
+        return false;
+    }
+
+    bool Expect(Token token, Token expected, const char* what) {
+        return token == expected ? true : Error(std::string("expected ") + what);
+    }
+
+    bool SkipUnknown(const std::string& key) {
+        grassland::LogWarning("{}:{}: ignoring unknown key \"{}\"", path_, reader_.GetLine(), key);
+        return reader_.SkipValue(reader_.Next()) || Error("malformed value");
+    }
+
+    // Calls read_member(key) for every key of an object whose '{' was consumed;
+    // read_member must consume the value
+    template <typename F>
+    bool ReadObject(F&& read_member) {
+        for (;;) {
+            Token token = reader_.Next();
+            if (token == Token::EndObject) return true;
+            if (token != Token::Key) return Error("expected key");
+            std::string key = reader_.GetString();
+            if (!read_member(key)) return false;
+        }
+    }
+
+    // Expects '[' and calls read_element() with the element's first token pending
+    template <typename F>
+    bool ReadArray(F&& read_element) {
+        if (!Expect(reader_.Next(), Token::BeginArray, "array")) return false;
+        for (;;) {
+            Token token = reader_.Next();
+            if (token == Token::EndArray) return true;
+            pending_ = token;
+            if (!read_element()) return false;
+        }
+    }
+
+    // Next token, or the one ReadArray already pulled for the current element
+    Token Take() {
+        if (pending_ != Token::End) {
+            Token token = pending_;
+            pending_ = Token::End;
+            return token;
+        }
+        return reader_.Next();
+    }
+
+    bool ReadFloat(float* value) {
+        if (!Expect(Take(), Token::Number, "number")) return false;
+        *value = static_cast<float>(reader_.GetNumber());
+        return true;
+    }
+
+    bool ReadInt(int* value) {
+        if (!Expect(Take(), Token::Number, "integer")) return false;
+        *value = static_cast<int>(reader_.GetNumber());
+        return true;
+    }
+
+    bool ReadString(std::string* value) {
+        if (!Expect(Take(), Token::String, "string")) return false;
+        *value = reader_.GetString();
+        return true;
+    }
+
+    // Fixed-size number array
+    bool ReadFloats(float* values, int count) {
+        if (!Expect(Take(), Token::BeginArray, "array of numbers")) return false;
+        for (int i = 0; i < count; ++i) {
+            if (!ReadFloat(&values[i])) return false;
+        }
+        return Expect(reader_.Next(), Token::EndArray, "end of array");
+    }
+
+    // Variable-size number array; returns the element count or -1
+    int ReadFloatList(float* values, int max_count) {
+        if (!Expect(Take(), Token::BeginArray, "array of numbers")) return -1;
+        int count = 0;
+        for (;;) {
+            Token token = reader_.Next();
+            if (token == Token::EndArray) return count;
+            if (token != Token::Number || count == max_count) {
+                Error("expected at most " + std::to_string(max_count) + " numbers");
+                return -1;
+            }
+            values[count++] = static_cast<float>(reader_.GetNumber());
+        }
+    }
+
+    bool ReadVec3(glm::vec3* value) {
+        float v[3];
+        if (!ReadFloats(v, 3)) return false;
+        *value = glm::vec3(v[0], v[1], v[2]);
+        return true;
+    }
+
+    // Either [x, y, z] or a single number for all three components
+    bool ReadScale(glm::vec3* value) {
+        Token token = Take();
+        if (token == Token::Number) {
+            *value = glm::vec3(static_cast<float>(reader_.GetNumber()));
+            return true;
+        }
+        pending_ = token;
+        return ReadVec3(value);
+    }
+
+    bool ReadCamera() {
+        SceneCamera& camera = data_->camera;
+        if (!Expect(reader_.Next(), Token::BeginObject, "camera object")) return false;
+        return ReadObject([&](const std::string& key) {
+            if (key == "position") return ReadVec3(&camera.position);
+            if (key == "yaw") return ReadFloat(&camera.yaw);
+            if (key == "pitch") return ReadFloat(&camera.pitch);
+            if (key == "fov") return ReadFloat(&camera.fov);
+            return SkipUnknown(key);
+        });
+    }
+
+    // "path" or { "path": ..., "mip_levels": n }
+    bool ReadTexture() {
+        SceneTexture texture{ std::string(), 0 };
+        Token token = Take();
+        if (token == Token::String) {
+            texture.path = reader_.GetString();
+        } else {
+            if (!Expect(token, Token::BeginObject, "texture")) return false;
+            bool ok = ReadObject([&](const std::string& key) {
+                if (key == "path") return ReadString(&texture.path);
+                if (key == "mip_levels") return ReadInt(&texture.mip_levels);
+                return SkipUnknown(key);
+            });
+            if (!ok) return false;
+        }
+        if (texture.path.empty()) return Error("texture without path");
+        data_->textures.push_back(texture);
+        return true;
+    }
+
+    // Texture parameters mirror the TextureType constructors: 8 coefficients
+    // is a color texture (type 1), 8 plus "normal" a normal map (type 2) and
+    // 10 coefficients a height map (type 3). "type" overrides the guess.
+    bool ReadTextureType(TextureType* texture) {
+        int id = -1;
+        int type = -1;
+        float c[10] = {};
+        int coefficient_count = 0;
+        bool has_normal = false;
+        glm::vec3 normal(0.0f);
+        if (!Expect(Take(), Token::BeginObject, "texture parameters")) return false;
+        bool ok = ReadObject([&](const std::string& key) {
+            if (key == "id") return ReadInt(&id);
+            if (key == "type") return ReadInt(&type);
+            if (key == "coefficients") return (coefficient_count = ReadFloatList(c, 10)) >= 0;
+            if (key == "normal") return has_normal = ReadVec3(&normal);
+            return SkipUnknown(key);
+        });
+        if (!ok) return false;
+
+        if (has_normal) {
+            *texture = TextureType(id, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], normal.x, normal.y, normal.z);
+        } else if (coefficient_count > 8) {
+            *texture = TextureType(id, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], c[8], c[9]);
+        } else {
+            *texture = TextureType(id, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+        }
+        if (type >= 0) texture->type = type;
+        return true;
+    }
+
+    bool ReadMaterial(Material* material) {
+        *material = Material();
+        if (!Expect(Take(), Token::BeginObject, "material object")) return false;
+        return ReadObject([&](const std::string& key) {
+            if (key == "base_color") return ReadVec3(&material->base_color);
+            if (key == "roughness") return ReadFloat(&material->roughness);
+            if (key == "metallic") return ReadFloat(&material->metallic);
+            if (key == "transmission") return ReadFloat(&material->transmission);
+            if (key == "ior") return ReadFloat(&material->ior);
+            if (key == "mean_free_path") return ReadFloat(&material->mean_free_path);
+            if (key == "anisotropy_g") return ReadFloat(&material->anisotropy_g);
+            if (key == "shadow_factor") return ReadFloat(&material->shadow_factor);
+            if (key == "texture") return ReadTextureType(&material->texture_info);
+            return SkipUnknown(key);
+        });
+    }
+
+    // Named materials that entities can refer to instead of inlining one
+    bool ReadMaterials() {
+        if (!Expect(reader_.Next(), Token::BeginObject, "materials object")) return false;
+        return ReadObject([this](const std::string& name) { return ReadMaterial(&materials_[name]); });
+    }
+
+    bool ReadPointLight() {
+        PointLight light;
+        if (!Expect(Take(), Token::BeginObject, "point light")) return false;
+        bool ok = ReadObject([&](const std::string& key) {
+            if (key == "position") return ReadVec3(&light.position);
+            if (key == "color") return ReadVec3(&light.color);
+            if (key == "intensity") return ReadFloat(&light.intensity);
+            return SkipUnknown(key);
+        });
+        if (ok) data_->point_lights.push_back(light);
+        return ok;
+    }
+
+    bool ReadAreaLight() {
+        AreaLight light;
+        if (!Expect(Take(), Token::BeginObject, "area light")) return false;
+        bool ok = ReadObject([&](const std::string& key) {
+            if (key == "center") return ReadVec3(&light.center);
+            if (key == "normal") return ReadVec3(&light.normal);
+            if (key == "left") return ReadVec3(&light.left);
+            if (key == "width") return ReadFloat(&light.width);
+            if (key == "height") return ReadFloat(&light.height);
+            if (key == "color") return ReadVec3(&light.color);
+            if (key == "intensity") return ReadFloat(&light.intensity);
+            return SkipUnknown(key);
+        });
+        if (!ok) return false;
+        light.normal = glm::normalize(light.normal);
+        light.left = glm::normalize(light.left);
+        data_->area_lights.push_back(light);
+        return true;
+    }
+
+    // Transform is translate * rotate (degrees, X then Y then Z) * scale,
+    // unless a full column-major "matrix" is given
+    bool ReadEntity() {
+        std::string mesh;
+        Material material;
+        glm::vec3 translate(0.0f), rotate(0.0f), scale(1.0f), velocity(0.0f);
+        bool has_rotate = false, has_scale = false, has_matrix = false;
+        float matrix[16];
+        if (!Expect(Take(), Token::BeginObject, "entity object")) return false;
+        bool ok = ReadObject([&](const std::string& key) {
+            if (key == "mesh") return ReadString(&mesh);
+            if (key == "material") {
+                Token token = reader_.Next();
+                if (token == Token::String) {
+                    auto it = materials_.find(reader_.GetString());
+                    if (it == materials_.end()) return Error("unknown material \"" + reader_.GetString() + "\"");
+                    material = it->second;
+                    return true;
+                }
+                pending_ = token;
+                return ReadMaterial(&material);
+            }
+            if (key == "translate") return ReadVec3(&translate);
+            if (key == "rotate") return has_rotate = ReadVec3(&rotate);
+            if (key == "scale") return has_scale = ReadScale(&scale);
+            if (key == "matrix") return has_matrix = ReadFloats(matrix, 16);
+            if (key == "velocity") return ReadVec3(&velocity);
+            return SkipUnknown(key);
+        });
+        if (!ok) return false;
+        if (mesh.empty()) return Error("entity without mesh");
+
+        glm::mat4 transform(1.0f);
+        if (has_matrix) {
+            for (int column = 0; column < 4; ++column) {
+                for (int row = 0; row < 4; ++row) {
+                    transform[column][row] = matrix[column * 4 + row];
+                }
+            }
+        } else {
+            transform = glm::translate(transform, translate);
+            if (has_rotate) {
+                transform = glm::rotate(transform, glm::radians(rotate.z), glm::vec3(0.0f, 0.0f, 1.0f));
+                transform = glm::rotate(transform, glm::radians(rotate.y), glm::vec3(0.0f, 1.0f, 0.0f));
+                transform = glm::rotate(transform, glm::radians(rotate.x), glm::vec3(1.0f, 0.0f, 0.0f));
+            }
+            if (has_scale) {
+                transform = glm::scale(transform, scale);
+            }
+        }
+        scene_->AddEntity(std::make_shared<Entity>(mesh, material, transform, velocity));
+        data_->entity_count++;
+        return true;
+    }
+
+    std::string path_;
+    Scene* scene_;
+    SceneFileData* data_;
+    JsonReader reader_;
+    Token pending_ = Token::End;
+    std::unordered_map<std::string, Material> materials_;
+};
+
+} // namespace
+
+bool LoadSceneFile(const std::string& path, Scene* scene, SceneFileData* data) {
+    SceneFileParser parser(path, scene, data);
+    if (!parser.Parse()) {
+        return false;
+    }
+    grassland::LogInfo("Loaded scene file {}: {} entities, {} textures, {} point lights, {} area lights", path,
+                       data->entity_count, data->textures.size(), data->point_lights.size(),
+                       data->area_lights.size());
+    return true;
+}
+
+std::string GetDefaultSceneDirectory() {
+    return SHORTMARCH_SCENE_DIR;
+}
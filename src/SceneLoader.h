@@ -0,0 +1,38 @@
+#pragma once
+#include "long_march.h"
+#include "Scene.h"
+#include "Light.h"
+#include <string>
+#include <vector>
+
+// Initial fly camera of a scene file
+struct SceneCamera {
+    glm::vec3 position{ 0.0f, 2.0f, 5.0f };
+    float yaw{ -90.0f };   // Degrees; -90 looks down -Z
+    float pitch{ 0.0f };
+    float fov{ 60.0f };    // Vertical field of view in degrees
+};
+
+struct SceneTexture {
+    std::string path;
+    int mip_levels;
+};
+
+// Everything in a scene file except the entities, which go straight into the Scene
+struct SceneFileData {
+    SceneCamera camera;
+    std::vector<SceneTexture> textures;
+    std::vector<PointLight> point_lights;
+    std::vector<AreaLight> area_lights;
+    size_t entity_count = 0;
+};
+
+// Load a JSON scene file (see scenes/default.json). The file is parsed as a
+// token stream without building a document tree, and every entity is added to
+// the scene as soon as it has been read, so its mesh starts loading while the
+// rest of the file is still being parsed. Named materials must be declared
+// before the entities that use them.
+bool LoadSceneFile(const std::string& path, Scene* scene, SceneFileData* data);
+
+// Directory holding the scene files shipped with the demo
+std::string GetDefaultSceneDirectory();
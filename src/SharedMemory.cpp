@@ -0,0 +1,179 @@
+#include "SharedMemory.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+SharedMemory::SharedMemory()
+    : data_(nullptr)
+    , size_(0)
+    , owner_(false)
+    , mapping_(nullptr) {
+}
+
+bool SharedMemory::Create(const std::string& name, size_t size) {
+    Close();
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       static_cast<DWORD>(static_cast<uint64_t>(size) >> 32),
+                                       static_cast<DWORD>(size & 0xFFFFFFFFu), name.c_str());
+    if (!mapping) {
+        return false;
+    }
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(mapping);
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    // Page file backed mappings start zeroed
+    mapping_ = mapping;
+    data_ = static_cast<uint8_t*>(view);
+    size_ = size;
+    name_ = name;
+    owner_ = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+    if (!mapping) {
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(view, &info, sizeof(info)) == 0) {
+        UnmapViewOfFile(view);
+        CloseHandle(mapping);
+        return false;
+    }
+    mapping_ = mapping;
+    data_ = static_cast<uint8_t*>(view);
+    size_ = info.RegionSize;
+    name_ = name;
+    owner_ = false;
+    return true;
+}
+
+void SharedMemory::Close() {
+    // The mapping disappears with its last handle
+    if (data_) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_) {
+        CloseHandle(mapping_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    name_.clear();
+    owner_ = false;
+    mapping_ = nullptr;
+}
+
+std::string SharedMemory::MakeProcessName(const std::string& prefix) {
+    return "Local\\" + prefix + "-" + std::to_string(GetCurrentProcessId());
+}
+
+#else
+
+SharedMemory::SharedMemory()
+    : data_(nullptr)
+    , size_(0)
+    , owner_(false)
+    , fd_(-1) {
+}
+
+bool SharedMemory::Create(const std::string& name, size_t size) {
+    Close();
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    // ftruncate zero-fills
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    fd_ = fd;
+    data_ = static_cast<uint8_t*>(view);
+    size_ = size;
+    name_ = name;
+    owner_ = true;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    fd_ = fd;
+    data_ = static_cast<uint8_t*>(view);
+    size_ = static_cast<size_t>(info.st_size);
+    name_ = name;
+    owner_ = false;
+    return true;
+}
+
+void SharedMemory::Close() {
+    if (data_) {
+        munmap(data_, size_);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+    // Processes that still have it mapped keep their view
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+    data_ = nullptr;
+    size_ = 0;
+    name_.clear();
+    owner_ = false;
+    fd_ = -1;
+}
+
+std::string SharedMemory::MakeProcessName(const std::string& prefix) {
+    return "/" + prefix + "-" + std::to_string(getpid());
+}
+
+#endif
+
+SharedMemory::~SharedMemory() {
+    Close();
+}
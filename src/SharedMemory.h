@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Named read-write memory shared between processes of one machine (Win32
+// file mapping backed by the page file, or POSIX shm_open). The creator owns
+// the name and removes it on Close; other processes Open it by name.
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // New zero-filled segment; fails if the name is taken
+    bool Create(const std::string& name, size_t size);
+    bool Open(const std::string& name);
+    void Close();
+
+    bool IsOpen() const { return data_ != nullptr; }
+    uint8_t* GetData() const { return data_; }
+    // Mapped size; may be rounded up to whole pages when opened by name
+    size_t GetSize() const { return size_; }
+
+    // Name unique to this process, e.g. for a segment shared with its children
+    static std::string MakeProcessName(const std::string& prefix);
+
+private:
+    uint8_t* data_;
+    size_t size_;
+    std::string name_;
+    bool owner_;
+#ifdef _WIN32
+    void* mapping_;
+#else
+    int fd_;
+#endif
+};
@@ -0,0 +1,113 @@
+#include "Texture.h"
+#include "stb_image.h"
+
+bool TextureAtlas::AddTexture(const std::string& path, int mip_levels) {
+    std::string full_path = grassland::FindAssetFile(path);
+    grassland::LogInfo("Trying to load texture from: {}", full_path);
+    int width, height, channels;
+    unsigned char* data = stbi_load(full_path.c_str(), &width, &height, &channels, 4);
+
+    if (!data) {
+        grassland::LogInfo("Failed to load texture from: {}", full_path);
+        return false;
+    }
+
+    TextureInfo info;
+    info.width = width;
+    info.height = height;
+    info.offset = (uint32_t)(data_.size() / 4);
+    info.mip_levels = mip_levels;
+    infos_.push_back(info);
+
+    int current_width = width;
+    int current_height = height;
+    unsigned char* current_data = data;
+    int max_mip = mip_levels;
+
+    for (int mip = 0; mip <= max_mip; ++mip) {
+        data_.reserve(data_.size() + (size_t)current_width * current_height * 4);
+        for (int i = 0; i < current_width * current_height; ++i) {
+            int base_idx = i * 4;
+            data_.push_back(current_data[base_idx] / 255.0f);
+            data_.push_back(current_data[base_idx + 1] / 255.0f);
+            data_.push_back(current_data[base_idx + 2] / 255.0f);
+            data_.push_back(current_data[base_idx + 3] / 255.0f);
+        }
+
+        if (mip < max_mip && current_width > 1 && current_height > 1) {
+            int next_width = current_width / 2;
+            int next_height = current_height / 2;
+            unsigned char* next_data = new unsigned char[next_width * next_height * 4];
+
+            for (int y = 0; y < next_height; ++y) {
+                for (int x = 0; x < next_width; ++x) {
+                    for (int c = 0; c < 4; ++c) {
+                        float sum = 0.0f;
+                        sum += current_data[((y*2) * current_width + (x*2)) * 4 + c];
+                        sum += current_data[((y*2) * current_width + (x*2+1)) * 4 + c];
+                        sum += current_data[((y*2+1) * current_width + (x*2)) * 4 + c];
+                        sum += current_data[((y*2+1) * current_width + (x*2+1)) * 4 + c];
+                        next_data[(y * next_width + x) * 4 + c] = (unsigned char)(sum / 4.0f);
+                    }
+                }
+            }
+
+            if (mip > 0) delete[] current_data;
+            current_data = next_data;
+            current_width = next_width;
+            current_height = next_height;
+        }
+    }
+
+    if (max_mip > 0) delete[] current_data;
+    else stbi_image_free(data);
+
+    grassland::LogInfo("Successfully loaded texture from: {}", full_path);
+    return true;
+}
+
+void TextureAtlas::Clear() {
+    data_.clear();
+    infos_.clear();
+}
+
+glm::vec3 TextureAtlas::Sample(uint32_t texture_index, const glm::vec2& uv, float lev) const {
+    if (texture_index >= infos_.size()) {
+        return glm::vec3(0.0f);
+    }
+    const TextureInfo& info = infos_[texture_index];
+    lev = std::clamp(lev, 0.0f, (float)info.mip_levels);
+    uint32_t mip = std::min((uint32_t)lev, info.mip_levels);
+    float frac = lev - (float)mip;
+    uint32_t next_mip = std::min(mip + 1, info.mip_levels);
+
+    uint32_t mip_offset = 0;
+    uint32_t mip_width = info.width;
+    uint32_t mip_height = info.height;
+    for (uint32_t i = 0; i < mip; ++i) {
+        mip_offset += mip_width * mip_height;
+        mip_width /= 2;
+        mip_height /= 2;
+    }
+    uint32_t next_mip_offset = mip_offset + mip_width * mip_height;
+    uint32_t next_mip_width = mip_width / 2;
+    uint32_t next_mip_height = mip_height / 2;
+    if (next_mip == mip) {
+        next_mip_width = mip_width;
+        next_mip_height = mip_height;
+        next_mip_offset = mip_offset;
+    }
+
+    // HLSL converts negative floats to 0 when casting to uint, match that here
+    auto fetch = [&](uint32_t offset, uint32_t width, uint32_t height) {
+        uint32_t x = (uint32_t)std::max(0.0f, uv.x * width) % width;
+        uint32_t y = (uint32_t)std::max(0.0f, uv.y * height) % height;
+        size_t pixel_index = (size_t)info.offset + offset + y * width + x;
+        const float* texel = &data_[pixel_index * 4];
+        return glm::vec3(texel[0], texel[1], texel[2]);
+    };
+
+    glm::vec3 c0 = fetch(mip_offset, mip_width, mip_height);
+    glm::vec3 c1 = fetch(next_mip_offset, next_mip_width, next_mip_height);
+    return c0 + (c1 - c0) * frac;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "long_march.h"
+#include <string>
+#include <vector>
+
+struct TextureInfo {
+    uint32_t width;
+    uint32_t height;
+    uint32_t offset;
+    uint32_t mip_levels;
+};
+
+// TextureAtlas packs every texture (and its box-filtered mip chain) into one
+// RGBA32F array. The same layout is uploaded to texture_data_buffer (space11)
+// and sampled on the CPU by the reference renderer.
+class TextureAtlas {
+public:
+    // Load an image and append it with `mip_levels` extra mips.
+    // A failed load is logged and skipped, like the original OnInit loop.
+    bool AddTexture(const std::string& path, int mip_levels);
+
+    void Clear();
+
+    // Same lookup as GetTextureColor in shader.hlsl
+    glm::vec3 Sample(uint32_t texture_index, const glm::vec2& uv, float lev = 0.0f) const;
+
+    const std::vector<float>& GetData() const { return data_; }
+    const std::vector<TextureInfo>& GetInfos() const { return infos_; }
+    size_t GetTextureCount() const { return infos_.size(); }
+
+private:
+    std::vector<float> data_;
+    std::vector<TextureInfo> infos_;
+};
@@ -0,0 +1,104 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t thread_count)
+    : stopping_(false) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (stopping_ && tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            body(i);
+        }
+        return;
+    }
+
+    // Helpers may start after every index is taken; they then exit at once.
+    // Completion is tracked per index, so we never wait on a queued helper.
+    struct SharedState {
+        std::function<void(size_t)> body;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<SharedState>();
+    state->body = body;
+    state->count = count;
+
+    auto run = [](SharedState& s) {
+        size_t i;
+        while ((i = s.next.fetch_add(1)) < s.count) {
+            s.body(i);
+            if (s.done.fetch_add(1) + 1 == s.count) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers_.size(), count - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t h = 0; h < helpers; ++h) {
+            tasks_.emplace([state, run]() { run(*state); });
+        }
+    }
+    condition_.notify_all();
+
+    run(*state);
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done.load() == state->count; });
+}
+
+namespace {
+size_t global_thread_count = 0;
+}
+
+ThreadPool& ThreadPool::Global() {
+    static ThreadPool pool(global_thread_count);
+    return pool;
+}
+
+void ThreadPool::SetGlobalThreadCount(size_t thread_count) {
+    global_thread_count = thread_count;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool shared by the CPU-side subsystems
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = 0); // 0 = hardware concurrency
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a task and get a future for its result
+    template <typename F>
+    auto Submit(F&& task) -> std::future<decltype(task())> {
+        using ResultType = decltype(task());
+        auto packaged = std::make_shared<std::packaged_task<ResultType()>>(std::forward<F>(task));
+        std::future<ResultType> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace([packaged]() { (*packaged)(); });
+        }
+        condition_.notify_one();
+        return result;
+    }
+
+    // Run body(i) for i in [0, count). Indices are handed out dynamically so
+    // uneven work balances itself. The calling thread participates, so nested
+    // calls from inside a worker cannot deadlock.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    size_t GetThreadCount() const { return workers_.size(); }
+
+    // Process-wide pool sized to the machine, or to SetGlobalThreadCount
+    static ThreadPool& Global();
+    // Size of the global pool (0 = hardware concurrency); only effective
+    // before its first use, e.g. for worker processes sharing the machine
+    static void SetGlobalThreadCount(size_t thread_count);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_;
+};
@@ -0,0 +1,115 @@
+#include "TileScheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+TileScheduler::TileScheduler(int width, int height) {
+    Resize(width, height);
+}
+
+void TileScheduler::Resize(int width, int height) {
+    width_ = width;
+    height_ = height;
+    tiles_x_ = (width + kTileSize - 1) / kTileSize;
+    tiles_y_ = (height + kTileSize - 1) / kTileSize;
+    tile_errors_.clear();
+    active_tiles_.clear();
+    tiles_per_frame_ = static_cast<double>(GetTileCount());
+    BuildSpiralOrder();
+    Reset();
+}
+
+void TileScheduler::BuildSpiralOrder() {
+    spiral_order_.resize(GetTileCount());
+    std::iota(spiral_order_.begin(), spiral_order_.end(), 0u);
+    const float center_x = 0.5f * static_cast<float>(tiles_x_ - 1);
+    const float center_y = 0.5f * static_cast<float>(tiles_y_ - 1);
+    // Square rings around the center, each walked by angle
+    std::vector<float> ring(spiral_order_.size());
+    std::vector<float> angle(spiral_order_.size());
+    for (size_t tile = 0; tile < spiral_order_.size(); ++tile) {
+        float dx = static_cast<float>(tile % tiles_x_) - center_x;
+        float dy = static_cast<float>(tile / tiles_x_) - center_y;
+        ring[tile] = std::max(std::abs(dx), std::abs(dy));
+        angle[tile] = std::atan2(dy, dx);
+    }
+    std::sort(spiral_order_.begin(), spiral_order_.end(), [&](uint32_t a, uint32_t b) {
+        return ring[a] != ring[b] ? ring[a] < ring[b] : angle[a] < angle[b];
+    });
+}
+
+void TileScheduler::SetTileErrors(const std::vector<float>& tile_errors) {
+    tile_errors_ = tile_errors;
+}
+
+void TileScheduler::SetActiveTiles(const std::vector<uint32_t>& active_tiles) {
+    active_tiles_ = active_tiles;
+}
+
+void TileScheduler::Reset() {
+    pass_.clear();
+    pass_position_ = 0;
+}
+
+void TileScheduler::StartPass() {
+    pass_.clear();
+    if (order_ == TileOrder::kScanline) {
+        pass_.resize(GetTileCount());
+        std::iota(pass_.begin(), pass_.end(), 0u);
+    } else {
+        pass_ = spiral_order_;
+    }
+    if (active_tiles_.size() == GetTileCount()) {
+        pass_.erase(std::remove_if(pass_.begin(), pass_.end(), [&](uint32_t tile) { return !active_tiles_[tile]; }),
+                    pass_.end());
+    }
+    if (order_ == TileOrder::kPriority && tile_errors_.size() == GetTileCount()) {
+        std::stable_sort(pass_.begin(), pass_.end(),
+                         [&](uint32_t a, uint32_t b) { return tile_errors_[a] > tile_errors_[b]; });
+    }
+    pass_position_ = 0;
+}
+
+const std::vector<uint32_t>& TileScheduler::NextTiles(size_t max_tiles) {
+    if (pass_position_ == pass_.size()) {
+        StartPass();
+    }
+    // Never cross into the next pass: a pixel must not be sampled twice by one dispatch
+    size_t count = std::min(max_tiles, pass_.size() - pass_position_);
+    next_tiles_.assign(pass_.begin() + pass_position_, pass_.begin() + pass_position_ + count);
+    pass_position_ += count;
+    return next_tiles_;
+}
+
+void TileScheduler::SetFrameBudget(double milliseconds) {
+    frame_budget_ = std::max(0.0, milliseconds);
+}
+
+size_t TileScheduler::GetTilesPerFrame() const {
+    if (frame_budget_ <= 0.0) {
+        return std::numeric_limits<size_t>::max();
+    }
+    return std::max<size_t>(1, static_cast<size_t>(tiles_per_frame_));
+}
+
+void TileScheduler::ReportFrameTime(double milliseconds, size_t tile_count) {
+    if (frame_budget_ <= 0.0 || tile_count == 0 || milliseconds <= 0.0) {
+        return;
+    }
+    // Assume the frame time scales with the tiles. Fixed costs (overlay,
+    // present) break that, so only go halfway to keep the count from oscillating.
+    double target = static_cast<double>(tile_count) * frame_budget_ / milliseconds;
+    tiles_per_frame_ = std::clamp(0.5 * (tiles_per_frame_ + target), 1.0, static_cast<double>(GetTileCount()));
+}
+
+size_t TileScheduler::GetPixelCount(const std::vector<uint32_t>& tiles) const {
+    size_t pixel_count = 0;
+    for (uint32_t tile : tiles) {
+        int x0 = static_cast<int>(tile % tiles_x_) * kTileSize;
+        int y0 = static_cast<int>(tile / tiles_x_) * kTileSize;
+        pixel_count +=
+            static_cast<size_t>(std::min(x0 + kTileSize, width_) - x0) * (std::min(y0 + kTileSize, height_) - y0);
+    }
+    return pixel_count;
+}
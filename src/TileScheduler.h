@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Order in which a pass visits the film's tiles
+enum class TileOrder {
+    kScanline, // row by row from the top left
+    kSpiral,   // rings around the image center, so the middle converges first
+    kPriority, // largest error estimate first (see SetTileErrors), spiral for ties
+};
+
+// Splits the film into kTileSize square tiles and hands out subsets of them,
+// so a frame can render part of a sample pass. A pass visits every active
+// tile once in the chosen order; the renderers take the tile indices
+// (row-major, GetTilesX wide) and sample only those tiles.
+//
+// For the interactive path the scheduler also sizes the subsets: it is told
+// how long each frame took and scales the tiles per frame towards the budget.
+class TileScheduler {
+public:
+    static constexpr int kTileSize = 16;
+
+    TileScheduler(int width, int height);
+
+    // New tile grid; restarts the pass and forgets errors and the active mask
+    void Resize(int width, int height);
+
+    // Orders, errors and the active mask take effect when the next pass starts
+    void SetOrder(TileOrder order) { order_ = order; }
+    TileOrder GetOrder() const { return order_; }
+    // One error estimate per tile (AdaptiveScheduler::GetTileErrors) for TileOrder::kPriority
+    void SetTileErrors(const std::vector<float>& tile_errors);
+    // Nonzero for the tiles a pass visits (AdaptiveScheduler::GetActiveTiles);
+    // empty visits every tile
+    void SetActiveTiles(const std::vector<uint32_t>& active_tiles);
+
+    // Drop the rest of the current pass (call whenever the film is reset)
+    void Reset();
+
+    // Up to max_tiles further tiles of the current pass, starting a new pass
+    // when the previous one has been handed out. Valid until the next call.
+    const std::vector<uint32_t>& NextTiles(size_t max_tiles);
+    // The last NextTiles call handed out the final tiles of a pass, so every
+    // active tile has one more sample
+    bool IsPassComplete() const { return pass_position_ == pass_.size(); }
+    // Tiles handed out so far in the current pass and the pass length
+    size_t GetPassPosition() const { return pass_position_; }
+    size_t GetPassTileCount() const { return pass_.size(); }
+
+    // Frame time budget in milliseconds for GetTilesPerFrame (0: whole passes)
+    void SetFrameBudget(double milliseconds);
+    double GetFrameBudget() const { return frame_budget_; }
+    size_t GetTilesPerFrame() const;
+    // Duration of a frame that rendered tile_count tiles; moves the tiles
+    // per frame towards the budget
+    void ReportFrameTime(double milliseconds, size_t tile_count);
+
+    int GetTilesX() const { return tiles_x_; }
+    int GetTilesY() const { return tiles_y_; }
+    size_t GetTileCount() const { return static_cast<size_t>(tiles_x_) * tiles_y_; }
+    // Pixels covered by tiles (edge tiles are clipped to the film)
+    size_t GetPixelCount(const std::vector<uint32_t>& tiles) const;
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    int tiles_x_ = 0;
+    int tiles_y_ = 0;
+    TileOrder order_ = TileOrder::kSpiral;
+    std::vector<uint32_t> spiral_order_; // every tile, center first
+    std::vector<float> tile_errors_;
+    std::vector<uint32_t> active_tiles_;
+    std::vector<uint32_t> pass_;
+    size_t pass_position_ = 0;
+    std::vector<uint32_t> next_tiles_;
+    double frame_budget_ = 0.0;
+    double tiles_per_frame_ = 0.0;
+
+    void BuildSpiralOrder();
+    void StartPass();
+};
@@ -1,24 +1,18 @@
 #include "app.h"
 #include "Material.h"
 #include "Entity.h"
+#include "SceneLoader.h"
 
 #include "glm/gtc/matrix_transform.hpp"
 #include "imgui.h"
 
-#define STB_IMAGE_WRITE_IMPLEMENTATION
-#include "stb_image_write.h"
-#include "stb_image.h"
-
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <sstream>
-#include <filesystem>
-
-namespace {
-#include "built_in_shaders.inl"
-}
 
-Application::Application(grassland::graphics::BackendAPI api) {
+Application::Application(grassland::graphics::BackendAPI api)
+    : scene_file_(GetDefaultSceneDirectory() + "/default.json") {
     grassland::graphics::CreateCore(api, grassland::graphics::Core::Settings{}, &core_);
     core_->InitializeLogicalDeviceAutoSelect(true);
 
@@ -46,12 +40,14 @@ void Application::ProcessInput() {
         ui_hidden_ = (glfwGetKey(glfw_window, GLFW_KEY_TAB) == GLFW_PRESS);
     }
     
-    // Ctrl+S to save accumulated output (only in inspection mode)
+    // Ctrl+S to save accumulated output, Ctrl+Shift+S as multi-layer EXR (only in inspection mode)
     static bool ctrl_s_was_pressed = false;
     bool ctrl_pressed = (glfwGetKey(glfw_window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS || 
                         glfwGetKey(glfw_window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS);
     bool s_pressed = (glfwGetKey(glfw_window, GLFW_KEY_S) == GLFW_PRESS);
     bool ctrl_s_pressed = ctrl_pressed && s_pressed;
+    bool shift_pressed = (glfwGetKey(glfw_window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
+                          glfwGetKey(glfw_window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS);
     
     if (ctrl_s_pressed && !ctrl_s_was_pressed && !camera_enabled_) {
         // Generate filename with timestamp
@@ -60,10 +56,13 @@ void Application::ProcessInput() {
         std::tm tm;
         localtime_s(&tm, &time_t);
         
+        // Milliseconds keep screenshots taken within a second apart
+        auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
         std::ostringstream filename;
         filename << "screenshot_" 
                  << std::put_time(&tm, "%Y%m%d_%H%M%S")
-                 << ".png";
+                 << "_" << std::setw(3) << std::setfill('0') << milliseconds
+                 << (shift_pressed ? ".exr" : ".png");
         
         SaveAccumulatedOutput(filename.str());
     }
@@ -221,429 +220,66 @@ void Application::OnInit() {
     // Create scene
     scene_ = std::make_unique<Scene>(core_.get());
 
-    // Add entities to the scene
-    
-    // color texture version:
-//	auto ground = std::make_shared<Entity>(
-//		"meshes/cube.obj",
-//		Material(glm::vec3(0.4f, 0.4f, 0.4f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/20.0f, 0.0f, 0.0f, 10.0f/20.0f, 0.0f, 0.0f, 1.0/20.0f, 10.0f/20.0f)),
-//		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), 
-//		glm::vec3(10.0f, 0.1f, 10.0f))
-//	);
-    // height map version:
-//	auto ground = std::make_shared<Entity>(
-//		"meshes/cube.obj",
-//		Material(glm::vec3(0.4f, 0.4f, 0.4f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(2, 1.0f/20.0f, 0.0f, 0.0f, 10.0f/20.0f, 0.0f, 0.0f, 1.0/20.0f, 10.0f/20.0f, -30.0, 30.0)),
-//		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), 
-//		glm::vec3(10.0f, 0.1f, 10.0f))
-//	);
-	auto ground = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.4f, 0.4f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(1, 1.0f/20.0f, 0.0f, 0.0f, 10.0f/20.0f, 0.0f, 0.0f, 1.0/20.0f, 10.0f/20.0f, 1.0f, 0.0f, 0.0f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, 0.0f)), 
-		glm::vec3(10.0f, 0.1f, 10.0f))
-	);
-	scene_->AddEntity(ground);
-	auto purple_sphere = std::make_shared<Entity>(
-		"meshes/preview_sphere.obj",
-		Material(glm::vec3(1.0f, 0.5f, 1.0f), 0.2f, 0.5f),
-		glm::translate(glm::mat4(1.0f), glm::vec3(7.0f, 0.3f, -7.0f))
-	);
-	scene_->AddEntity(purple_sphere);
-	auto teapot = std::make_shared<Entity>(
-		"meshes/teapot.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.2f, 0.0f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.45f, -4.0f)), glm::vec3(0.3f, 0.3f, 0.3f))
-	);
-	scene_->AddEntity(teapot);
-	auto left_wall = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(5, 0.0f, 0.0f, 1.0f/8.5f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-10.0f, 0.0f, 0.0f)), 
-		glm::vec3(0.1f, 10.0f, 10.0f))
-	);
-	scene_->AddEntity(left_wall);
-	auto right_wall = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(5, 0.0f, 0.0f, 1.0f/8.5f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, 0.0f)), 
-		glm::vec3(0.1f, 10.0f, 10.0f))
-	);
-	scene_->AddEntity(right_wall);
-	auto back_wall = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 10.0f)), 
-		glm::vec3(10.0f, 10.0f, 0.1f))
-	);
-	scene_->AddEntity(back_wall);
-	auto ceiling = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(4, 1.0f/20.0f, 0.0f, 0.0f, 10.0f/20.0f, 0.0f, 0.0f, 1.0/20.0f, 10.0f/20.0f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, 0.0f)), 
-		glm::vec3(10.0f, 0.1f, 10.0f))
-	);
-	scene_->AddEntity(ceiling);
-	auto front_wall1 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(10.0f, 0.0f, -10.0f)), 
-		glm::vec3(6.5f, 10.0f, 0.1f))
-	);
-	scene_->AddEntity(front_wall1);
-	auto front_wall2 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-10.0f, 0.0f, -10.0f)), 
-		glm::vec3(6.5f, 10.0f, 0.1f))
-	);
-	scene_->AddEntity(front_wall2);
-	auto front_wall3 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)), 
-		glm::vec3(10.0f, 2.2f, 0.1f))
-	);
-	scene_->AddEntity(front_wall3);
-	auto front_wall4 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, -10.0f)), 
-		glm::vec3(10.0f, 2.2f, 0.1f))
-	);
-	scene_->AddEntity(front_wall4);
-	auto pillar = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(0, 1.0f/8.5f, 0.0f, 0.0f, 10.0f/8.5f, 0.0f, 1.0f/8.5f, 0, 1.0f/8.5f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -10.0f)), 
-		glm::vec3(0.6f, 10.0f, 0.1f))
-	);
-	scene_->AddEntity(pillar);
-	auto pink_bunny = std::make_shared<Entity>(
-		"meshes/bunny.obj",
-		Material(glm::vec3(0.9f, 0.4f, 0.6f), 0.5f, 0),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-7.0f, 0.3f, -7.0f)), glm::vec3(1.2f, 1.2f, 1.2f))
-	);
-	scene_->AddEntity(pink_bunny);
-	auto brown_table = std::make_shared<Entity>(
-		"meshes/table.obj",
-		Material(glm::vec3(0.4f, 0.3f, 0.2f), 0.7f, 0),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.0f, -3.3f)), glm::vec3(0.007f, 0.0035f, 0.007f))
-	);
-	scene_->AddEntity(brown_table);
-	auto painting_frame = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.4f, 0.325f, 0.25f), 0.8f, 0.0f, 0.0f, 1.5f, 0.0f, 0.0f, TextureType(6, 1.0f/2.0f, 0.0f, 0.0f, 8.0f/2.0f, 0.0f, -1.0f/2.0f, 0.0f, 4.5f/2.0f)),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-7.0f, 3.5f, -9.9f)), 
-		glm::vec3(1.0f, 1.0f, 0.2f))
-	);
-	scene_->AddEntity(painting_frame);
-	auto brown_chair = std::make_shared<Entity>(
-		"meshes/chair.obj",
-		Material(glm::vec3(0.4f, 0.3f, 0.2f), 0.7f, 0),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 1.6f, -1.5f)), glm::vec3(0.3f, 0.3f, 0.3f))
-	);
-	scene_->AddEntity(brown_chair);
-	auto sss_sculpture = std::make_shared<Entity>(
-    	"meshes/happy.obj",
-    	Material(glm::vec3(0.5f, 0.8f, 0.6f), 0.3f, 0.0f, 0.7f, 1.4f, 0.2f, 0.8f, TextureType(), 0.2f),
-    	glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(2.75f, -2.05f, -0.5f)), glm::vec3(20.0f, 20.0f, 20.0f))
-	);
-	scene_->AddEntity(sss_sculpture);
-	auto red_apple = std::make_shared<Entity>(
-    	"meshes/appleuvw.obj",
-    	Material(glm::vec3(0.9f, 0.05f, 0.0f), 0.8f, 0.0f),
-    	glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-2.5f, 0.7f, -1.5f)), glm::vec3(0.006f, 0.006f, 0.006f)),
-    	glm::vec3(0.0f, -100.0f, 0.0f)
-	);
-	scene_->AddEntity(red_apple);
-	auto lampshade1 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, -0.7f)), 
-		glm::vec3(1.5f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade1);
-	auto lampshade2 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, -3.7f)), 
-		glm::vec3(1.5f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade2);
-	auto lampshade3 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.5f, 7.5f, -2.2f)), 
-		glm::vec3(0.1f, 1.0f, 1.5f))
-	);
-	scene_->AddEntity(lampshade3);
-	auto lampshade4 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-1.5f, 7.5f, -2.2f)), 
-		glm::vec3(0.1f, 1.0f, 1.5f))
-	);
-	scene_->AddEntity(lampshade4);
-	auto lampshade5 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-8.0f, 7.5f, -7.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade5);
-	auto lampshade6 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-8.0f, 7.5f, -9.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade6);
-	auto lampshade7 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-7.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade7);
-	auto lampshade8 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-9.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade8);
-	auto lampshade9 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(8.0f, 7.5f, -7.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade9);
-	auto lampshade10 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(8.0f, 7.5f, -9.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade10);
-	auto lampshade11 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(7.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade11);
-	auto lampshade12 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(9.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade12);
-	auto lampshade13 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, -7.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade13);
-	auto lampshade14 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 7.5f, -9.0f)), 
-		glm::vec3(1.0f, 1.0f, 0.1f))
-	);
-	scene_->AddEntity(lampshade14);
-	auto lampshade15 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade15);
-	auto lampshade16 = std::make_shared<Entity>(
-		"meshes/cube.obj",
-		Material(glm::vec3(0.8f, 0.8f, 0.8f), 0.3f, 0.7f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(1.0f, 7.5f, -8.0f)), 
-		glm::vec3(0.1f, 1.0f, 1.0f))
-	);
-	scene_->AddEntity(lampshade16);
-	auto basket = std::make_shared<Entity>(
-		"meshes/basket.obj",
-		Material(glm::vec3(0.5f, 0.25f, 0.0f), 0.9f, 0.0f),
-		glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(-2.5f, -1.0f, -1.0f)), 
-		glm::vec3(0.006f, 0.006f, 0.006f))
-	);
-	scene_->AddEntity(basket);
-	
+    // Load entities, textures, lights and the initial camera from the scene file.
+    // Entities start loading their meshes as soon as they are parsed.
+    SceneFileData scene_data;
+    if (!LoadSceneFile(scene_file_, scene_.get(), &scene_data)) {
+        grassland::LogError("Failed to load scene: {}", scene_file_);
+        alive_ = false;
+        return;
+    }
+
 	// Load textures
 
-	std::vector<std::string> texture_paths = {
-	    "textures/texture1.png",
-	    "textures/texture2.png",
-	    "textures/texture3.png",
-	    "textures/texture4.png",
-	    "textures/texture5.png",
-	    "textures/texture6.png",
-	    "textures/texture7.png"
-	};
-	std::vector<int> mip_levels = {10, 0, 0, 0, 0, 0, 0};
-	std::vector<float> texture_data_buffer_content;
-	
-	for (int tex_idx = 0; tex_idx < texture_paths.size(); ++tex_idx) {
-	    const auto& path = texture_paths[tex_idx];
-	    std::string full_path = grassland::FindAssetFile(path);
-	    grassland::LogInfo("Trying to load texture from: {}", full_path);
-	    int width, height, channels;
-	    unsigned char* data = stbi_load(full_path.c_str(), &width, &height, &channels, 4);
-	    
-	    if (data) {
-	        TextureInfo info;
-	        info.width = width;
-	        info.height = height;
-	        info.offset = (uint32_t)(texture_data_buffer_content.size() / 4);
-	        info.mip_levels = mip_levels[tex_idx];
-	        texture_infos_.push_back(info);
-	        
-	        int current_width = width;
-	        int current_height = height;
-	        unsigned char* current_data = data;
-	        int max_mip = mip_levels[tex_idx];
-	        
-	        for (int mip = 0; mip <= max_mip; ++mip) {
-	            for (int i = 0; i < current_width * current_height; ++i) {
-	                int x = i % current_width;
-	                int y = i / current_width;
-	                int base_idx = (y * current_width + x) * 4;
-	                
-	                float r = current_data[base_idx] / 255.0f;
-	                float g = current_data[base_idx + 1] / 255.0f;
-	                float b = current_data[base_idx + 2] / 255.0f;
-	                float a = current_data[base_idx + 3] / 255.0f;
-	                
-	                texture_data_buffer_content.push_back(r);
-	                texture_data_buffer_content.push_back(g);
-	                texture_data_buffer_content.push_back(b);
-	                texture_data_buffer_content.push_back(a);
-	            }
-	            
-	            if (mip < max_mip && current_width > 1 && current_height > 1) {
-	                int next_width = current_width / 2;
-	                int next_height = current_height / 2;
-	                unsigned char* next_data = new unsigned char[next_width * next_height * 4];
-	                
-	                for (int y = 0; y < next_height; ++y) {
-	                    for (int x = 0; x < next_width; ++x) {
-	                        for (int c = 0; c < 4; ++c) {
-	                            float sum = 0.0f;
-	                            sum += current_data[((y*2) * current_width + (x*2)) * 4 + c];
-	                            sum += current_data[((y*2) * current_width + (x*2+1)) * 4 + c];
-	                            sum += current_data[((y*2+1) * current_width + (x*2)) * 4 + c];
-	                            sum += current_data[((y*2+1) * current_width + (x*2+1)) * 4 + c];
-	                            next_data[(y * next_width + x) * 4 + c] = (unsigned char)(sum / 4.0f);
-	                        }
-	                    }
-	                }
-	                
-	                if (mip > 0) delete[] current_data;
-	                current_data = next_data;
-	                current_width = next_width;
-	                current_height = next_height;
-	            }
-	        }
-	        
-	        if (max_mip > 0) delete[] current_data;
-	        else stbi_image_free(data);
-	        
-	        grassland::LogInfo("Successfully loaded texture from: {}", full_path);
-	    } else grassland::LogInfo("Failed to load texture from: {}", full_path);
+	texture_atlas_.Clear();
+	for (const auto& texture : scene_data.textures) {
+	    texture_atlas_.AddTexture(texture.path, texture.mip_levels);
 	}
-	
-	size_t buffer_size = texture_data_buffer_content.size() * sizeof(float);
-	core_->CreateBuffer(buffer_size, 
-	                    grassland::graphics::BUFFER_TYPE_DYNAMIC,
-	                    &texture_data_buffer_);
-	texture_data_buffer_->UploadData(texture_data_buffer_content.data(), buffer_size);
-	size_t info_buffer_size = texture_infos_.size() * sizeof(TextureInfo);
-	core_->CreateBuffer(info_buffer_size, 
-		                grassland::graphics::BUFFER_TYPE_DYNAMIC,
-		                &texture_info_buffer_);
-	texture_info_buffer_->UploadData(texture_infos_.data(), info_buffer_size);
+	environment_map_.Build(texture_atlas_);
 	
 	// Add lightings
 	
 	point_lights_.clear();
 	area_lights_.clear();
 
-	AddPointLight(PointLight(glm::vec3(0, 0.5, 0), glm::vec3(1.0f, 0.95f, 0.9f), 0.0f));
-	AddAreaLight(AreaLight(
-    	glm::vec3(0, 7.0f, -2.2f), 
-    	glm::normalize(glm::vec3(0, -1, 0)), 
-    	glm::normalize(glm::vec3(0, 0, 1)),
-    	3.0f, 3.0f, 
-    	glm::vec3(1.0f, 0.99f, 0.98f), 
-    	100.0f
-	));
-	AddAreaLight(AreaLight(
-    	glm::vec3(-8.0f, 7.0f, -8.0f), 
-    	glm::normalize(glm::vec3(0, -1, 0)), 
-    	glm::normalize(glm::vec3(0, 0, 1)),
-    	2.0f, 2.0f, 
-    	glm::vec3(1.0f, 0.7f, 0.7f), 
-    	50.0f
-	));
-	AddAreaLight(AreaLight(
-    	glm::vec3(0.0f, 7.0f, -8.0f), 
-    	glm::normalize(glm::vec3(0, -1, 0)), 
-    	glm::normalize(glm::vec3(0, 0, 1)),
-    	2.0f, 2.0f, 
-    	glm::vec3(0.7f, 1.0f, 0.7f), 
-    	50.0f
-	));
-	AddAreaLight(AreaLight(
-    	glm::vec3(8.0f, 7.0f, -8.0f), 
-    	glm::normalize(glm::vec3(0, -1, 0)), 
-    	glm::normalize(glm::vec3(0, 0, 1)),
-    	2.0f, 2.0f, 
-    	glm::vec3(0.7f, 0.7f, 1.0f), 
-    	50.0f
-	));
-	
-	size_t point_lights_buffer_size = point_lights_.size() * sizeof(PointLight);
-	size_t area_lights_buffer_size = area_lights_.size() * sizeof(AreaLight);
-	core_->CreateBuffer(point_lights_buffer_size, 
-                   grassland::graphics::BUFFER_TYPE_DYNAMIC,
-                   &point_lights_buffer_);
-	core_->CreateBuffer(area_lights_buffer_size, 
-                   grassland::graphics::BUFFER_TYPE_DYNAMIC,
-                   &area_lights_buffer_);
-	point_lights_buffer_->UploadData(point_lights_.data(), point_lights_buffer_size);
-	area_lights_buffer_->UploadData(area_lights_.data(), area_lights_buffer_size);
+	for (const auto& light : scene_data.point_lights) {
+	    AddPointLight(light);
+	}
+	for (const auto& light : scene_data.area_lights) {
+	    AddAreaLight(light);
+	}
 
     // Build acceleration structures
     scene_->BuildAccelerationStructures();
     scene_->BuildVertexIndexData();
+    // Hover picking casts rays through the CPU BVH by default
+    scene_->BuildCpuAccelerationStructures();
 
     // Create film for accumulation
     film_ = std::make_unique<Film>(core_.get(), window_->GetWidth(), window_->GetHeight());
+    film_->GetTileScheduler().SetFrameBudget(frame_budget_ms_);
+    last_frame_start_ = std::chrono::steady_clock::now();
 
-    core_->CreateBuffer(sizeof(CameraObject), grassland::graphics::BUFFER_TYPE_DYNAMIC, &camera_object_buffer_);
-    
-    // Create hover info buffer
-    core_->CreateBuffer(sizeof(HoverInfo), grassland::graphics::BUFFER_TYPE_DYNAMIC, &hover_info_buffer_);
-    HoverInfo initial_hover{};
-    initial_hover.hovered_entity_id = -1;
-    hover_info_buffer_->UploadData(&initial_hover, sizeof(HoverInfo));
+    // CPU reference renderer shares the scene, textures and lights with the GPU path
+    cpu_renderer_ = std::make_unique<CpuRenderer>(scene_.get(), &texture_atlas_);
+    cpu_renderer_->SetLights(point_lights_, area_lights_);
+    cpu_renderer_->SetEnvironment(&environment_map_);
+
+    // Ray tracing pipeline with its camera, light and texture buffers and output images
+    gpu_renderer_ = std::make_unique<GpuRenderer>(core_.get(), scene_.get(), &texture_atlas_);
+    gpu_renderer_->SetLights(point_lights_, area_lights_);
+    gpu_renderer_->SetEnvironment(environment_map_);
+    gpu_renderer_->Resize(window_->GetWidth(), window_->GetHeight());
 
     // Initialize camera state member variables
-    camera_pos_ = glm::vec3{ 0.0f, 2.0f, 5.0f };
+    camera_pos_ = scene_data.camera.position;
+    camera_fov_ = scene_data.camera.fov;
     camera_up_ = glm::vec3{ 0.0f, 1.0f, 0.0f }; // World up
     camera_speed_ = 0.1f;
 
     // Initialize new mouse/view variables
-    yaw_ = -90.0f; // Point down -Z
-    pitch_ = 0.0f;
+    yaw_ = scene_data.camera.yaw;
+    pitch_ = scene_data.camera.pitch;
     last_x_ = (float)window_->GetWidth() / 2.0f;
     last_y_ = (float)window_->GetHeight() / 2.0f;
     mouse_sensitivity_ = 0.1f;
@@ -657,117 +293,108 @@ void Application::OnInit() {
     camera_front_ = glm::normalize(front);
 
     // Set initial camera buffer data
-    CameraObject camera_object{};
-    camera_object.screen_to_camera = glm::inverse(
-        glm::perspective(glm::radians(60.0f), (float)window_->GetWidth() / (float)window_->GetHeight(), 0.1f, 10.0f));
-    camera_object.camera_to_world =
-        glm::inverse(glm::lookAt(camera_pos_, camera_pos_ + camera_front_, camera_up_));
-    camera_object_buffer_->UploadData(&camera_object, sizeof(CameraObject));
-
-    core_->CreateImage(window_->GetWidth(), window_->GetHeight(), grassland::graphics::IMAGE_FORMAT_R32G32B32A32_SFLOAT,
-        &color_image_);
-    
-    // Create entity ID buffer for accurate picking (R32_SINT to store entity indices)
-    core_->CreateImage(window_->GetWidth(), window_->GetHeight(), grassland::graphics::IMAGE_FORMAT_R32_SINT,
-        &entity_id_image_);
-
-    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "RayGenMain", "lib_6_3", &raygen_shader_);
-    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "MissMain", "lib_6_3", &miss_shader_);
-    core_->CreateShader(GetShaderCode("shaders/shader.hlsl"), "ClosestHitMain", "lib_6_3", &closest_hit_shader_);
-    grassland::LogInfo("Shader compiled successfully");
-
-    core_->CreateRayTracingProgram(raygen_shader_.get(), miss_shader_.get(), closest_hit_shader_.get(), &program_);
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_ACCELERATION_STRUCTURE, 1);  // space0
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space1 - color output
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space2
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space3 - materials
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_UNIFORM_BUFFER, 1);          // space4 - hover info
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space5 - entity ID output
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space6 - accumulated color
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_WRITABLE_IMAGE, 1);          // space7 - accumulated samples
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);
-    program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space11 - texture data
-	program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space12 - point lights
-	program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space13 - area lights
-	program_->AddResourceBinding(grassland::graphics::RESOURCE_TYPE_STORAGE_BUFFER, 1);          // space14 - texture info
-	program_->Finalize();
+    gpu_renderer_->SetCamera(MakeCameraObject());
 }
 
 void Application::OnClose() {
-    // Clean up graphics resources first
-    program_.reset();
-    raygen_shader_.reset();
-    miss_shader_.reset();
-    closest_hit_shader_.reset();
+    image_exporter_.WaitAll();
 
+    // Clean up graphics resources first
+    gpu_renderer_.reset();
+    cpu_renderer_.reset();
     scene_.reset();
     film_.reset();
-
-    color_image_.reset();
-    entity_id_image_.reset();
-    camera_object_buffer_.reset();
-    hover_info_buffer_.reset();
     
     // Don't call TerminateImGui - let the window destructor handle it
     // Just reset window which will clean everything up properly
     window_.reset();
 }
 
-void Application::UpdateHoveredEntity() {
-    // Only detect hover when camera is disabled (cursor visible)
-    if (camera_enabled_) {
-        hovered_entity_id_ = -1;
-        hovered_pixel_color_ = glm::vec4(0.0f);
-        return;
-    }
+CameraObject Application::MakeCameraObject() const {
+    CameraObject camera_object{};
+    camera_object.screen_to_camera = glm::inverse(
+        glm::perspective(glm::radians(camera_fov_), (float)window_->GetWidth() / (float)window_->GetHeight(), 0.1f, 10.0f));
+    camera_object.camera_to_world =
+        glm::inverse(glm::lookAt(camera_pos_, camera_pos_ + camera_front_, camera_up_));
+    return camera_object;
+}
 
+void Application::UpdateHoveredEntity() {
     // Get mouse position in pixel coordinates
     int x = static_cast<int>(mouse_x_);
     int y = static_cast<int>(mouse_y_);
     int width = window_->GetWidth();
     int height = window_->GetHeight();
-    
-    // Check bounds
-    if (x < 0 || x >= width || y < 0 || y >= height) {
+
+    // Only detect hover when camera is disabled (cursor visible) and the
+    // mouse is inside the window
+    if (camera_enabled_ || x < 0 || x >= width || y < 0 || y >= height) {
         hovered_entity_id_ = -1;
         hovered_pixel_color_ = glm::vec4(0.0f);
+        gpu_renderer_->SetPickPixel(-1, -1);
+        pick_x_ = -1;
         return;
     }
 
-    grassland::graphics::Offset2D offset{ x, y };
-    grassland::graphics::Extent2D extent{ 1, 1 };
-    
-    // Read entity ID from the ID buffer at the mouse position
-    // The entity_id_image_ stores the entity index (-1 for no entity)
-    int32_t entity_id = -1;
-    entity_id_image_->DownloadData(&entity_id, offset, extent);
-    hovered_entity_id_ = entity_id;
-    
-    // Read pixel color from accumulated buffer (before highlighting is applied)
-    // Note: This is a synchronous read which may cause a GPU stall
-    // For better performance, consider using a readback buffer with a frame delay
-    float accumulated_rgba[4] = {0.0f, 0.0f, 0.0f, 0.0f};
-    film_->GetAccumulatedColorImage()->DownloadData(accumulated_rgba, offset, extent);
-    
-    // Average by sample count to get final color (before highlighting)
-    int sample_count = film_->GetSampleCount();
-    if (sample_count > 0) {
-        hovered_pixel_color_ = glm::vec4(
-            accumulated_rgba[0] / static_cast<float>(sample_count),
-            accumulated_rgba[1] / static_cast<float>(sample_count),
-            accumulated_rgba[2] / static_cast<float>(sample_count),
-            accumulated_rgba[3] / static_cast<float>(sample_count)
-        );
-    } else {
+    // Ray cast through the CPU BVH: current frame, no image or device involved
+    bool cpu_picking = use_cpu_renderer_ || cpu_picking_;
+    if (cpu_picking) {
+        hovered_entity_id_ = scene_->PickEntity(MakeCameraObject(), x, y, width, height);
+    }
+
+    if (use_cpu_renderer_) {
+        // The CPU renderer accumulates on the host, so the color is right there
+        gpu_renderer_->SetPickPixel(-1, -1);
+        size_t pixel_index = static_cast<size_t>(y) * width + x;
+        const float* accumulated_rgba = film_->GetHostAccumulatedColor() + pixel_index * 4;
+        int sample_count = film_->GetHostAccumulatedSamples()[pixel_index];
+        hovered_pixel_color_ = sample_count > 0
+                                   ? glm::vec4(accumulated_rgba[0], accumulated_rgba[1], accumulated_rgba[2],
+                                               accumulated_rgba[3]) / static_cast<float>(sample_count)
+                                   : glm::vec4(0.0f);
+        return;
+    }
+
+    // The ray generation shader records entity ID and accumulated color at
+    // this pixel into the pick ring. Reading it is a synchronous download
+    // that waits for the device, so with CPU picking it is only read for the
+    // pixel inspector, and only when the pixel or the film's samples changed.
+    if (cpu_picking) {
+        if (ui_hidden_) {
+            gpu_renderer_->SetPickPixel(-1, -1);
+            pick_x_ = -1;
+            return;
+        }
+        int sample_count = film_->GetSampleCount();
+        if (x == pick_x_ && y == pick_y_ && sample_count == pick_sample_count_) {
+            return; // the color shown is still current
+        }
+        pick_x_ = x;
+        pick_y_ = y;
+        pick_sample_count_ = sample_count;
+    }
+    gpu_renderer_->SetPickPixel(x, y);
+    GpuRenderer::PickResult pick;
+    if (!gpu_renderer_->ReadPickResult(&pick)) {
+        if (!cpu_picking) {
+            hovered_entity_id_ = -1;
+        }
         hovered_pixel_color_ = glm::vec4(0.0f);
+        return;
     }
-    
+    if (!cpu_picking) {
+        hovered_entity_id_ = pick.entity_id;
+    }
+    // Average by the pixel's own sample count (before highlighting)
+    hovered_pixel_color_ = pick.sample_count > 0
+                               ? pick.accumulated_color / static_cast<float>(pick.sample_count)
+                               : glm::vec4(0.0f);
+
     // Hover state is shown in the UI panels, no logging needed
 }
 
 void Application::OnUpdate() {
+    image_exporter_.Poll();
     if (window_->ShouldClose()) {
         window_->CloseWindow();
         alive_ = false;
@@ -794,17 +421,12 @@ void Application::OnUpdate() {
         UpdateHoveredEntity();
         
         // Update hover info buffer
-        HoverInfo hover_info{};
-        hover_info.hovered_entity_id = hovered_entity_id_;
-        hover_info_buffer_->UploadData(&hover_info, sizeof(HoverInfo));
+        gpu_renderer_->SetHoveredEntity(hovered_entity_id_);
+        // The entity ID image only feeds the hover highlight
+        gpu_renderer_->SetEntityIdOutput(hovered_entity_id_ >= 0 && !camera_enabled_);
 
         // Update the camera buffer with new position/orientation
-        CameraObject camera_object{};
-        camera_object.screen_to_camera = glm::inverse(
-            glm::perspective(glm::radians(60.0f), (float)window_->GetWidth() / (float)window_->GetHeight(), 0.1f, 10.0f));
-        camera_object.camera_to_world =
-            glm::inverse(glm::lookAt(camera_pos_, camera_pos_ + camera_front_, camera_up_));
-        camera_object_buffer_->UploadData(&camera_object, sizeof(CameraObject));
+        gpu_renderer_->SetCamera(MakeCameraObject());
 
 
         // Optional: Animate entities
@@ -813,80 +435,32 @@ void Application::OnUpdate() {
     }
 }
 
-void Application::ApplyHoverHighlight(grassland::graphics::Image* image) {
-    // Apply hover highlighting by modifying pixels where entity ID matches hovered entity
-    // This is done as a CPU-side post-process so it doesn't affect accumulation
-    
-    int width = window_->GetWidth();
-    int height = window_->GetHeight();
-    size_t pixel_count = width * height;
-    
-    // Download current image
-    std::vector<float> image_data(pixel_count * 4);
-    image->DownloadData(image_data.data());
-    
-    // Download entity ID buffer
-    std::vector<int32_t> entity_ids(pixel_count);
-    entity_id_image_->DownloadData(entity_ids.data());
-    
-    // Apply highlight to pixels matching hovered entity
-    float highlight_factor = 0.4f; // Blend factor for white highlight
-    for (size_t i = 0; i < pixel_count; i++) {
-        if (entity_ids[i] == hovered_entity_id_) {
-            // Lerp towards white (1, 1, 1) by highlight_factor
-            image_data[i * 4 + 0] = image_data[i * 4 + 0] * (1.0f - highlight_factor) + 1.0f * highlight_factor;
-            image_data[i * 4 + 1] = image_data[i * 4 + 1] * (1.0f - highlight_factor) + 1.0f * highlight_factor;
-            image_data[i * 4 + 2] = image_data[i * 4 + 2] * (1.0f - highlight_factor) + 1.0f * highlight_factor;
-            // Keep alpha unchanged
-        }
+void Application::ApplyHoverHighlight(grassland::graphics::CommandContext* command_context,
+                                      grassland::graphics::Image* image) {
+    // Apply hover highlighting to pixels whose entity ID matches the hovered
+    // entity. Only the entity's projected bounds are visited, so the cost
+    // follows its screen coverage; accumulation is not affected.
+    Scene::ScreenRect rect;
+    if (!scene_->GetEntityScreenRect(hovered_entity_id_, MakeCameraObject(), window_->GetWidth(),
+                                     window_->GetHeight(), &rect)) {
+        return;
     }
-    
-    // Upload modified image
-    image->UploadData(image_data.data());
+    gpu_renderer_->HighlightEntity(command_context, image, hovered_entity_id_, rect);
+    // The highlight is drawn into the developed output; the next develop must
+    // replace it even if no sample was added
+    film_->InvalidateOutput();
 }
 
 void Application::SaveAccumulatedOutput(const std::string& filename) {
-    // Save the accumulated output image to a PNG file (without hover highlighting)
-    int width = window_->GetWidth();
-    int height = window_->GetHeight();
-    int sample_count = film_->GetSampleCount();
-    
-    if (sample_count == 0) {
+    // Save the accumulated output image (without hover highlighting); the extension picks the format
+    if (film_->GetSampleCount() == 0) {
         grassland::LogWarning("Cannot save screenshot: no samples accumulated yet");
         return;
     }
     
-    // Download accumulated color directly from film buffers (not the output image which may have highlights)
-    std::vector<float> accumulated_colors(width * height * 4);
-    film_->GetAccumulatedColorImage()->DownloadData(accumulated_colors.data());
-    
-    // Convert from accumulated sum to averaged color, then to 8-bit
-    std::vector<uint8_t> byte_data(width * height * 4);
-    for (size_t i = 0; i < width * height; i++) {
-        // Average the accumulated color by dividing by sample count
-        float r = accumulated_colors[i * 4 + 0] / static_cast<float>(sample_count);
-        float g = accumulated_colors[i * 4 + 1] / static_cast<float>(sample_count);
-        float b = accumulated_colors[i * 4 + 2] / static_cast<float>(sample_count);
-        float a = accumulated_colors[i * 4 + 3] / static_cast<float>(sample_count);
-        
-        // Clamp to [0, 1] and convert to 8-bit
-        byte_data[i * 4 + 0] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, r)) * 255.0f);
-        byte_data[i * 4 + 1] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, g)) * 255.0f);
-        byte_data[i * 4 + 2] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, b)) * 255.0f);
-        byte_data[i * 4 + 3] = static_cast<uint8_t>(std::max(0.0f, std::min(1.0f, a)) * 255.0f);
-    }
-    
-    // Write PNG file
-    int result = stbi_write_png(filename.c_str(), width, height, 4, byte_data.data(), width * 4);
-    
-    if (result) {
-        // Get absolute path for logging
-        std::filesystem::path abs_path = std::filesystem::absolute(filename);
-        grassland::LogInfo("Screenshot saved: {} ({}x{}, {} samples)", 
-                          abs_path.string(), width, height, sample_count);
-    } else {
-        grassland::LogError("Failed to save screenshot: {}", filename);
-    }
+    // Copy accumulated color and AOVs directly from film buffers (not the output image which may have
+    // highlights); conversion and encoding happen on the exporter's thread pool task
+    image_exporter_.Export(filename, ImageExporter::CaptureFilm(film_.get()));
 }
 
 void Application::RenderInfoOverlay() {
@@ -981,6 +555,58 @@ void Application::RenderInfoOverlay() {
     ImGui::Text("Backend: %s", 
                 core_->API() == grassland::graphics::BACKEND_API_VULKAN ? "Vulkan" : "D3D12");
     ImGui::Text("Device: %s", core_->DeviceName().c_str());
+    if (ImGui::Checkbox("CPU reference renderer", &use_cpu_renderer_)) {
+        if (use_cpu_renderer_) {
+            scene_->BuildCpuAccelerationStructures();
+        }
+        film_->SetHostAccumulation(use_cpu_renderer_);
+    }
+    if (ImGui::Checkbox("CPU BVH picking", &cpu_picking_) && cpu_picking_ &&
+        !scene_->HasCpuAccelerationStructures()) {
+        scene_->BuildCpuAccelerationStructures();
+    }
+    const char* light_selections[] = { "Light BVH", "Power alias table" };
+    int light_selection = static_cast<int>(light_selection_);
+    if (ImGui::Combo("Light sampling", &light_selection, light_selections, 2)) {
+        // The estimators converge to the same image but mixing them would blur the comparison
+        light_selection_ = static_cast<LightSelection>(light_selection);
+        cpu_renderer_->SetLightSelection(light_selection_);
+        gpu_renderer_->SetLightSelection(light_selection_);
+        film_->Reset();
+    }
+    const char* sampler_types[] = { "Random (PCG)", "Sobol (Owen)", "Blue-noise Sobol" };
+    int sampler_type = static_cast<int>(sampler_type_);
+    if (ImGui::Combo("Sampler", &sampler_type, sampler_types, 3)) {
+        sampler_type_ = static_cast<SamplerType>(sampler_type);
+        cpu_renderer_->SetSamplerType(sampler_type_);
+        gpu_renderer_->SetSamplerType(sampler_type_);
+        film_->Reset();
+    }
+    if (!environment_map_.IsEmpty() && ImGui::Checkbox("Sky lighting", &environment_light_)) {
+        cpu_renderer_->SetEnvironmentLight(environment_light_);
+        gpu_renderer_->SetEnvironmentLight(environment_light_);
+        film_->Reset();
+    }
+    if (ImGui::Checkbox("AOVs (albedo, normal, depth, ID)", &film_aovs_)) {
+        // Allocating or freeing the layers restarts the accumulation
+        film_->SetAovs(film_aovs_ ? Film::kAovAlbedo | Film::kAovNormal | Film::kAovDepth | Film::kAovInstanceId : 0);
+    }
+    TileScheduler& tile_scheduler = film_->GetTileScheduler();
+    ImGui::Checkbox("Progressive tiles", &progressive_tiles_);
+    if (progressive_tiles_) {
+        const char* tile_orders[] = { "Scanline", "Spiral", "Noisiest first" };
+        int tile_order = static_cast<int>(tile_scheduler.GetOrder());
+        if (ImGui::Combo("Tile order", &tile_order, tile_orders, 3)) {
+            tile_scheduler.SetOrder(static_cast<TileOrder>(tile_order));
+        }
+        if (ImGui::SliderFloat("Frame budget (ms)", &frame_budget_ms_, 5.0f, 100.0f, "%.0f")) {
+            tile_scheduler.SetFrameBudget(frame_budget_ms_);
+        }
+    }
+    bool collect_stats = gpu_renderer_->IsCollectingStats();
+    if (ImGui::Checkbox("Ray statistics", &collect_stats)) {
+        gpu_renderer_->SetStatsCollection(collect_stats);
+    }
     
     ImGui::Spacing();
     
@@ -989,11 +615,43 @@ void Application::RenderInfoOverlay() {
     if (!camera_enabled_) {
         ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Status: Active");
         ImGui::Text("Samples: %d", film_->GetSampleCount());
+        if (progressive_tiles_) {
+            ImGui::Text("Pass: %zu / %zu tiles, %zu per frame", tile_scheduler.GetPassPosition(),
+                        tile_scheduler.GetPassTileCount(), last_frame_tiles_);
+        }
+        if (image_exporter_.GetPendingCount() > 0) {
+            ImGui::Text("Saving %zu screenshot(s)...", image_exporter_.GetPendingCount());
+        }
     } else {
         ImGui::TextColored(ImVec4(0.7f, 0.7f, 0.7f, 1.0f), "Status: Paused");
         ImGui::Text("(Disable camera to accumulate)");
     }
 
+    // Ray statistics of the GPU path: the latest sample read back (one per
+    // frame) and totals since collection started
+    if (gpu_renderer_->IsCollectingStats() && !use_cpu_renderer_) {
+        const RayStats& frame = gpu_renderer_->GetLastSampleStats();
+        const RayStats& total = gpu_renderer_->GetTotalStats();
+        // Every traced pixel casts one camera ray, which also covers frames
+        // that render only some tiles
+        double pixel_count = std::max<double>(1.0, static_cast<double>(frame.counters[RayStats::kPrimary]));
+        ImGui::Spacing();
+        ImGui::SeparatorText("Ray Statistics");
+        ImGui::Text("Rays per pixel: %.2f", frame.GetRayCount() / pixel_count);
+        ImGui::Text("Total: %.1f M rays, %llu samples", total.GetRayCount() * 1e-6,
+                    static_cast<unsigned long long>(total.samples));
+        for (int i = 0; i < RayStats::kCounterCount; i++) {
+            ImGui::Text("  %-16s %7.3f /px %9.1f M", RayStats::GetCounterName(i), frame.counters[i] / pixel_count,
+                        total.counters[i] * 1e-6);
+        }
+        float hits_per_depth[RayStats::kDepthBins];
+        for (int i = 0; i < RayStats::kDepthBins; i++) {
+            hits_per_depth[i] = static_cast<float>(frame.depth_histogram[i] / pixel_count);
+        }
+        ImGui::PlotHistogram("Hits/px by depth", hits_per_depth, RayStats::kDepthBins, 0, nullptr, 0.0f, 1.0f,
+                             ImVec2(0.0f, 60.0f));
+    }
+
     ImGui::Spacing();
 
     // Controls hint
@@ -1139,56 +797,133 @@ void Application::RenderEntityPanel() {
     ImGui::End();
 }
 
+const std::vector<uint32_t>& Application::NextFrameTiles(bool* pass_complete) {
+    static const std::vector<uint32_t> kEveryPixel;
+    TileScheduler& tile_scheduler = film_->GetTileScheduler();
+
+    // Frame to frame, so the overlay and presentation count against the budget too
+    auto now = std::chrono::steady_clock::now();
+    double frame_ms = std::chrono::duration<double, std::milli>(now - last_frame_start_).count();
+    last_frame_start_ = now;
+    if (last_frame_tiles_ > 0) {
+        tile_scheduler.ReportFrameTime(frame_ms, last_frame_tiles_);
+    }
+
+    // A moving camera gets full frames; nothing accumulates there anyway
+    if (!progressive_tiles_ || camera_enabled_) {
+        last_frame_tiles_ = 0;
+        *pass_complete = true;
+        return kEveryPixel;
+    }
+    if (tile_scheduler.IsPassComplete() && tile_scheduler.GetOrder() == TileOrder::kPriority) {
+        UpdateTilePriorities();
+    }
+    const std::vector<uint32_t>& tiles = tile_scheduler.NextTiles(tile_scheduler.GetTilesPerFrame());
+    last_frame_tiles_ = tiles.size();
+    *pass_complete = tile_scheduler.IsPassComplete();
+    return tiles;
+}
+
+void Application::UpdateTilePriorities() {
+    TileScheduler& tile_scheduler = film_->GetTileScheduler();
+    if (!tile_errors_ || tile_errors_->GetTilesX() != tile_scheduler.GetTilesX() ||
+        tile_errors_->GetTilesY() != tile_scheduler.GetTilesY()) {
+        tile_errors_ = std::make_unique<AdaptiveScheduler>(film_->GetWidth(), film_->GetHeight(), 0.0f);
+    }
+    // Once per pass: a device film is downloaded, which needs the GPU idle
+    if (!film_->IsHostAccumulation()) {
+        core_->WaitGPU();
+    }
+    tile_errors_->Reset(); // estimate every tile, not only the unconverged ones
+    tile_errors_->Update(film_.get());
+    tile_scheduler.SetTileErrors(tile_errors_->GetTileErrors());
+}
+
+void Application::RenderSampleOnCpu() {
+    // A moved camera starts from an empty film; a still one keeps accumulating
+    CameraObject camera = MakeCameraObject();
+    if (camera_enabled_ && (camera.camera_to_world != last_cpu_camera_.camera_to_world ||
+                            camera.screen_to_camera != last_cpu_camera_.screen_to_camera)) {
+        film_->Reset();
+    }
+    last_cpu_camera_ = camera;
+
+    // Follows the film size, so a resize with the CPU renderer on stays in bounds
+    size_t pixel_count = static_cast<size_t>(film_->GetWidth()) * film_->GetHeight();
+    if (cpu_entity_ids_.size() != pixel_count) {
+        cpu_entity_ids_.assign(pixel_count, -1);
+    }
+
+    bool pass_complete = true;
+    cpu_renderer_->SetTiles(NextFrameTiles(&pass_complete));
+    cpu_renderer_->RenderSample(camera, film_.get(), cpu_entity_ids_.data());
+    if (pass_complete) {
+        film_->IncrementSampleCount();
+    } else {
+        film_->InvalidateOutput();
+    }
+    film_->UploadHostAccumulation();
+    gpu_renderer_->GetEntityIdImage()->UploadData(cpu_entity_ids_.data());
+}
+
 void Application::OnRender() {
     // Don't render if window is closing
     if (!alive_) {
         return;
     }
-    for (auto& entity : scene_->GetEntities()) {
-        entity->UpdateAnimation();
-    }
+    // Only entities that actually moved touch the TLAS
+    scene_->UpdateAnimation();
     scene_->UpdateInstances();
 
     std::unique_ptr<grassland::graphics::CommandContext> command_context;
     core_->CreateCommandContext(&command_context);
-    command_context->CmdClearImage(color_image_.get(), { {0.6, 0.7, 0.8, 1.0} });
-    
-    // Clear entity ID buffer with -1 (no entity)
-    command_context->CmdClearImage(entity_id_image_.get(), { {-1, 0, 0, 0} });
-    
-    command_context->CmdBindRayTracingProgram(program_.get());
-    command_context->CmdBindResources(0, scene_->GetTLAS(), grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(1, { color_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(2, { camera_object_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(3, { scene_->GetMaterialsBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(4, { hover_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(5, { entity_id_image_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(6, { film_->GetAccumulatedColorImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(7, { film_->GetAccumulatedSamplesImage() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(8, { scene_->GetVertexDataBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(9, { scene_->GetIndexDataBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    command_context->CmdBindResources(10, { scene_->GetEntityOffsetBuffer() }, grassland::graphics::BIND_POINT_RAYTRACING);
-    if (texture_data_buffer_) {
-    	command_context->CmdBindResources(11, { texture_data_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-	}
-	command_context->CmdBindResources(12, { point_lights_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-	command_context->CmdBindResources(13, { area_lights_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-	if (texture_info_buffer_) {
-		command_context->CmdBindResources(14, { texture_info_buffer_.get() }, grassland::graphics::BIND_POINT_RAYTRACING);
-	}
-	command_context->CmdDispatchRays(window_->GetWidth(), window_->GetHeight(), 1);
+
+    if (use_cpu_renderer_) {
+        RenderSampleOnCpu();
+        film_->DevelopToOutput();
+        grassland::graphics::Image* display_image = film_->GetOutputImage();
+        if (hovered_entity_id_ >= 0 && !camera_enabled_) {
+            ApplyHoverHighlight(command_context.get(), display_image);
+        }
+        window_->BeginImGuiFrame();
+        RenderInfoOverlay();
+        RenderEntityPanel();
+        window_->EndImGuiFrame();
+        command_context->CmdPresent(window_.get(), display_image);
+        core_->SubmitCommandContext(command_context.get());
+        return;
+    }
+
+    bool pass_complete = true;
+    gpu_renderer_->SetTiles(NextFrameTiles(&pass_complete), film_->GetTileScheduler().GetTilesX());
+    gpu_renderer_->RenderSample(command_context.get(), film_.get());
     
-    // When camera is disabled, increment sample count and use accumulated image
-    grassland::graphics::Image* display_image = color_image_.get();
+    // When camera is disabled, count finished passes and use accumulated image
+    grassland::graphics::Image* display_image = gpu_renderer_->GetColorImage();
+    bool highlight = hovered_entity_id_ >= 0 && !camera_enabled_;
     if (!camera_enabled_) {
-        film_->IncrementSampleCount();
-        film_->DevelopToOutput();
+        if (pass_complete) {
+            film_->IncrementSampleCount();
+        } else {
+            film_->InvalidateOutput();
+        }
+        // The develop pass goes into this frame's command list, unless the
+        // host fallback of the highlight has to read the output right away.
+        // Then the sample is submitted first, so the develop (and the entity
+        // IDs the highlight reads) include it; the rest of the frame is
+        // recorded into a fresh context.
+        bool host_highlight = highlight && !gpu_renderer_->HasHighlightPass();
+        if (host_highlight) {
+            core_->SubmitCommandContext(command_context.get());
+            core_->CreateCommandContext(&command_context);
+        }
+        film_->DevelopToOutput(host_highlight ? nullptr : command_context.get());
         display_image = film_->GetOutputImage();
     }
     
     // Apply hover highlighting as post-process (doesn't affect accumulation)
-    if (hovered_entity_id_ >= 0 && !camera_enabled_) {
-        ApplyHoverHighlight(display_image);
+    if (highlight) {
+        ApplyHoverHighlight(command_context.get(), display_image);
     }
     
     // Render ImGui overlay
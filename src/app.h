@@ -2,47 +2,17 @@
 #include "long_march.h"
 #include "Scene.h"
 #include "Film.h"
+#include "Light.h"
+#include "Camera.h"
+#include "Texture.h"
+#include "EnvironmentMap.h"
+#include "CpuRenderer.h"
+#include "GpuRenderer.h"
+#include "AdaptiveScheduler.h"
+#include "ImageExporter.h"
+#include <chrono>
 #include <memory>
 
-struct CameraObject {
-    glm::mat4 screen_to_camera;
-    glm::mat4 camera_to_world;
-};
-
-struct PointLight {
-    glm::vec3 position;
-    glm::vec3 color;
-    float intensity;
-
-    PointLight() : position(0.0f), color(1.0f), intensity(1.0f) {}
-    PointLight(const glm::vec3& pos, const glm::vec3& col, float intens) 
-        : position(pos), color(col), intensity(intens) {}
-};
-
-struct AreaLight {
-    glm::vec3 center;
-    glm::vec3 normal;
-    glm::vec3 left;
-    float width;
-    float height;
-    glm::vec3 color;
-    float intensity;
-
-    AreaLight() : center(0.0f), normal(0.0f, 1.0f, 0.0f), left(1.0f, 0.0f, 0.0f), 
-                  width(1.0f), height(1.0f), color(1.0f), intensity(1.0f) {}
-    AreaLight(const glm::vec3& cen, const glm::vec3& norm, const glm::vec3& lft, 
-              float w, float h, const glm::vec3& col, float intens)
-        : center(cen), normal(norm), left(lft), width(w), height(h), 
-          color(col), intensity(intens) {}
-};
-
-struct TextureInfo {
-    uint32_t width;
-    uint32_t height;
-    uint32_t offset;
-    uint32_t mip_levels;
-};
-
 class Application {
 public:
     Application(grassland::graphics::BackendAPI api = grassland::graphics::BACKEND_API_DEFAULT);
@@ -60,6 +30,9 @@ public:
         return alive_;
     }
 
+    // Scene description loaded by OnInit (defaults to scenes/default.json)
+    void SetSceneFile(const std::string& path) { scene_file_ = path; }
+
 private:
     // Core graphics objects
     std::shared_ptr<grassland::graphics::Core> core_;
@@ -67,62 +40,80 @@ private:
 
     // Scene management
     std::unique_ptr<Scene> scene_;
+    std::string scene_file_;
     
     // Film for accumulation
     std::unique_ptr<Film> film_;
 
-    // Camera
-    std::unique_ptr<grassland::graphics::Buffer> camera_object_buffer_;
-    
-    std::unique_ptr<grassland::graphics::Buffer> vertex_data_buffer_;
-    std::unique_ptr<grassland::graphics::Buffer> index_data_buffer_;
-    std::unique_ptr<grassland::graphics::Buffer> entity_offset_buffer_;
-    
-    // Hover info buffer
-    struct HoverInfo {
-        int hovered_entity_id;
-    };
-    std::unique_ptr<grassland::graphics::Buffer> hover_info_buffer_;
-
-    // Shaders
-    std::unique_ptr<grassland::graphics::Shader> raygen_shader_;
-    std::unique_ptr<grassland::graphics::Shader> miss_shader_;
-    std::unique_ptr<grassland::graphics::Shader> closest_hit_shader_;
-    
     // Textures
-    std::vector<std::unique_ptr<grassland::graphics::Image>> texture_images_;
-    std::unique_ptr<grassland::graphics::Buffer> texture_data_buffer_;
-    std::vector<TextureInfo> texture_infos_;
-    std::unique_ptr<grassland::graphics::Buffer> texture_info_buffer_;
+    TextureAtlas texture_atlas_;
+    EnvironmentMap environment_map_; // Sampling tables of the sky texture, built at load
     
     // Lightings
     std::vector<PointLight> point_lights_;
     std::vector<AreaLight> area_lights_;
-    std::unique_ptr<grassland::graphics::Buffer> point_lights_buffer_;
-    std::unique_ptr<grassland::graphics::Buffer> area_lights_buffer_;
     void Application::AddPointLight(const PointLight& light) {point_lights_.push_back(light);}
 	void Application::AddAreaLight(const AreaLight& light) {area_lights_.push_back(light);}
 
-    // Rendering
-    std::unique_ptr<grassland::graphics::Image> color_image_;
-    std::unique_ptr<grassland::graphics::Image> entity_id_image_; // Entity ID buffer for accurate picking
-    std::unique_ptr<grassland::graphics::RayTracingProgram> program_;
+    // Rendering (pipeline, camera/light/texture buffers, color and entity ID outputs)
+    std::unique_ptr<GpuRenderer> gpu_renderer_;
     bool alive_{ false };
 
+    // CPU reference renderer (toggled from the info overlay)
+    std::unique_ptr<CpuRenderer> cpu_renderer_;
+    std::vector<int32_t> cpu_entity_ids_; // sized to the film before each CPU sample
+    CameraObject last_cpu_camera_{}; // camera of the film's CPU samples, to reset when it changes
+    bool use_cpu_renderer_{ false };
+    void RenderSampleOnCpu(); // Trace one CPU sample and upload it to the film/ID images
+
+    // Hover picking through the CPU BVH, which needs no device readback; off
+    // takes the entity ID from the GPU pick ring instead (always on with the
+    // CPU renderer)
+    bool cpu_picking_{ true };
+    // Pixel and film sample count of the last pick ring read, so the pixel
+    // inspector only reads the ring again when either changes
+    int pick_x_{ -1 };
+    int pick_y_{ -1 };
+    int pick_sample_count_{ -1 };
+
+    // Light picked per shading point, shared by both renderers
+    LightSelection light_selection_{ LightSelection::kBvh };
+    // Sky lighting through environment map sampling instead of the ambient term
+    bool environment_light_{ false };
+    SamplerType sampler_type_{ SamplerType::kSobol };
+    // Accumulate every film AOV layer, so EXR screenshots carry them
+    bool film_aovs_{ false };
+
+    // Progressive tiles: while accumulating, each frame samples only the
+    // tiles that fit the frame budget (the film's TileScheduler)
+    bool progressive_tiles_{ false };
+    float frame_budget_ms_{ 33.0f };
+    std::chrono::steady_clock::time_point last_frame_start_;
+    size_t last_frame_tiles_{ 0 }; // tiles the previous frame rendered, 0 for a full frame
+    std::unique_ptr<AdaptiveScheduler> tile_errors_; // error estimates for TileOrder::kPriority
+    // Tiles for this frame's sample (empty: every pixel); true in *pass_complete
+    // when they finish a pass, so the film's sample count may advance
+    const std::vector<uint32_t>& NextFrameTiles(bool* pass_complete);
+    void UpdateTilePriorities(); // Rank the next pass by each tile's current error
+
     void ProcessInput(); // Helper function for keyboard input
+    CameraObject MakeCameraObject() const; // Camera matrices for the current view and window size
 
 
     glm::vec3 camera_pos_;
     glm::vec3 camera_front_;
     glm::vec3 camera_up_;
     float camera_speed_;
+    float camera_fov_; // Vertical field of view in degrees
 
 
     void OnMouseMove(double xpos, double ypos); // Mouse event handler
     void OnMouseButton(int button, int action, int mods, double xpos, double ypos); // Mouse button event handler
     void RenderInfoOverlay(); // Render the info overlay
-    void ApplyHoverHighlight(grassland::graphics::Image* image); // Apply hover highlighting as post-process
-    void SaveAccumulatedOutput(const std::string& filename); // Save accumulated output to PNG file
+    // Apply hover highlighting as post-process, limited to the entity's screen rectangle
+    void ApplyHoverHighlight(grassland::graphics::CommandContext* command_context, grassland::graphics::Image* image);
+    void SaveAccumulatedOutput(const std::string& filename); // Queue the accumulated output for saving (PNG or EXR)
+    ImageExporter image_exporter_; // Encodes screenshots off the render thread
 
     float yaw_;
     float pitch_;
@@ -1,9 +1,30 @@
 #include "app.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
+#include "DistributedRenderer.h"
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  if (!args.empty() && args[0] == "--benchmark") {
+    return RunBenchmark(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args[0] == "--worker") {
+    return RunWorker(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
+  if (!args.empty() && args[0] == "--batch") {
+    BatchSettings settings;
+    if (!ParseBatchSettings(std::vector<std::string>(args.begin() + 1, args.end()), &settings)) {
+      return 1;
+    }
+    return RunBatch(settings);
+  }
 
-int main() {
   // Create only one application instance to avoid ImGui conflicts
   // Change BACKEND_API_D3D12 to BACKEND_API_VULKAN if you prefer Vulkan
   Application app{grassland::graphics::BACKEND_API_D3D12};
+  if (args.size() >= 2 && args[0] == "--scene") {
+    app.SetSceneFile(args[1]);
+  }
 
   app.OnInit();
 
@@ -0,0 +1,20 @@
+// Zero the ray statistics slot the coming sample counts into. Recorded into
+// the sample's command list ahead of DispatchRays, so the clear runs on the
+// queue after the sample that used the slot before, without a host write.
+
+// Leading fields of RenderSettings in shader.hlsl
+struct StatsSettings {
+    uint write_entity_ids;
+    uint collect_stats;
+    uint stats_slot;
+};
+
+ConstantBuffer<StatsSettings> render_settings : register(b0, space0);
+RWByteAddressBuffer ray_stats : register(u0, space1);
+
+static const uint RAY_STAT_SLOT_SIZE = 16;
+
+[numthreads(RAY_STAT_SLOT_SIZE, 1, 1)]
+void ClearStatsMain(uint3 id : SV_DispatchThreadID) {
+    ray_stats.Store((render_settings.stats_slot * RAY_STAT_SLOT_SIZE + id.x) * 4, 0);
+}
@@ -0,0 +1,17 @@
+// Develop pass: average the accumulated color by each pixel's sample count.
+// Runs on the device so the accumulation never leaves video memory.
+
+RWTexture2D<float4> accumulated_color : register(u0, space0);
+RWTexture2D<int> accumulated_samples : register(u0, space1);
+RWTexture2D<float4> output_image : register(u0, space2);
+
+[numthreads(8, 8, 1)]
+void DevelopMain(uint3 id : SV_DispatchThreadID) {
+    uint width, height;
+    output_image.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height) {
+        return;
+    }
+    int samples = accumulated_samples[id.xy];
+    output_image[id.xy] = samples > 0 ? accumulated_color[id.xy] / float(samples) : float4(0, 0, 0, 0);
+}
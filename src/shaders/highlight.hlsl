@@ -0,0 +1,24 @@
+// Hover highlight: blend the pixels of one entity towards white. Dispatched
+// over the entity's screen rectangle only, so its cost follows the entity's
+// coverage rather than the frame size.
+
+struct HighlightInfo {
+    int2 rect_min;
+    int2 rect_max;
+    int entity_id;
+    float factor;
+};
+
+ConstantBuffer<HighlightInfo> highlight_info : register(b0, space0);
+RWTexture2D<int> entity_ids : register(u0, space1);
+RWTexture2D<float4> image : register(u0, space2);
+
+[numthreads(8, 8, 1)]
+void HighlightMain(uint3 id : SV_DispatchThreadID) {
+    int2 pixel = highlight_info.rect_min + int2(id.xy);
+    if (any(pixel >= highlight_info.rect_max) || entity_ids[pixel] != highlight_info.entity_id) {
+        return;
+    }
+    float4 color = image[pixel];
+    image[pixel] = float4(lerp(color.rgb, float3(1, 1, 1), highlight_info.factor), color.a);
+}
@@ -33,6 +33,15 @@ struct Material {
 };
 struct HoverInfo {
     int hovered_entity_id;
+    int2 pick_pixel; // pixel whose hit is recorded in pick_results, (-1, -1) for none
+    uint pick_slot;  // readback ring slot written by this dispatch
+};
+// Matches GpuRenderer::PickResult
+struct PickResult {
+    int entity_id;
+    int sample_count;
+    int2 padding;
+    float4 accumulated_color;
 };
 
 RaytracingAccelerationStructure as : register(t0, space0);
@@ -43,6 +52,88 @@ ConstantBuffer<HoverInfo> hover_info : register(b0, space4);
 RWTexture2D<int> entity_id_output : register(u0, space5);
 RWTexture2D<float4> accumulated_color : register(u0, space6);
 RWTexture2D<int> accumulated_samples : register(u0, space7);
+RWStructuredBuffer<PickResult> pick_results : register(u0, space15);
+// Per-dispatch switches, matches GpuRenderer::RenderSettings
+struct RenderSettings {
+    uint write_entity_ids; // fill entity_id_output (only the hover highlight reads it)
+    uint collect_stats;    // count rays into ray_stats[stats_slot]
+    uint stats_slot;
+    uint point_light_count; // lengths of point_lights and area_lights; both 0 when no light emits
+    uint area_light_count;
+    uint light_selection;   // LIGHT_SELECTION_*, matches LightSelection in Light.h
+    uint environment_light; // sample the sky instead of the ambient term
+    uint environment_width; // size of the sky's sampling tables, 0 when there are none
+    uint environment_height;
+    uint sampler_type;      // SAMPLER_*, matches SamplerType in PathSampler.h
+    uint tiles_x;           // width of the tile grid
+    uint tile_count;        // entries in tiles, 0 samples every pixel
+    uint sample_offset;     // added to the sample index of every pixel
+    uint aovs;              // AOV_* bits of the layers to write, matches Film::Aov
+};
+ConstantBuffer<RenderSettings> render_settings : register(b0, space16);
+RWByteAddressBuffer ray_stats : register(u0, space17);
+
+// Sum of squared sample luminances for the adaptive sampling error estimate
+RWTexture2D<float> accumulated_moment : register(u0, space22);
+// Tiles to sample (row-major indices into the TILE_SIZE grid, TileScheduler.h),
+// packed tiles_x to a row of the dispatch
+StructuredBuffer<uint> tiles : register(t0, space23);
+static const uint TILE_SIZE = 16;
+
+// Primary hit AOVs (Film.h): albedo and normal are summed per sample like the
+// color, depth sums the hit distance in x and the hit count in y, the instance
+// ID keeps the first entity hit. Spaces of layers
+// that are not in render_settings.aovs hold 1x1 stand-ins and are never written.
+RWTexture2D<float4> aov_albedo : register(u0, space24);
+RWTexture2D<float4> aov_normal : register(u0, space25);
+RWTexture2D<float4> aov_depth : register(u0, space26);
+RWTexture2D<int> aov_instance_id : register(u0, space27);
+static const uint AOV_ALBEDO = 1;
+static const uint AOV_NORMAL = 2;
+static const uint AOV_DEPTH = 4;
+static const uint AOV_INSTANCE_ID = 8;
+
+// Film pixel traced by this invocation: the dispatch index itself, or its
+// place in the listed tile. Slots past tile_count repeat the last tile, so
+// the ray generation shader must skip them.
+uint2 GetPixelCoords() {
+    uint2 index = DispatchRaysIndex().xy;
+    if (render_settings.tile_count == 0) {
+        return index;
+    }
+    uint2 slot = index / TILE_SIZE;
+    uint tile = tiles[min(slot.y * render_settings.tiles_x + slot.x, render_settings.tile_count - 1)];
+    return uint2(tile % render_settings.tiles_x, tile / render_settings.tiles_x) * TILE_SIZE + index % TILE_SIZE;
+}
+
+// Ray statistics, one slot of RAY_STAT_SLOT_SIZE counters per sample.
+// Matches RayStats in RayStats.h.
+static const uint RAY_STAT_PRIMARY = 0;
+static const uint RAY_STAT_SHADOW = 1;
+static const uint RAY_STAT_REFLECTION = 2;
+static const uint RAY_STAT_REFRACTION = 3;
+static const uint RAY_STAT_SCATTER = 4;
+static const uint RAY_STAT_TEST = 5;             // subsurface distance probes
+static const uint RAY_STAT_RUSSIAN_ROULETTE = 6; // paths ended by Russian roulette
+static const uint RAY_STAT_DEPTH = 7;            // shaded hits per path depth, RAY_STAT_DEPTH_BINS bins
+static const uint RAY_STAT_DEPTH_BINS = 8;
+static const uint RAY_STAT_SLOT_SIZE = 16;
+
+// Lanes of a wave may count different statistics: each distinct one costs a
+// single atomic for the whole wave instead of one per lane
+void CountStat(uint stat) {
+    if (render_settings.collect_stats == 0) return;
+    for (;;) {
+        uint first = WaveReadLaneFirst(stat);
+        if (first == stat) {
+            uint count = WaveActiveCountBits(true);
+            if (WaveIsFirstLane()) {
+                ray_stats.InterlockedAdd((render_settings.stats_slot * RAY_STAT_SLOT_SIZE + stat) * 4, count);
+            }
+            break;
+        }
+    }
+}
 
 uint RandomSeed(uint2 pixel, uint depth, uint frame) {return (pixel.x * 73856093u) ^ (pixel.y * 19349663u) ^ (depth * 83492789u) ^ (frame * 735682483u);}
 float Random(inout uint seed) {
@@ -52,6 +143,96 @@ float Random(inout uint seed) {
     return float(result) / 4294967295.0;
 }
 
+// Random numbers per decision, same as PathSampler in PathSampler.h: the
+// camera ray owns SAMPLE_PIXEL_DIMENSIONS and every path depth a block of
+// SAMPLE_DIMENSIONS_PER_BOUNCE at the offsets below
+static const uint SAMPLER_RANDOM = 0;
+static const uint SAMPLER_SOBOL = 1;
+static const uint SAMPLER_BLUE_NOISE = 2;
+static const uint SAMPLE_PIXEL_DIMENSIONS = 2;
+static const uint SAMPLE_DIMENSIONS_PER_BOUNCE = 10;
+static const uint SAMPLE_MAX_DEPTH = 7;
+static const uint SAMPLE_LIGHT_SELECT = 0;
+static const uint SAMPLE_LIGHT_POSITION = 1; // 2 dimensions
+static const uint SAMPLE_ENVIRONMENT = 3;    // 2 dimensions
+static const uint SAMPLE_RUSSIAN_ROULETTE = 5;
+static const uint SAMPLE_LOBE = 6;
+static const uint SAMPLE_SSS_DISTANCE = 7;
+static const uint SAMPLE_SCATTER = 8;        // 2 dimensions
+static const uint BLUE_NOISE_SIZE = 64;
+
+StructuredBuffer<float> blue_noise_mask : register(t0, space21);
+
+struct PathSampler {
+    uint2 pixel;
+    uint index;
+    uint first_dimension;
+    uint seed; // PCG state for SAMPLER_RANDOM
+};
+PathSampler CreateCameraSampler(uint2 pixel, uint frame) {
+    PathSampler path_sampler;
+    path_sampler.pixel = pixel;
+    path_sampler.index = frame;
+    path_sampler.first_dimension = 0;
+    path_sampler.seed = RandomSeed(pixel, 0, frame);
+    return path_sampler;
+}
+PathSampler CreateBounceSampler(uint2 pixel, uint depth, uint frame) {
+    PathSampler path_sampler;
+    path_sampler.pixel = pixel;
+    path_sampler.index = frame;
+    path_sampler.first_dimension = SAMPLE_PIXEL_DIMENSIONS + min(depth, SAMPLE_MAX_DEPTH) * SAMPLE_DIMENSIONS_PER_BOUNCE;
+    path_sampler.seed = RandomSeed(pixel, depth, frame);
+    return path_sampler;
+}
+uint HashUint(uint x) {
+    x ^= x >> 16;
+    x *= 0x7FEB352D;
+    x ^= x >> 15;
+    x *= 0x846CA68B;
+    x ^= x >> 16;
+    return x;
+}
+// Owen scrambling as a hash over the reversed bits (Burley 2020)
+uint NestedUniformScramble(uint x, uint seed) {
+    x = reversebits(x);
+    x += seed;
+    x ^= x * 0x6C50B47C;
+    x ^= x * 0xB82F1E52;
+    x ^= x * 0xC7AFE638;
+    x ^= x * 0x8D22F6E6;
+    return reversebits(x);
+}
+uint Sobol(uint index, uint dimension) {
+    if (dimension == 0) return reversebits(index);
+    uint result = 0;
+    for (uint v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+        if (index & 1) result ^= v;
+    }
+    return result;
+}
+// Dimension pairs from 2D Sobol, each pair with its own shuffle and scramble
+float SobolOwen(uint index, uint dimension, uint seed) {
+    uint pair_seed = HashUint(seed ^ HashUint(dimension >> 1));
+    uint shuffled = NestedUniformScramble(index, pair_seed);
+    uint value = Sobol(shuffled, dimension & 1);
+    return (NestedUniformScramble(value, HashUint(pair_seed + (dimension & 1) + 1)) >> 8) * (1.0 / 16777216.0);
+}
+float SampleDimension(inout PathSampler path_sampler, uint offset) {
+    if (render_settings.sampler_type == SAMPLER_RANDOM) return Random(path_sampler.seed);
+    uint dimension = path_sampler.first_dimension + offset;
+    if (render_settings.sampler_type == SAMPLER_SOBOL) {
+        return SobolOwen(path_sampler.index, dimension, HashUint((path_sampler.pixel.x * 73856093u) ^ (path_sampler.pixel.y * 19349663u)));
+    }
+    // One sequence for all pixels, shifted per pixel by the blue-noise mask
+    float u = SobolOwen(path_sampler.index, dimension, 0);
+    uint offset_hash = HashUint(dimension + 1);
+    uint mask_x = (path_sampler.pixel.x + offset_hash) % BLUE_NOISE_SIZE;
+    uint mask_y = (path_sampler.pixel.y + (offset_hash >> 8)) % BLUE_NOISE_SIZE;
+    u += blue_noise_mask[mask_y * BLUE_NOISE_SIZE + mask_x];
+    return u >= 1.0 ? u - 1.0 : u;
+}
+
 // =====================================================================================================================================
 // ================================================== texture related ==================================================================
 // =====================================================================================================================================
@@ -219,15 +400,46 @@ struct AreaLight {
 StructuredBuffer<PointLight> point_lights : register(t0, space12);
 StructuredBuffer<AreaLight> area_lights : register(t0, space13);
 
+// Light BVH built by LightBvh on the host; see LightBvh.h for the layout
+struct LightNode {
+    float3 bounds_min;
+    float power;
+    float3 bounds_max;
+    uint child;
+};
+StructuredBuffer<LightNode> light_nodes : register(t0, space18);
+
+static const uint LIGHT_LEAF_FLAG = 0x80000000;
+static const uint LIGHT_AREA_FLAG = 0x40000000;
+static const uint LIGHT_INDEX_MASK = 0x3FFFFFFF;
+static const uint NO_LIGHT = 0xFFFFFFFF;
+
+// Alias table entry, matches AliasTable::Entry
+struct AliasEntry {
+    float probability;
+    uint alias;
+    float pdf;
+    uint padding;
+};
+// Power of every light, point lights first
+StructuredBuffer<AliasEntry> light_alias_table : register(t0, space19);
+// Sky texels: environment_height row entries, then environment_width entries per row (EnvironmentMap.h)
+StructuredBuffer<AliasEntry> environment_alias_table : register(t0, space20);
+static const uint ENVIRONMENT_TEXTURE = 3;
+static const int ENVIRONMENT_SHADOW_LAYERS = 8;
+
+static const uint LIGHT_SELECTION_BVH = 0;
+static const uint LIGHT_SELECTION_POWER = 1;
+
+#define PI 3.14159265358979323846
+
 static const float3 AMBIENT_COLOR = float3(1.0, 1.0, 1.0);
 static const float AMBIENT_INTENSITY = 0.2;
 static const int AREA_LIGHT_SAMPLES = 1;
-static const int NUMBER_OF_POINT_LIGHTS = 1;
-static const int NUMBER_OF_AREA_LIGHTS = 4;
 
-bool RussianRoulette(float throughput, inout uint seed) {
+bool RussianRoulette(float throughput, inout PathSampler path_sampler) {
     if (throughput < 0.05) {
-        float r = Random(seed);
+        float r = SampleDimension(path_sampler, SAMPLE_RUSSIAN_ROULETTE);
         float continue_prob = 1.0 - exp(-throughput * 15.0);
         continue_prob = clamp(continue_prob, 0.2, 0.95);
         if (r > continue_prob) return false;
@@ -257,6 +469,7 @@ float TestShadow(float3 hit_point, float3 light_pos) {
         shadow_ray.Direction = light_dir;
         shadow_ray.TMin = 0.001;
         shadow_ray.TMax = total_distance - current_distance - 0.001;
+        CountStat(RAY_STAT_SHADOW);
         TraceRay(as, RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH, 
                  0xFF, 0, 0, 0, shadow_ray, shadow_payload);
         if (!shadow_payload.hit) break;
@@ -292,6 +505,79 @@ float3 CalculatePointLightContribution(float3 hit_point, float3 normal, Material
     float3 specular = attenuation * light.color * mat.base_color * specular_intensity * metallic_factor;
     return shadow_factor * (diffuse + specular);
 }
+// Like TestShadow, but open-ended: translucent occluders only dim the sky
+float TestEnvironmentShadow(float3 origin, float3 direction) {
+    float transmission_factor = 1.0;
+    float3 ray_origin = origin;
+    for (int layer = 0; layer < ENVIRONMENT_SHADOW_LAYERS; layer++) {
+        RayPayload shadow_payload;
+        shadow_payload.color = float3(0, 0, 0);
+        shadow_payload.hit = false;
+        shadow_payload.instance_id = 0xFFFFFFFF;
+        shadow_payload.hit_distance = 10000.0;
+        shadow_payload.depth = 100;
+        shadow_payload.throughput = 0.0;
+        shadow_payload.inside_material = false;
+        RayDesc shadow_ray;
+        shadow_ray.Origin = ray_origin;
+        shadow_ray.Direction = direction;
+        shadow_ray.TMin = 0.001;
+        shadow_ray.TMax = 10000.0;
+        CountStat(RAY_STAT_SHADOW);
+        TraceRay(as, RAY_FLAG_FORCE_OPAQUE | RAY_FLAG_ACCEPT_FIRST_HIT_AND_END_SEARCH,
+                 0xFF, 0, 0, 0, shadow_ray, shadow_payload);
+        if (!shadow_payload.hit) return transmission_factor;
+        Material hit_mat = materials[shadow_payload.instance_id];
+        if (hit_mat.shadow_factor <= 0.0) return 0.0;
+        transmission_factor *= hit_mat.shadow_factor;
+        ray_origin = ray_origin + direction * (shadow_payload.hit_distance + 0.001);
+    }
+    return transmission_factor;
+}
+// Alias table lookup over count entries starting at first, same as
+// AliasTable::Sample; remapped_u is a fresh uniform number left over from u
+uint SampleEnvironmentAlias(uint first, uint count, float u, out float pdf, out float remapped_u) {
+    float scaled = u * count;
+    uint index = min((uint)scaled, count - 1);
+    float fraction = min(scaled - index, 0.99999994);
+    AliasEntry entry = environment_alias_table[first + index];
+    if (fraction < entry.probability) {
+        remapped_u = fraction / entry.probability;
+    } else {
+        remapped_u = (fraction - entry.probability) / (1.0 - entry.probability);
+        index = entry.alias;
+    }
+    remapped_u = min(remapped_u, 0.99999994);
+    pdf = environment_alias_table[first + index].pdf;
+    return index;
+}
+// Sky direction drawn by luminance, same as EnvironmentMap::Sample; pdf per solid angle
+float3 SampleEnvironment(float2 u, out float pdf) {
+    uint width = render_settings.environment_width;
+    uint height = render_settings.environment_height;
+    float row_pdf, column_pdf, jitter_y, jitter_x;
+    uint y = SampleEnvironmentAlias(0, height, u.x, row_pdf, jitter_y);
+    uint x = SampleEnvironmentAlias(height + y * width, width, u.y, column_pdf, jitter_x);
+    float2 uv = float2((x + jitter_x) / width, (y + jitter_y) / height);
+    float phi = (uv.x - 0.5) * 2.0 * PI;
+    float elevation = (0.5 - uv.y) * PI;
+    float cos_elevation = cos(elevation);
+    pdf = cos_elevation > 0.0 ? row_pdf * column_pdf * width * height / (2.0 * PI * PI * cos_elevation) : 0.0;
+    return float3(cos_elevation * cos(phi), sin(elevation), cos_elevation * sin(phi));
+}
+float3 CalculateEnvironmentLight(float3 hit_point, float3 normal, Material mat, inout PathSampler path_sampler) {
+    // One sky direction drawn from the environment map; Lambertian response
+    float2 random_uv = float2(SampleDimension(path_sampler, SAMPLE_ENVIRONMENT), SampleDimension(path_sampler, SAMPLE_ENVIRONMENT + 1));
+    float pdf;
+    float3 direction = SampleEnvironment(random_uv, pdf);
+    float ndotl = dot(normal, direction);
+    if (pdf <= 0.0 || ndotl <= 0.0) return float3(0, 0, 0);
+    float visibility = TestEnvironmentShadow(hit_point + normal * 0.001, direction);
+    if (visibility <= 0.0) return float3(0, 0, 0);
+    float2 uv = float2(0.5 + atan2(direction.z, direction.x) / (2.0 * PI), 0.5 - asin(direction.y) / PI);
+    float3 radiance = GetTextureColor(ENVIRONMENT_TEXTURE, uv);
+    return visibility * radiance * mat.base_color * ((1.0 - mat.metallic) * ndotl / (PI * pdf));
+}
 float3 SampleAreaLight(AreaLight light, float2 random_uv) {
     float3 up = normalize(cross(light.normal, light.left));
     float3 left = light.left;
@@ -299,10 +585,10 @@ float3 SampleAreaLight(AreaLight light, float2 random_uv) {
     float v = (random_uv.y - 0.5) * light.height;
     return light.center + up * u + left * v;
 }
-float3 CalculateAreaLightContribution(float3 hit_point, float3 normal, Material mat, float3 view_dir, AreaLight light, inout uint seed) {
+float3 CalculateAreaLightContribution(float3 hit_point, float3 normal, Material mat, float3 view_dir, AreaLight light, inout PathSampler path_sampler) {
     float3 total_contribution = float3(0, 0, 0);
     for (int i = 0; i < AREA_LIGHT_SAMPLES; i++) {
-        float2 random_uv = float2(Random(seed), Random(seed));
+        float2 random_uv = float2(SampleDimension(path_sampler, SAMPLE_LIGHT_POSITION), SampleDimension(path_sampler, SAMPLE_LIGHT_POSITION + 1));
         float3 light_sample = SampleAreaLight(light, random_uv);
         PointLight sample_light;
         sample_light.position = light_sample;
@@ -312,17 +598,77 @@ float3 CalculateAreaLightContribution(float3 hit_point, float3 normal, Material
     }
     return total_contribution;
 }
-float3 CalculateDirectLight(float3 hit_point, float3 normal, Material mat, float3 view_dir, inout uint seed) {
+float LightNodeImportance(LightNode node, float3 position) {
+    float3 center = (node.bounds_min + node.bounds_max) * 0.5;
+    float3 half_extent = (node.bounds_max - node.bounds_min) * 0.5;
+    float3 offset = position - center;
+    float distance2 = dot(offset, offset);
+    float radius2 = dot(half_extent, half_extent);
+    return node.power / max(max(distance2, radius2), 1e-4);
+}
+// Walk one path down the light BVH, same as LightBvh::Sample
+uint SampleLightBvh(float3 position, float u, out float pdf) {
+    pdf = 0.0;
+    uint node = 0;
+    float probability = 1.0;
+    while ((light_nodes[node].child & LIGHT_LEAF_FLAG) == 0) {
+        uint left = light_nodes[node].child;
+        float left_importance = LightNodeImportance(light_nodes[left], position);
+        float right_importance = LightNodeImportance(light_nodes[left + 1], position);
+        float total = left_importance + right_importance;
+        if (total <= 0.0) return NO_LIGHT;
+        float left_probability = left_importance / total;
+        if (u < left_probability) {
+            node = left;
+            probability *= left_probability;
+            u = u / left_probability;
+        } else {
+            node = left + 1;
+            probability *= 1.0 - left_probability;
+            u = (u - left_probability) / (1.0 - left_probability);
+        }
+        u = min(u, 0.99999994);
+    }
+    pdf = probability;
+    return light_nodes[node].child;
+}
+// Pick a light by emitted power alone, same as AliasTable::Sample
+uint SampleLightPower(float u, out float pdf) {
+    uint light_count = render_settings.point_light_count + render_settings.area_light_count;
+    float scaled = u * light_count;
+    uint index = min((uint)scaled, light_count - 1);
+    if (scaled - index >= light_alias_table[index].probability) {
+        index = light_alias_table[index].alias;
+    }
+    pdf = light_alias_table[index].pdf;
+    if (index < render_settings.point_light_count) return LIGHT_LEAF_FLAG | index;
+    return LIGHT_LEAF_FLAG | LIGHT_AREA_FLAG | (index - render_settings.point_light_count);
+}
+float3 CalculateDirectLight(float3 hit_point, float3 normal, Material mat, float3 view_dir, inout PathSampler path_sampler) {
     float3 total_light = float3(0, 0, 0);
-    float3 ambient = AMBIENT_COLOR * AMBIENT_INTENSITY * mat.base_color;
-    total_light += ambient;
-    for (uint i = 0; i < NUMBER_OF_POINT_LIGHTS; i++) {
-        PointLight light = point_lights[i];
-        total_light += CalculatePointLightContribution(hit_point, normal, mat, view_dir, light);
+    if (render_settings.environment_light != 0 && render_settings.environment_width > 0) {
+        total_light += CalculateEnvironmentLight(hit_point, normal, mat, path_sampler);
+    } else {
+        float3 ambient = AMBIENT_COLOR * AMBIENT_INTENSITY * mat.base_color;
+        total_light += ambient;
     }
-    for (uint i = 0; i < NUMBER_OF_AREA_LIGHTS; i++) {
-        AreaLight light = area_lights[i];
-        total_light += CalculateAreaLightContribution(hit_point, normal, mat, view_dir, light, seed);
+    // One light per shading point, chosen by the light BVH and weighted by 1 / pdf
+    if (render_settings.point_light_count + render_settings.area_light_count == 0) return total_light;
+    float light_pdf;
+    uint light;
+    if (render_settings.light_selection == LIGHT_SELECTION_POWER) {
+        light = SampleLightPower(SampleDimension(path_sampler, SAMPLE_LIGHT_SELECT), light_pdf);
+    } else {
+        light = SampleLightBvh(hit_point, SampleDimension(path_sampler, SAMPLE_LIGHT_SELECT), light_pdf);
+    }
+    if (light == NO_LIGHT || light_pdf <= 0.0) return total_light;
+    uint light_index = light & LIGHT_INDEX_MASK;
+    if (light & LIGHT_AREA_FLAG) {
+        if (light_index >= render_settings.area_light_count) return total_light;
+        total_light += CalculateAreaLightContribution(hit_point, normal, mat, view_dir, area_lights[light_index], path_sampler) / light_pdf;
+    } else {
+        if (light_index >= render_settings.point_light_count) return total_light;
+        total_light += CalculatePointLightContribution(hit_point, normal, mat, view_dir, point_lights[light_index]) / light_pdf;
     }
     return total_light;
 }
@@ -332,16 +678,24 @@ float3 CalculateDirectLight(float3 hit_point, float3 normal, Material mat, float
 // =====================================================================================================================================
 
 #define MAX_DEPTH 7
-#define PI 3.14159265358979323846
 
 [shader("raygeneration")]
 void RayGenMain() {
-    uint2 pixel_coords = DispatchRaysIndex().xy;
-    uint pixel_seed = RandomSeed(pixel_coords, 0, accumulated_samples[pixel_coords]);
-    float random_x = Random(pixel_seed);
-    float random_y = Random(pixel_seed);
-    float2 pixel_center = (float2)DispatchRaysIndex() + float2(random_x, random_y);
-    float2 uv = pixel_center / float2(DispatchRaysDimensions().xy);
+    uint2 image_size;
+    output.GetDimensions(image_size.x, image_size.y);
+    uint2 slot = DispatchRaysIndex().xy / TILE_SIZE;
+    if (render_settings.tile_count != 0 && slot.y * render_settings.tiles_x + slot.x >= render_settings.tile_count) {
+        return;
+    }
+    uint2 pixel_coords = GetPixelCoords();
+    if (any(pixel_coords >= image_size)) {
+        return; // edge tiles are clipped to the film
+    }
+    PathSampler camera_sampler = CreateCameraSampler(pixel_coords, accumulated_samples[pixel_coords] + render_settings.sample_offset);
+    float random_x = SampleDimension(camera_sampler, 0);
+    float random_y = SampleDimension(camera_sampler, 1);
+    float2 pixel_center = (float2)pixel_coords + float2(random_x, random_y);
+    float2 uv = pixel_center / float2(image_size);
     uv.y = 1.0 - uv.y;
     float2 d = uv * 2.0 - 1.0;
     float4 origin = mul(camera_info.camera_to_world, float4(0, 0, 0, 1));
@@ -354,19 +708,35 @@ void RayGenMain() {
     RayDesc ray;
     ray.Origin = origin.xyz; ray.Direction = normalize(direction.xyz);
     ray.TMin = 0.001; ray.TMax = 10000.0;
+    CountStat(RAY_STAT_PRIMARY);
     TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, ray, payload);
     output[pixel_coords] = float4(payload.color, 1);
-    RayPayload test_payload;
-    test_payload.color = float3(0, 0, 0); test_payload.hit = false;
-    test_payload.instance_id = 0; test_payload.hit_distance = 10000.0;
-    test_payload.depth = 100; test_payload.throughput = 0.0;
-    test_payload.inside_material = false;
-    TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, ray, test_payload);
-    entity_id_output[pixel_coords] = test_payload.hit ? (int)test_payload.instance_id : -1;
+    // ClosestHitMain records the primary hit in the payload before shading,
+    // and secondary rays use payloads of their own
+    int entity_id = payload.hit ? (int)payload.instance_id : -1;
+    if (render_settings.write_entity_ids != 0) {
+        entity_id_output[pixel_coords] = entity_id;
+    }
+    if ((render_settings.aovs & AOV_DEPTH) != 0 && payload.hit) {
+        aov_depth[pixel_coords] += float4(payload.hit_distance, 1, 0, 0);
+    }
+    if ((render_settings.aovs & AOV_INSTANCE_ID) != 0 && entity_id >= 0 && aov_instance_id[pixel_coords] < 0) {
+        aov_instance_id[pixel_coords] = entity_id;
+    }
     float4 prev_color = accumulated_color[pixel_coords];
     int prev_samples = accumulated_samples[pixel_coords];
     accumulated_color[pixel_coords] = prev_color + float4(payload.color, 1);
     accumulated_samples[pixel_coords] = prev_samples + 1;
+    float luminance = dot(payload.color, float3(0.2126, 0.7152, 0.0722));
+    accumulated_moment[pixel_coords] += luminance * luminance;
+    if (all(int2(pixel_coords) == hover_info.pick_pixel)) {
+        PickResult pick;
+        pick.entity_id = entity_id;
+        pick.sample_count = prev_samples + 1;
+        pick.padding = int2(0, 0);
+        pick.accumulated_color = prev_color + float4(payload.color, 1);
+        pick_results[hover_info.pick_slot] = pick;
+    }
 }
 [shader("miss")]
 void MissMain(inout RayPayload payload) {
@@ -381,7 +751,7 @@ void MissMain(inout RayPayload payload) {
     float u = 0.5 + atan2(ray_dir.z, ray_dir.x) / (2.0 * PI);
     float v = 0.5 - asin(ray_dir.y) / PI;
     float2 uv = float2(u, v);
-    float3 sky_color = GetTextureColor(3, uv);
+    float3 sky_color = GetTextureColor(ENVIRONMENT_TEXTURE, uv);
     payload.color = sky_color * payload.throughput;
     payload.hit = false;
     payload.hit_distance = 10000.0;
@@ -395,6 +765,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
     payload.instance_id = material_idx; 
     payload.hit_distance = RayTCurrent();
     if (payload.depth == 100) return; // test ray
+    CountStat(RAY_STAT_DEPTH + min(payload.depth, RAY_STAT_DEPTH_BINS - 1));
     float3 hit_point = WorldRayOrigin() + WorldRayDirection() * payload.hit_distance;
     float3 norm = calcNormal(material_idx, primitive_index, hit_point);
     float3 view_dir = normalize(-WorldRayDirection());
@@ -414,8 +785,8 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
         if (dot(new_normal, view_dir) < 0.0) new_normal = -new_normal;
         norm = new_normal;
     }
-    uint2 pixel_coords = DispatchRaysIndex().xy;
-    uint seed = RandomSeed(pixel_coords, payload.depth, accumulated_samples[pixel_coords]);
+    uint2 pixel_coords = GetPixelCoords();
+    PathSampler path_sampler = CreateBounceSampler(pixel_coords, payload.depth, accumulated_samples[pixel_coords] + render_settings.sample_offset);
     
     if (material_idx == 100) {// mipmap (hard-coded)
         float3 camera_pos = WorldRayOrigin();
@@ -436,8 +807,20 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
         float height = mat.texture_info.c9 * grayscale + mat.texture_info.c10;
         hit_point = hit_point + height * norm;
     }
+    if (payload.depth == 0) {
+        // Surface properties after texturing; secondary rays never have depth 0
+        if ((render_settings.aovs & AOV_ALBEDO) != 0) {
+            aov_albedo[pixel_coords] += float4(mat.base_color, 0);
+        }
+        if ((render_settings.aovs & AOV_NORMAL) != 0) {
+            // norm is in object space; n * WorldToObject applies the inverse transpose of ObjectToWorld
+            float3 world_normal = normalize(mul(norm, (float3x3)WorldToObject3x4()));
+            if (dot(world_normal, view_dir) < 0.0) world_normal = -world_normal;
+            aov_normal[pixel_coords] += float4(world_normal, 0);
+        }
+    }
 
-    float3 direct_light = CalculateDirectLight(hit_point, norm, mat, view_dir, seed);
+    float3 direct_light = CalculateDirectLight(hit_point, norm, mat, view_dir, path_sampler);
     payload.color = direct_light * payload.throughput;
     if (payload.depth < MAX_DEPTH) {
         float reflectivity = min((1.0 - mat.roughness) * (0.3 + mat.metallic * 0.8), 1.0);
@@ -445,9 +828,12 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
         float refraction_prob = mat.transmission * (1.0 - reflectivity);
         float absorption_prob = 1.0 - reflection_prob - refraction_prob;
         absorption_prob = max(absorption_prob, 0.0);
-        bool should_trace = RussianRoulette(payload.throughput * reflectivity, seed);
-        if (!should_trace) return;
-        float random_val = Random(seed);
+        bool should_trace = RussianRoulette(payload.throughput * reflectivity, path_sampler);
+        if (!should_trace) {
+            CountStat(RAY_STAT_RUSSIAN_ROULETTE);
+            return;
+        }
+        float random_val = SampleDimension(path_sampler, SAMPLE_LOBE);
         if (random_val < reflection_prob) {
             float3 reflect_dir = reflect(-view_dir, norm);
             RayDesc reflect_ray;
@@ -463,6 +849,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
             reflect_payload.depth = payload.depth + 1;
             reflect_payload.throughput = payload.throughput * reflectivity;
             reflect_payload.inside_material = payload.inside_material;
+            CountStat(RAY_STAT_REFLECTION);
             TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, reflect_ray, reflect_payload);
             payload.color += reflect_payload.color;
         }
@@ -474,7 +861,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
             refract_dir = normalize(refract_dir);
             if (mat.mean_free_path > 0.0 && !payload.inside_material) {
                 float sigma_t = 1.0 / mat.mean_free_path;
-                float l = -log(1.0 - Random(seed)) / sigma_t;
+                float l = -log(1.0 - SampleDimension(path_sampler, SAMPLE_SSS_DISTANCE)) / sigma_t;
                 RayDesc test_ray;
                 test_ray.Origin = hit_point - norm * 0.001;
                 test_ray.Direction = refract_dir;
@@ -484,6 +871,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
                 test_payload.hit = false;
                 test_payload.instance_id = InstanceID();
                 test_payload.depth = 100;
+                CountStat(RAY_STAT_TEST);
                 TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, test_ray, test_payload);
                 float d = test_payload.hit ? test_payload.hit_distance : 10000.0;
                 if (d > l) {
@@ -491,13 +879,13 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
                     float g = mat.anisotropy_g;
                     float cos_theta;
                     if (abs(g) < 0.001) {
-                        cos_theta = 1.0 - 2.0 * Random(seed);
+                        cos_theta = 1.0 - 2.0 * SampleDimension(path_sampler, SAMPLE_SCATTER);
                     } else {
-                        float t = (1.0 - g * g) / (1.0 - g + 2.0 * g * Random(seed));
+                        float t = (1.0 - g * g) / (1.0 - g + 2.0 * g * SampleDimension(path_sampler, SAMPLE_SCATTER));
                         cos_theta = (1.0 + g * g - t * t) / (2.0 * g);
                     }
                     float sin_theta = sqrt(max(0.0, 1.0 - cos_theta * cos_theta));
-                    float phi = 2.0 * PI * Random(seed);
+                    float phi = 2.0 * PI * SampleDimension(path_sampler, SAMPLE_SCATTER + 1);
                     float3 u, v;
                     if (abs(refract_dir.x) > 0.1) {
                         u = normalize(cross(refract_dir, float3(0, 1, 0)));
@@ -520,6 +908,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
                     scatter_payload.depth = payload.depth + 1;
                     scatter_payload.throughput = payload.throughput * mat.transmission * (1.0 - reflectivity);
                     scatter_payload.inside_material = true;
+                    CountStat(RAY_STAT_SCATTER);
                     TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, scatter_ray, scatter_payload);
                     payload.color += scatter_payload.color;
                     return;
@@ -538,6 +927,7 @@ void ClosestHitMain(inout RayPayload payload, in BuiltInTriangleIntersectionAttr
             refract_payload.depth = payload.depth + 1;
             refract_payload.throughput = payload.throughput * mat.transmission * (1.0 - reflectivity);
             refract_payload.inside_material = !payload.inside_material;
+            CountStat(RAY_STAT_REFRACTION);
             TraceRay(as, RAY_FLAG_NONE, 0xFF, 0, 1, 0, refract_ray, refract_payload);
             payload.color += refract_payload.color;
         }
@@ -0,0 +1,191 @@
+// Checks of the host-side sampling code that the renderers and shaders share:
+// Sobol stratification, alias table frequencies, the blue-noise mask and
+// parity of PathSampler with shaders/shader.hlsl. Exits non-zero on failure.
+#include "AliasTable.h"
+#include "PathSampler.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char* what, double got = 0.0, double expected = 0.0) {
+    if (!condition) {
+        std::printf("FAILED: %s (got %.9g, expected %.9g)\n", what, got, expected);
+        ++failures;
+    }
+}
+
+// Each pair of dimensions (2j, 2j + 1) is one Owen-scrambled 2D Sobol
+// sequence, so its first 2^m samples form a (0, m, 2)-net: every grid of
+// 2^a by 2^(m - a) cells holds exactly one sample per cell
+void CheckSobolStratification() {
+    const uint32_t kLastDimension =
+        PathSampler::kPixelDimensions + (PathSampler::kMaxDepth + 1) * PathSampler::kDimensionsPerBounce;
+    const uint32_t kPixels[][2] = { { 0, 0 }, { 5, 7 }, { 1919, 1079 } };
+    const int kMaxLog2 = 8;
+    for (const auto& pixel : kPixels) {
+        for (uint32_t dimension = 0; dimension < kLastDimension; dimension += 2) {
+            std::vector<float> u(1 << kMaxLog2);
+            std::vector<float> v(1 << kMaxLog2);
+            for (uint32_t i = 0; i < u.size(); ++i) {
+                PathSampler sampler = PathSampler::ForCamera(SamplerType::kSobol, pixel[0], pixel[1], i);
+                u[i] = sampler.Get(dimension);
+                v[i] = sampler.Get(dimension + 1);
+            }
+            for (int m = 0; m <= kMaxLog2; ++m) {
+                const int count = 1 << m;
+                for (int a = 0; a <= m; ++a) {
+                    const int columns = 1 << a;
+                    const int rows = 1 << (m - a);
+                    std::vector<int> cells(count, 0);
+                    for (int i = 0; i < count; ++i) {
+                        int column = static_cast<int>(u[i] * columns);
+                        int row = static_cast<int>(v[i] * rows);
+                        cells[row * columns + column]++;
+                    }
+                    bool stratified = true;
+                    for (int cell : cells) {
+                        stratified = stratified && cell == 1;
+                    }
+                    if (!stratified) {
+                        std::printf("pixel (%u, %u), dimensions %u-%u, %d samples, %dx%d strata\n", pixel[0], pixel[1],
+                                    dimension, dimension + 1, count, columns, rows);
+                    }
+                    Check(stratified, "Sobol pair stratification");
+                }
+            }
+        }
+    }
+}
+
+// Evenly spaced u hit every index in proportion to its pdf
+void CheckAliasTable() {
+    const std::vector<float> weights = { 1.0f, 0.0f, 3.0f, 0.5f, 7.0f, 2.5f, 0.0f, 1e-3f };
+    AliasTable table;
+    table.Build(weights);
+    Check(!table.IsEmpty(), "alias table built");
+    double total = 0.0;
+    for (float weight : weights) {
+        total += weight;
+    }
+    Check(std::fabs(table.GetTotalWeight() - total) < 1e-6, "alias table total weight", table.GetTotalWeight(), total);
+
+    const int kDraws = 1 << 20;
+    std::vector<int> counts(weights.size(), 0);
+    bool pdfs_match = true;
+    bool remapped_in_range = true;
+    for (int i = 0; i < kDraws; ++i) {
+        float u = (i + 0.5f) / kDraws;
+        float pdf = 0.0f;
+        float remapped = 0.0f;
+        uint32_t index = AliasTable::Sample(table.GetEntries().data(), static_cast<uint32_t>(weights.size()), u, &pdf,
+                                            &remapped);
+        counts[index]++;
+        pdfs_match = pdfs_match && pdf == table.GetPdf(index);
+        remapped_in_range = remapped_in_range && remapped >= 0.0f && remapped < 1.0f;
+    }
+    Check(pdfs_match, "alias sample returns the pdf of its index");
+    Check(remapped_in_range, "alias remapped u in [0, 1)");
+    for (size_t i = 0; i < weights.size(); ++i) {
+        double expected = weights[i] / total;
+        double frequency = static_cast<double>(counts[i]) / kDraws;
+        Check(std::fabs(table.GetPdf(static_cast<uint32_t>(i)) - expected) < 1e-6, "alias pdf",
+              table.GetPdf(static_cast<uint32_t>(i)), expected);
+        Check(std::fabs(frequency - expected) < 1e-4, "alias frequency", frequency, expected);
+        if (weights[i] == 0.0f) {
+            Check(counts[i] == 0, "alias never draws a zero weight", counts[i], 0);
+        }
+    }
+
+    AliasTable empty;
+    empty.Build({ 0.0f, -1.0f });
+    Check(empty.IsEmpty(), "alias table of zero weights is empty");
+}
+
+// The mask stores (rank + 0.5) / count, so it must hold every rank once
+void CheckBlueNoiseMask() {
+    const std::vector<float>& mask = PathSampler::GetBlueNoiseMask();
+    const int count = PathSampler::kBlueNoiseSize * PathSampler::kBlueNoiseSize;
+    Check(static_cast<int>(mask.size()) == count, "blue-noise mask size", static_cast<double>(mask.size()), count);
+    std::vector<int> seen(count, 0);
+    bool exact = true;
+    for (float value : mask) {
+        double rank = value * count - 0.5;
+        long nearest = std::lround(rank);
+        exact = exact && std::fabs(rank - nearest) < 1e-3 && nearest >= 0 && nearest < count;
+        if (nearest >= 0 && nearest < count) {
+            seen[nearest]++;
+        }
+    }
+    Check(exact, "blue-noise mask values are ranks");
+    bool permutation = true;
+    for (int times : seen) {
+        permutation = permutation && times == 1;
+    }
+    Check(permutation, "blue-noise mask is a permutation of ranks");
+}
+
+// Values of SampleDimension in shaders/shader.hlsl (SAMPLER_SOBOL and
+// SAMPLER_RANDOM, offsets 0-3), evaluated outside the shader with 32-bit
+// unsigned and float arithmetic. depth -1 is the camera sampler.
+struct Reference {
+    uint32_t x;
+    uint32_t y;
+    int depth;
+    uint32_t sample_index;
+    float sobol[4];
+    float random[4];
+};
+
+const Reference kReferences[] = {
+    { 0, 0, -1, 0, { 0.0142813921f, 0.654424071f, 0.443183184f, 0.454210103f },
+      { 0.0301999971f, 0.135600492f, 0.234235808f, 0.340567827f } },
+    { 5, 7, -1, 3, { 0.328425407f, 0.282360613f, 0.811677992f, 0.427890897f },
+      { 0.660717905f, 0.389723301f, 0.892235279f, 0.535543859f } },
+    { 123, 45, 0, 17, { 0.818614066f, 0.783909798f, 0.819523573f, 0.340687215f },
+      { 0.774046659f, 0.46244508f, 0.961171329f, 0.0289370306f } },
+    { 640, 360, 2, 255, { 0.306333423f, 0.162689924f, 0.2415663f, 0.542142689f },
+      { 0.514987826f, 0.196600914f, 0.796820641f, 0.778036118f } },
+    { 1, 1, 9, 1000, { 0.438184142f, 0.21088326f, 0.0088775754f, 0.529713213f },
+      { 0.828763783f, 0.783257306f, 0.621350169f, 0.983308196f } },
+};
+
+PathSampler MakeSampler(SamplerType type, const Reference& reference) {
+    return reference.depth < 0
+               ? PathSampler::ForCamera(type, reference.x, reference.y, reference.sample_index)
+               : PathSampler::ForBounce(type, reference.x, reference.y, reference.sample_index,
+                                        static_cast<uint32_t>(reference.depth));
+}
+
+void CheckShaderParity() {
+    for (const Reference& reference : kReferences) {
+        PathSampler sobol = MakeSampler(SamplerType::kSobol, reference);
+        PathSampler random = MakeSampler(SamplerType::kRandom, reference);
+        for (uint32_t offset = 0; offset < 4; ++offset) {
+            float value = sobol.Get(offset);
+            Check(std::fabs(value - reference.sobol[offset]) < 1e-6f, "Sobol parity with shader.hlsl", value,
+                  reference.sobol[offset]);
+            value = random.Get(offset);
+            Check(std::fabs(value - reference.random[offset]) < 1e-6f, "random parity with shader.hlsl", value,
+                  reference.random[offset]);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    CheckSobolStratification();
+    CheckAliasTable();
+    CheckBlueNoiseMask();
+    CheckShaderParity();
+    if (failures > 0) {
+        std::printf("%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("All sampling checks passed\n");
+    return 0;
+}